@@ -0,0 +1,142 @@
+//Compile-time description of the robot's wiring. Every pin has one role, PWM slices and channels are
+//worked out here, and two PWM roles that share a slice must agree on frequency and wrap or the build fails.
+#ifndef BOARD_H
+#define BOARD_H
+
+#include "HAL.h"
+#include "PWM.h"
+#include "Sensor.h"
+
+namespace Board
+{
+    enum class Role {
+        MotorStandby,
+        LeftMotorPWM,
+        LeftMotorIn1,
+        LeftMotorIn2,
+        RightMotorPWM,
+        RightMotorIn1,
+        RightMotorIn2,
+        DistanceTrigger,
+        DistanceEcho,
+        LeftEncoderA,
+        LeftEncoderB,
+        RightEncoderA,
+        RightEncoderB,
+        MainButton,
+        RedLed,
+        BlueLed,
+        GreenLed,
+    };
+
+    /// @brief One pin of the board. frequency and wrap are 0 for pins that are not PWM
+    struct PinAssignment {
+        Role role;
+        uint pin;
+        int frequency;
+        int wrap;
+    };
+
+    /// @brief The wiring, see wiringSchematic.svg. The encoders are the C1/C2 nets of the motor connectors, C1A/C2A
+    /// @brief of MotA (AIN, PWMA) and C1B/C2B of MotB (BIN, PWMB). Which of C1 and C2 leads going forward is not
+    /// @brief confirmed on the robot yet. Both have B = A + 1 so the PIO encoder backend can be used
+    inline constexpr PinAssignment pins[] = {
+        {Role::MotorStandby,    12, 0, 0},
+        {Role::LeftMotorPWM,    16, PWM::MOTOR::frequency, PWM::MOTOR::wrapCounter},
+        {Role::LeftMotorIn1,    17, 0, 0},
+        {Role::LeftMotorIn2,    18, 0, 0},
+        {Role::RightMotorPWM,   15, PWM::MOTOR::frequency, PWM::MOTOR::wrapCounter},
+        {Role::RightMotorIn1,   14, 0, 0},
+        {Role::RightMotorIn2,   13, 0, 0},
+        {Role::DistanceTrigger,  9, Sensor::Distance::triggerFrequency, Sensor::Distance::triggerWrap},
+        {Role::DistanceEcho,     8, 0, 0},
+        {Role::LeftEncoderA,    19, 0, 0},
+        {Role::LeftEncoderB,    20, 0, 0},
+        {Role::RightEncoderA,   10, 0, 0},
+        {Role::RightEncoderB,   11, 0, 0},
+        {Role::MainButton,      22, 0, 0},
+        {Role::RedLed,          28, 0, 0},
+        {Role::BlueLed,         26, PWM::LED::frequency, PWM::LED::wrapCounter},
+        {Role::GreenLed,        27, PWM::LED::frequency, PWM::LED::wrapCounter},
+    };
+
+    inline constexpr uint unassigned = 0xff;
+
+    #pragma region Compile Time Lookups
+
+    /// @brief The PWM slice a GPIO drives, same as pwm_gpio_to_slice_num on the RP2350
+    constexpr uint SliceOf(uint pin) { return pin < 32 ? ((pin >> 1u) & 7u) : (8u + ((pin >> 1u) & 3u)); }
+
+    /// @brief The PWM channel a GPIO drives, 0 for A and 1 for B
+    constexpr uint ChannelOf(uint pin) { return pin & 1u; }
+
+    constexpr const PinAssignment* Find(Role role) {
+        for (const PinAssignment& p : pins) {
+            if (p.role == role) return &p;
+        }
+        return nullptr;
+    }
+
+    /// @brief The GPIO for a role, unassigned if the role has no pin
+    constexpr uint PinOf(Role role) { return Find(role) ? Find(role)->pin : unassigned; }
+
+    constexpr bool UniquePins() {
+        for (const PinAssignment& a : pins) {
+            for (const PinAssignment& b : pins) {
+                if (&a != &b && (a.pin == b.pin || a.role == b.role)) return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief The divider and wrap are per slice, so every PWM pin on a slice has to want the same ones
+    constexpr bool SlicesAgree() {
+        for (const PinAssignment& a : pins) {
+            for (const PinAssignment& b : pins) {
+                if (a.frequency == 0 || b.frequency == 0 || SliceOf(a.pin) != SliceOf(b.pin)) continue;
+                if (a.frequency != b.frequency || a.wrap != b.wrap) return false;
+            }
+        }
+        return true;
+    }
+
+    static_assert(UniquePins(), "Two roles share a pin, or a role is listed twice");
+    static_assert(SlicesAgree(), "Two PWM pins on the same slice want different frequencies or wraps");
+
+    #pragma endregion
+
+    #pragma region Pin Handles
+
+    /// @brief Zero-cost handle for a board pin. The pin, slice and channel are constants, so every call is
+    /// @brief a single register write with nothing looked up at runtime
+    /// @tparam R The role of the pin
+    template <Role R>
+    struct Pin {
+        static constexpr uint id = PinOf(R);
+        static constexpr uint slice = SliceOf(id);
+        static constexpr uint channel = ChannelOf(id);
+        static constexpr int wrap = Find(R) ? Find(R)->wrap : 0;
+
+        static_assert(id != unassigned, "Role has no pin in Board::pins");
+
+        static inline void Put(bool state) { gpio_put(id, state); }
+
+        static inline bool Get() { return gpio_get(id); }
+
+        /// @brief Sets the raw compare level, PWM roles only
+        static inline void SetLevel(uint16_t level) {
+            static_assert(wrap > 0, "SetLevel needs a PWM role");
+            pwm_set_chan_level(slice, channel, level);
+        }
+
+        /// @brief Sets the duty from 0 to 1, PWM roles only
+        static inline void SetDuty(float duty) {
+            SetLevel((uint16_t)(duty * wrap));
+        }
+    };
+
+    #pragma endregion
+
+} // namespace Board
+
+#endif
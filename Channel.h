@@ -0,0 +1,82 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include "HAL.h"
+#include "RingBuffer.h"
+#include <type_traits>
+#ifndef P2_HOST
+#include "pico/multicore.h"
+#endif
+
+namespace Buffer {
+
+    /// @brief Typed one way message channel between the two cores, a Ring with an optional doorbell.
+    /// @brief With the doorbell on, every Send also pushes a token into the SIO FIFO towards the other core,
+    /// @brief so a receiver blocked in Wait wakes as soon as a message lands instead of on its next poll.
+    /// @brief The FIFO of a core is shared, so only one doorbell channel may point at each core
+    /// @tparam T A trivially copyable message
+    /// @tparam N Capacity, must be a power of two
+    template <class T, size_t N>
+    class Channel {
+        static_assert(std::is_trivially_copyable<T>::value, "Channel messages are copied, they must be trivially copyable");
+
+        public:
+            Channel(bool doorbell = false) : DOORBELL(doorbell) {}
+
+            /// @brief Producer side, one core only. Queues a message and rings the doorbell
+            /// @return false when the channel was full, the message is dropped and counted
+            bool Send(const T& message) {
+                if (!ring.Push(message)) return false;
+                if (DOORBELL) {
+                    //Never blocks, a full FIFO already holds a doorbell the receiver has not seen
+                    multicore_fifo_push_timeout_us(doorbellToken, 0);
+                }
+                return true;
+            }
+
+            /// @brief Consumer side, the other core only. Takes the oldest message
+            /// @return false when there was nothing waiting
+            bool Receive(T& message) { return ring.Pop(message); }
+
+            /// @brief Consumer side. Drains the channel and keeps only the newest message
+            /// @return false when there was nothing waiting, message is then untouched
+            bool Latest(T& message) {
+                bool any = false;
+                while (ring.Pop(message)) any = true;
+                return any;
+            }
+
+            /// @brief Consumer side. Waits for a message until the given absolute time. Without the doorbell
+            /// @brief this is a plain sleep until then, with it the wait ends as soon as the sender rings
+            /// @param until_us Absolute time to give up at
+            /// @return true when a message is waiting
+            bool Wait(uint64_t until_us) {
+                while (ring.Empty()) {
+                    uint64_t now = time_us_64();
+                    if (now >= until_us) return false;
+                    if (!DOORBELL) {
+                        sleep_us(until_us - now);
+                        return !ring.Empty();
+                    }
+                    uint32_t token;
+                    //Doorbells of messages already taken wake this early, the loop then waits again
+                    if (!multicore_fifo_pop_timeout_us(until_us - now, &token)) return !ring.Empty();
+                }
+                return true;
+            }
+
+            size_t Size() { return ring.Size(); }
+            bool Empty() { return ring.Empty(); }
+            /// @brief Messages lost because the receiver fell behind
+            uint32_t Dropped() { return ring.Dropped(); }
+
+            /// @brief The word rung through the FIFO, only its arrival matters
+            static constexpr uint32_t doorbellToken = 0xDB000001;
+
+        protected:
+            const bool DOORBELL;
+            Ring<T, N> ring;
+    };
+}
+
+#endif
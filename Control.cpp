@@ -0,0 +1,132 @@
+#include "Control.h"
+#include "Static.h"
+#include "Velocity.h"
+
+#pragma region Bouncer
+
+/// @brief Creates the wall bouncing logic on top of a drivetrain
+/// @param drive The drivetrain to command
+/// @param params The tuning constants to use
+template <Drivetrain::DriveLike DriveT>
+Control::Bouncer<DriveT>::Bouncer(DriveT& drive, BounceParams params)
+: Drive(drive), params(params), needsToTurn(0), speedLimit(1)
+{
+
+}
+
+/// @brief Runs one WORK mode tick. Drives forward until a wall is close, then backs up and spins left.
+/// @param distance The distance to the wall in meters, -1 when out of range
+/// @param workTime The accumulated WORK mode time in seconds
+template <Drivetrain::DriveLike DriveT>
+void Control::Bouncer<DriveT>::Step(float distance, float workTime) {
+    float speed = workTime < params.lowBatteryTime ? params.baseSpeed : params.baseSpeed / 2;
+    speed = speed < speedLimit ? speed : speedLimit;
+    Drive.SetState(1);
+
+    if ((distance > params.wallDistance || distance == -1) && needsToTurn == 0) {
+        Drive.Forward(speed);
+    } else if (needsToTurn <= params.backupTicks) {
+        needsToTurn++;
+        Drive.Backward(speed);
+    } else {
+        needsToTurn++;
+        Drive.SpinLeft(speed);
+        if (needsToTurn >= params.turnTicks) {
+            needsToTurn = 0;
+        }
+    }
+}
+
+/// @brief Stops the motors and puts the driver in standby, used for PAUSE mode
+template <Drivetrain::DriveLike DriveT>
+void Control::Bouncer<DriveT>::Pause() {
+    Drive.Stop();
+    Drive.SetState(0);
+}
+
+//The two drivetrains the firmware can be built with, see P2_STATIC_DISPATCH
+template class Control::Bouncer<Drivetrain::DualMotor>;
+template class Control::Bouncer<Static::BoardDualMotor>;
+//And closed loop on top of either, see P2_VELOCITY_CONTROL
+template class Control::Bouncer<Control::VelocityDrive<Drivetrain::DualMotor>>;
+template class Control::Bouncer<Control::VelocityDrive<Static::BoardDualMotor>>;
+
+#pragma endregion
+
+#pragma region Governor
+
+/// @brief Creates the time to collision governor on top of a drivetrain
+/// @param drive The drivetrain to command
+/// @param params The tuning constants to use
+template <Drivetrain::DriveLike DriveT>
+Control::Governor<DriveT>::Governor(DriveT& drive, GovernorParams params)
+: Drive(drive), params(params), turnTicks(0), speedLimit(1), lastDistance(-1), ticksSinceReading(0), closingRate(0),
+timeToCollision(-1)
+{
+
+}
+
+/// @brief Runs one WORK mode tick. Drives forward, slower the sooner it would reach the wall, and spins left in
+/// @brief place once the wall is close. A reading held between echoes is moved on by the closing speed
+/// @param distance The distance to the wall in meters, -1 when out of range
+/// @param velocity The forward speed in m/s from the encoders
+/// @param workTime The accumulated WORK mode time in seconds
+template <Drivetrain::DriveLike DriveT>
+void Control::Governor<DriveT>::Step(float distance, float velocity, float workTime) {
+    float speed = workTime < params.lowBatteryTime ? params.baseSpeed : params.baseSpeed / 2;
+    speed = speed < speedLimit ? speed : speedLimit;
+    Drive.SetState(1);
+
+    //The distance rate is taken between readings that changed, so the held ones in between count as time
+    ticksSinceReading++;
+    if (distance != lastDistance) {
+        if (distance > 0 && lastDistance > 0) {
+            float rate = (lastDistance - distance) / (ticksSinceReading * params.tick);
+            closingRate += params.rateSmoothing * (rate - closingRate);
+        }
+        lastDistance = distance;
+        ticksSinceReading = 0;
+    }
+
+    if (turnTicks > 0) {
+        turnTicks++;
+        Drive.SpinLeft(speed);
+        bool clear = distance > params.clearDistance || distance == -1;
+        if ((clear && turnTicks > params.minTurnTicks) || turnTicks > params.maxTurnTicks) {
+            turnTicks = 0;
+        }
+        return;
+    }
+
+    float closing = velocity > closingRate ? velocity : closingRate;
+    float ahead = distance == -1 ? -1 : distance - (closing > 0 ? closing : 0) * ticksSinceReading * params.tick;
+    if (distance != -1 && ahead < params.turnDistance) {
+        turnTicks = 1;
+        timeToCollision = -1;
+        Drive.SpinLeft(speed);
+        return;
+    }
+
+    float scale = 1;
+    timeToCollision = -1;
+    if (ahead != -1 && closing > 0) {
+        timeToCollision = (ahead - params.stopDistance) / closing;
+        if (timeToCollision < params.horizon) scale = timeToCollision / params.horizon;
+    }
+    float floor = params.minSpeed < speed ? params.minSpeed : speed;
+    Drive.Forward(speed * scale > floor ? speed * scale : floor);
+}
+
+/// @brief Stops the motors and puts the driver in standby, used for PAUSE mode
+template <Drivetrain::DriveLike DriveT>
+void Control::Governor<DriveT>::Pause() {
+    Drive.Stop();
+    Drive.SetState(0);
+}
+
+template class Control::Governor<Drivetrain::DualMotor>;
+template class Control::Governor<Static::BoardDualMotor>;
+template class Control::Governor<Control::VelocityDrive<Drivetrain::DualMotor>>;
+template class Control::Governor<Control::VelocityDrive<Static::BoardDualMotor>>;
+
+#pragma endregion
@@ -0,0 +1,97 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include "DriveTrain.h"
+
+namespace Control
+{
+    /// @brief The tuning constants of the wall bouncing behaviour
+    struct BounceParams {
+        float baseSpeed = 0.6f;         //Duty used while driving forward
+        float wallDistance = 0.55f;     //Distance in meters that counts as a wall
+        int backupTicks = 60;           //Ticks spent reversing after seeing a wall
+        int turnTicks = 100;            //Tick the turn finishes on, counted from the start of the backup
+        float lowBatteryTime = 45;      //WORK mode seconds after which the speed is halved
+    };
+
+    /// @brief The WORK mode decision logic of core1, one Step per control tick.
+    /// @tparam DriveT The drivetrain, Drivetrain::DualMotor or Static::BoardDualMotor, or a Control::VelocityDrive on either
+    template <Drivetrain::DriveLike DriveT = Drivetrain::DualMotor>
+    class Bouncer {
+        public:
+            Bouncer(DriveT& drive, BounceParams params = BounceParams());
+
+            void Step(float distance, float workTime);
+
+            void Pause();
+
+            /// @brief Caps the duty Step drives with, 1 for no limit
+            void SetSpeedLimit(float limit) { speedLimit = limit; }
+
+            /// @brief Ticks into the current backup and spin maneuver, 0 while driving forward
+            int TurnTicks() { return needsToTurn; }
+
+        protected:
+            DriveT& Drive;
+            BounceParams params;
+            int needsToTurn;
+            float speedLimit;
+
+        private:
+            Bouncer() = delete;
+    };
+
+    /// @brief The tuning constants of the time to collision speed governor
+    struct GovernorParams {
+        float baseSpeed = 0.6f;         //Duty with nothing close ahead
+        float minSpeed = 0.2f;          //Duty the governor slows to at the most, so the robot still reaches the turn
+        float stopDistance = 0.15f;     //Distance in meters the time to collision counts down to
+        float horizon = 1.0f;           //Seconds of time to collision under which the duty is scaled down
+        float turnDistance = 0.25f;     //Distance in meters at which the robot spins instead of driving on
+        float clearDistance = 0.7f;     //Distance in meters ahead that ends the spin
+        int minTurnTicks = 20;          //Ticks the spin lasts at least, long enough for a fresh echo
+        int maxTurnTicks = 200;         //Ticks after which the spin ends whatever the distance
+        float rateSmoothing = 0.3f;     //Weight of each new distance rate in the closing speed
+        float lowBatteryTime = 45;      //WORK mode seconds after which the speed is halved
+        float tick = 0.01f;             //Seconds between Steps
+    };
+
+    /// @brief A WORK mode that slows into the wall instead of backing off it. Each Step works out the time to
+    /// @brief collision from the closing speed, the larger of the encoder velocity and the rate the distance
+    /// @brief readings fall at, and scales the duty down once it is under the horizon. Close to the wall it spins
+    /// @brief left in place until the way ahead is clear.
+    /// @tparam DriveT The drivetrain, Drivetrain::DualMotor or Static::BoardDualMotor, or a Control::VelocityDrive on either
+    template <Drivetrain::DriveLike DriveT = Drivetrain::DualMotor>
+    class Governor {
+        public:
+            Governor(DriveT& drive, GovernorParams params = GovernorParams());
+
+            void Step(float distance, float velocity, float workTime);
+
+            void Pause();
+
+            /// @brief Caps the duty Step drives with, 1 for no limit
+            void SetSpeedLimit(float limit) { speedLimit = limit; }
+
+            /// @brief Ticks into the current spin, 0 while driving forward
+            int TurnTicks() { return turnTicks; }
+
+            /// @brief Seconds to collision at the last forward Step, -1 when not closing on anything
+            float TimeToCollision() { return timeToCollision; }
+
+        protected:
+            DriveT& Drive;
+            GovernorParams params;
+            int turnTicks;
+            float speedLimit;
+            float lastDistance;
+            int ticksSinceReading;      //Since the distance reading last changed
+            float closingRate;          //m/s the readings fall at, smoothed
+            float timeToCollision;
+
+        private:
+            Governor() = delete;
+    };
+} // namespace Control
+
+#endif
@@ -0,0 +1,156 @@
+#include "Coverage.h"
+#include <cassert>
+#include <cmath>
+
+#pragma region ZigZagPlanner
+
+/// @brief Lays out the lanes for an area
+/// @param params The area and the robot's coverage width
+Navigation::ZigZagPlanner::ZigZagPlanner(CoverageParams params)
+: params(params)
+{
+    rotated = params.width > params.length;
+    laneLength = rotated ? params.width : params.length;
+    span = rotated ? params.length : params.width;
+    assert(params.overlap < params.robotWidth && "The lanes must overlap by less than the robot's width");
+    spacing = params.robotWidth - params.overlap;
+    spacing = spacing < minSpacing ? minSpacing : spacing;
+    //Capped as a float, a lane count past int's range would not convert
+    float needed = span <= params.robotWidth ? 1 : std::ceil((span - params.robotWidth) / spacing) + 1;
+    lanes = needed > maxLanes ? maxLanes : (int)needed;
+}
+
+/// @brief Where a lane starts, even lanes run away from the start edge and odd lanes back towards it
+Navigation::Waypoint Navigation::ZigZagPlanner::LaneStart(int lane) {
+    //The last lane sits against the far side rather than past it
+    float across = params.robotWidth / 2 + lane * spacing;
+    float limit = span - params.robotWidth / 2;
+    across = across > limit ? limit : across;
+    float along = lane % 2 == 0 ? 0 : laneLength;
+    return rotated ? Waypoint{across, along} : Waypoint{along, across};
+}
+
+/// @brief Where a lane ends, the opposite edge from its start
+Navigation::Waypoint Navigation::ZigZagPlanner::LaneEnd(int lane) {
+    Waypoint start = LaneStart(lane);
+    float along = lane % 2 == 0 ? laneLength : 0;
+    return rotated ? Waypoint{start.x, along} : Waypoint{along, start.y};
+}
+
+#pragma endregion
+
+#pragma region ZigZagFollower
+
+namespace {
+    float Wrap(float angle) { return std::remainder(angle, 2 * (float)M_PI); }
+}
+
+/// @brief Creates a follower at the start of the first lane
+/// @param planner The lanes to follow
+/// @param params The follower tuning
+Navigation::ZigZagFollower::ZigZagFollower(ZigZagPlanner& planner, FollowerParams params)
+: Planner(planner), params(params)
+{
+    Restart();
+}
+
+/// @brief Starts over from the first lane. The pose must be in the planner's frame, i.e. reset
+/// @brief the odometry in the corner the sweep starts from
+void Navigation::ZigZagFollower::Restart() {
+    phase = Phase::TurnIn;
+    lane = 0;
+    lastLane = Planner.Lanes() - 1;
+    shiftHeading = 0;
+}
+
+/// @brief Runs one control tick
+/// @param pose The odometry pose, in the planner's frame
+/// @param distance The distance sensor reading in meters, -1 when nothing is in range
+/// @param speedScale Scales every speed, e.g. 0.5 for low battery
+/// @return the velocity to drive with
+Navigation::Twist Navigation::ZigZagFollower::Step(const Pose& pose, float distance, float speedScale) {
+    bool wallAhead = distance >= 0 && distance < params.wallDistance;
+    bool reached = false;
+    Twist twist = {0, 0};
+
+    switch (phase) {
+        case Phase::Lane: {
+            Waypoint start = Planner.LaneStart(lane);
+            Waypoint end = Planner.LaneEnd(lane);
+            float dx = end.x - start.x, dy = end.y - start.y;
+            float length = std::sqrt(dx * dx + dy * dy);
+            float ux = dx / length, uy = dy / length;
+            float progress = ux * (pose.x - start.x) + uy * (pose.y - start.y);
+            //Positive when left of the lane
+            float crossTrack = ux * (pose.y - start.y) - uy * (pose.x - start.x);
+
+            if (progress >= length || wallAhead) {
+                if (lane >= lastLane) {
+                    phase = Phase::Done;
+                    break;
+                }
+                //Sidestep across the lanes, the part of the gap to the next lane that is not along this one
+                Waypoint next = Planner.LaneStart(lane + 1);
+                float gx = next.x - start.x, gy = next.y - start.y;
+                float along = gx * ux + gy * uy;
+                shiftHeading = std::atan2(gy - along * uy, gx - along * ux);
+                phase = Phase::TurnOut;
+                break;
+            }
+            twist.linear = params.speed * speedScale;
+            twist.angular = params.headingGain * Wrap(LaneHeading(lane) - pose.heading) - params.crossTrackGain * crossTrack;
+            break;
+        }
+        case Phase::TurnOut:
+            twist = TurnTo(shiftHeading, pose.heading, speedScale, reached);
+            if (reached) phase = Phase::Shift;
+            break;
+        case Phase::Shift: {
+            Waypoint next = Planner.LaneStart(lane + 1);
+            float sx = std::cos(shiftHeading), sy = std::sin(shiftHeading);
+            float remaining = sx * (next.x - pose.x) + sy * (next.y - pose.y);
+            if (wallAhead) {
+                //No room past the next lane, so it is the last one and is driven from here
+                lastLane = lane + 1;
+            }
+            if (remaining <= 0 || wallAhead) {
+                phase = Phase::TurnIn;
+                lane++;
+                break;
+            }
+            twist.linear = params.speed * speedScale;
+            twist.angular = params.headingGain * Wrap(shiftHeading - pose.heading);
+            break;
+        }
+        case Phase::TurnIn:
+            twist = TurnTo(LaneHeading(lane), pose.heading, speedScale, reached);
+            if (reached) phase = Phase::Lane;
+            break;
+        case Phase::Done:
+            break;
+    }
+    return twist;
+}
+
+/// @brief The heading of a lane, from its start to its end
+float Navigation::ZigZagFollower::LaneHeading(int lane) {
+    Waypoint start = Planner.LaneStart(lane);
+    Waypoint end = Planner.LaneEnd(lane);
+    return std::atan2(end.y - start.y, end.x - start.x);
+}
+
+/// @brief Turns in place towards a heading, never slower than a third of the turn rate so it does not creep
+/// @param reached Set once the heading is within headingTolerance
+Navigation::Twist Navigation::ZigZagFollower::TurnTo(float heading, float current, float speedScale, bool& reached) {
+    float error = Wrap(heading - current);
+    reached = std::fabs(error) < params.headingTolerance;
+    if (reached) return {0, 0};
+
+    float rate = params.turnRate * speedScale;
+    float angular = params.headingGain * error;
+    float magnitude = std::fabs(angular);
+    magnitude = magnitude > rate ? rate : (magnitude < rate / 3 ? rate / 3 : magnitude);
+    return {0, error > 0 ? magnitude : -magnitude};
+}
+
+#pragma endregion
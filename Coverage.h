@@ -0,0 +1,100 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include "Odometry.h"
+
+namespace Navigation
+{
+    /// @brief A velocity command, what the follower asks of Control::VelocityDrive::SetVelocity
+    struct Twist {
+        float linear;   //m/s forward
+        float angular;  //rad/s, positive turns left
+    };
+
+    struct Waypoint {
+        float x;
+        float y;
+    };
+
+    /// @brief The area to cover and the tool that covers it. The robot starts in a corner facing along
+    /// @brief the length with the area on its left, which is the frame the waypoints are in
+    struct CoverageParams {
+        float length = 3.0f;        //Meters along the start heading
+        float width = 2.0f;         //Meters to the left of the start
+        float robotWidth = 0.16f;   //Width the robot covers in one pass
+        float overlap = 0.02f;      //Meters each pass overlaps the one before
+    };
+
+    /// @brief Boustrophedon (zig-zag) lanes, see README 3.4. Lanes run along the longer side to keep the number
+    /// @brief of turns down and are robotWidth - overlap apart. Every lane is two waypoints, start and end
+    class ZigZagPlanner {
+        public:
+            ZigZagPlanner(CoverageParams params);
+
+            int Lanes() { return lanes; }
+            float LaneSpacing() { return spacing; }
+            /// @brief True when the lanes run along the width, because it is the longer side
+            bool Rotated() { return rotated; }
+            Waypoint LaneStart(int lane);
+            Waypoint LaneEnd(int lane);
+
+            static constexpr int maxLanes = 64;
+            static constexpr float minSpacing = 0.01f;  //Meters, what an overlap of the whole robot width or more gets
+
+        protected:
+            CoverageParams params;
+            bool rotated;
+            float laneLength;
+            float span;
+            float spacing;
+            int lanes;
+    };
+
+    /// @brief The tuning of the follower
+    struct FollowerParams {
+        float speed = 0.25f;            //Lane speed in m/s
+        float turnRate = 2.0f;          //Turn rate in place in rad/s
+        float wallDistance = 0.1f;      //A reading below this ends a lane or the sidestep
+        float headingGain = 3.0f;       //rad/s per rad of heading error
+        float crossTrackGain = 4.0f;    //rad/s per meter off the lane
+        float headingTolerance = 0.03f; //Radians a turn may stop short
+    };
+
+    /// @brief Drives the zig-zag lanes of a ZigZagPlanner on the odometry pose. A lane ends at its planned
+    /// @brief length or earlier at a wall seen by the distance sensor, so the plan only has to be a rough
+    /// @brief size of the area. The sweep ends after the last lane. A wall met while sidestepping makes the
+    /// @brief next lane the last one, driven from where the robot stopped
+    class ZigZagFollower {
+        public:
+            ZigZagFollower(ZigZagPlanner& planner, FollowerParams params = FollowerParams());
+
+            Twist Step(const Pose& pose, float distance, float speedScale = 1);
+            void Restart();
+
+            bool Done() { return phase == Phase::Done; }
+            int Lane() { return lane; }
+
+        protected:
+            ZigZagFollower() = delete;
+
+            enum class Phase : uint8_t {
+                Lane,       //Driving along a lane
+                TurnOut,    //Turning towards the next lane
+                Shift,      //Sidestepping to the next lane
+                TurnIn,     //Turning onto the next lane
+                Done,
+            };
+
+            float LaneHeading(int lane);
+            Twist TurnTo(float heading, float current, float speedScale, bool& reached);
+
+            ZigZagPlanner& Planner;
+            FollowerParams params;
+            Phase phase;
+            int lane;
+            int lastLane;
+            float shiftHeading;
+    };
+} // namespace Navigation
+
+#endif
@@ -1,5 +1,104 @@
 #include "DriveTrain.h"
 
+#pragma region CommandLatch
+
+#ifdef P2_HOST
+thread_local Drivetrain::CommandLatch* Drivetrain::CommandLatch::owner = nullptr;
+#else
+Drivetrain::CommandLatch* Drivetrain::CommandLatch::owner = nullptr;
+#endif
+
+/// @brief Puts two motor slices in phase and hands the PWM wrap interrupt to a latch, for both kinds of latch
+/// @param leftSlice The slice whose wrap interrupt the latch uses
+/// @param wrapHandler The latch's handler, it runs at the highest priority
+void Drivetrain::StartLatch(uint leftSlice, uint rightSlice, irq_handler_t wrapHandler) {
+    //Both slices stop at 0 and start again in one write to EN, so every wrap of one is a wrap of the other and
+    //Apply only has to watch the left counter. The other slices run on untouched
+    uint32_t status = save_and_disable_interrupts();
+    uint32_t both = (1u << leftSlice) | (1u << rightSlice), others = pwm_hw->en & ~both;
+    pwm_set_mask_enabled(others);
+    pwm_set_counter(leftSlice, 0);
+    pwm_set_counter(rightSlice, 0);
+    pwm_set_mask_enabled(others | both);
+    restore_interrupts(status);
+
+    pwm_set_irq_enabled(leftSlice, false);
+    irq_set_exclusive_handler(PWM_DEFAULT_IRQ_NUM(), wrapHandler);
+    //Above the timer and GPIO IRQs, so the pins follow the wrap even while the control task runs
+    irq_set_priority(PWM_DEFAULT_IRQ_NUM(), PICO_HIGHEST_IRQ_PRIORITY);
+    irq_set_enabled(PWM_DEFAULT_IRQ_NUM(), true);
+}
+
+/// @brief Puts the two motor slices in phase and takes the PWM wrap interrupt. The pins must already be set up, by
+/// @brief PWM::MOTOR or Static::Motor, with the same frequency and wrap on both slices. Only one latch may exist at a time,
+/// @brief a second one would take the interrupt from the first and leave its direction pins unwritten
+/// @param frequency The PWM frequency of both slices in Hz
+/// @param wrapCounter The counts per period of both slices
+Drivetrain::CommandLatch::CommandLatch(uint LeftMotorPWMPin, uint LeftMotorPin1, uint LeftMotorPin2, uint RightMotorPWMPin, uint RightMotorPin1, uint RightMotorPin2, int frequency, int wrapCounter)
+:
+LEFTSLICE(pwm_gpio_to_slice_num(LeftMotorPWMPin)), LEFTCHANNEL(pwm_gpio_to_channel(LeftMotorPWMPin)),
+RIGHTSLICE(pwm_gpio_to_slice_num(RightMotorPWMPin)), RIGHTCHANNEL(pwm_gpio_to_channel(RightMotorPWMPin)),
+LEFTIN1(1u << LeftMotorPin1), LEFTIN2(1u << LeftMotorPin2), RIGHTIN1(1u << RightMotorPin1), RIGHTIN2(1u << RightMotorPin2),
+DIRECTIONMASK(LEFTIN1 | LEFTIN2 | RIGHTIN1 | RIGHTIN2),
+WRAPCOUNTER(wrapCounter), TICKUS(PWM::Tick_us(frequency, wrapCounter)),
+current(), drivenPins(gpio_get_all() & DIRECTIONMASK), pendingPins(drivenPins), pending(false)
+{
+    hard_assert(owner == nullptr);
+    owner = this;
+    StartLatch(LEFTSLICE, RIGHTSLICE, WrapHandler);
+}
+
+/// @brief Stands the wrap interrupt down and lets another latch take it
+Drivetrain::CommandLatch::~CommandLatch() {
+    pwm_set_irq_enabled(LEFTSLICE, false);
+    pwm_clear_irq(LEFTSLICE);
+    owner = nullptr;
+}
+
+/// @brief Sends both wheels to the command together. The two compare levels latch on the next wrap, and if a direction
+/// @brief changes the pins follow on that same wrap. Applying again before the wrap replaces the command that is waiting
+void Drivetrain::CommandLatch::Apply(const DriveCommand& command) {
+    uint16_t leftLevel = LevelOf(command.left, WRAPCOUNTER), rightLevel = LevelOf(command.right, WRAPCOUNTER);
+    uint32_t pins = PinsOf(command, LEFTIN1, LEFTIN2, RIGHTIN1, RIGHTIN2);
+
+    uint32_t status = save_and_disable_interrupts();
+    //Both levels must go in inside one period, a wrap between the two writes would split them. The slices count
+    //together, so the left counter is the right one too
+    uint32_t counter = pwm_get_counter(LEFTSLICE);
+    if (counter + guardTicks >= (uint32_t)WRAPCOUNTER) busy_wait_us((uint64_t)((WRAPCOUNTER - counter) * TICKUS) + 1);
+    //A wrap while interrupts were off latched the waiting levels, their pins are owed before new levels go in
+    if (pending && (pwm_get_irq_status_mask() & (1u << LEFTSLICE))) Latch();
+
+    pwm_set_chan_level(LEFTSLICE, LEFTCHANNEL, leftLevel);
+    pwm_set_chan_level(RIGHTSLICE, RIGHTCHANNEL, rightLevel);
+    if (pending || pins != drivenPins) {
+        pendingPins = pins;
+        if (!pending) {
+            pending = true;
+            pwm_clear_irq(LEFTSLICE);
+            pwm_set_irq_enabled(LEFTSLICE, true);
+        }
+    }
+    restore_interrupts(status);
+    current = command;
+}
+
+/// @brief Puts the waiting direction pins out in one SIO write and stands the wrap interrupt down
+void Drivetrain::CommandLatch::Latch() {
+    gpio_put_masked(DIRECTIONMASK, pendingPins);
+    drivenPins = pendingPins;
+    pending = false;
+    pwm_set_irq_enabled(LEFTSLICE, false);
+    pwm_clear_irq(LEFTSLICE);
+}
+
+/// @brief The PWM wrap interrupt, the levels written by Apply have just latched
+void P2_IRQ_FUNC(Drivetrain::CommandLatch::WrapHandler)() {
+    if (owner) owner->Latch();
+}
+
+#pragma endregion
+
 #pragma region DualMotorDrive
 
 /// @brief Inits a two motor drive, using two PWM::MOTORS, assumes a motor drive that utilizes a STBYpin
@@ -14,43 +113,61 @@ Drivetrain::DualMotor::DualMotor(uint STBYPin, uint LeftMotorPWMPin, uint LeftMo
 :
 StandbyPin(STBYPin, true),
 LeftMotor(LeftMotorPWMPin, LeftMotorPin1, LeftMotorPin2),
-RightMotor(RightMotorPWMPin, RightMotorPin1, RightMotorPin2)
+RightMotor(RightMotorPWMPin, RightMotorPin1, RightMotorPin2),
+Latch(LeftMotorPWMPin, LeftMotorPin1, LeftMotorPin2, RightMotorPWMPin, RightMotorPin1, RightMotorPin2, PWM::MOTOR::frequency, PWM::MOTOR::wrapCounter)
 {
 
 }
 
-/// @brief Stops the motors
+/// @brief Stops the motors, a short brake like Brake
 void Drivetrain::DualMotor::Stop() {
-    LeftMotor.Stop();
-    RightMotor.Stop();
+    Brake();
+}
+
+/// @brief Short brakes both motors, IN1 and IN2 high
+void Drivetrain::DualMotor::Brake() {
+    Apply({{WheelMode::Brake, 0}, {WheelMode::Brake, 0}});
+}
+
+/// @brief Lets both motors coast, the TB6612 outputs open
+void Drivetrain::DualMotor::Coast() {
+    Apply({{WheelMode::Coast, 0}, {WheelMode::Coast, 0}});
+}
+
+/// @brief Sends both motors to the command at once, see CommandLatch
+void Drivetrain::DualMotor::Apply(const DriveCommand& command) {
+    Latch.Apply(command);
 }
 
 /// @brief sets both motors to the same forward duty speed
 /// @param speed a number between 0 and 1 that is the wanted speed
 void Drivetrain::DualMotor::Forward(float speed) {
-    LeftMotor.Forward(speed);
-    RightMotor.Forward(speed);
+    Apply({{WheelMode::Forward, speed}, {WheelMode::Forward, speed}});
 }
 
 /// @brief sets both motors to the same forward duty speed
 /// @param speed a number between 0 and 1 that is the wanted speed
 void Drivetrain::DualMotor::Backward(float speed) {
-    LeftMotor.Backward(speed);
-    RightMotor.Backward(speed);
+    Apply({{WheelMode::Backward, speed}, {WheelMode::Backward, speed}});
 }
 
 /// @brief Sets the right motor to spin forward at given speed, and left motor to spin backwards at given speed, will be a left spin
 /// @param speed a number between 0 and 1 that is the wanted speed
 void Drivetrain::DualMotor::SpinLeft(float speed) {
-    LeftMotor.Backward(speed);
-    RightMotor.Forward(speed);
+    Apply({{WheelMode::Backward, speed}, {WheelMode::Forward, speed}});
 }
 
 /// @brief Sets the right motor to spin backward at given speed, and left motor to spin forward at given speed, will be a right spin
 /// @param speed a number between 0 and 1 that is the wanted speed
 void Drivetrain::DualMotor::SpinRight(float speed){ 
-    LeftMotor.Forward(speed);
-    RightMotor.Backward(speed);
+    Apply({{WheelMode::Forward, speed}, {WheelMode::Backward, speed}});
+}
+
+/// @brief Drives each motor with its own signed duty, for the velocity controller
+/// @param left a number between -1 and 1, negative spins the left motor backward
+/// @param right a number between -1 and 1, negative spins the right motor backward
+void Drivetrain::DualMotor::SetDuties(float left, float right) {
+    Apply({WheelCommand::Signed(left), WheelCommand::Signed(right)});
 }
 
 /// @brief Sets the STBYpin handled by the drivetrain to given state
@@ -62,13 +179,13 @@ void Drivetrain::DualMotor::SetState(bool state) {
 /// @brief Will return the duty or speed of the left motor
 /// @return returns a float from 0 to 1
 float Drivetrain::DualMotor::GetLeftDuty() {
-    return LeftMotor.GetDuty();
+    return Latch.GetDuty(Latch.Current().left);
 }
 
 /// @brief Will return the duty or speed of the left motor
 /// @return returns a float from 0 to 1
 float Drivetrain::DualMotor::GetRightDuty() {
-    return RightMotor.GetDuty();
+    return Latch.GetDuty(Latch.Current().right);
 }
 
 #pragma endregion
\ No newline at end of file
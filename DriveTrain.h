@@ -3,9 +3,139 @@
 
 #include "PWM.h"
 #include "GPIO.h"
+#include <concepts>
 
 namespace Drivetrain
 {
+    /// @brief Anything with the DualMotor API. Lets the control code take either this virtual
+    /// @brief drivetrain or Static::DualMotor, which inlines down to register writes
+    template <class T>
+    concept DriveLike = requires(T drive, float speed, bool state) {
+        drive.Forward(speed);
+        drive.Backward(speed);
+        drive.SpinLeft(speed);
+        drive.SpinRight(speed);
+        drive.SetDuties(speed, speed);
+        drive.SetState(state);
+        drive.Stop();
+        { drive.GetLeftDuty() } -> std::convertible_to<float>;
+        { drive.GetRightDuty() } -> std::convertible_to<float>;
+    };
+
+    /// @brief What one TB6612 channel does with its wheel
+    enum class WheelMode : uint8_t {
+        Forward,    //IN1 low, IN2 high, driven for the duty and short braked for the rest of each period
+        Backward,   //IN1 high, IN2 low
+        Brake,      //IN1 and IN2 high, the winding shorted, the wheel stops in a few cm
+        Coast,      //IN1 and IN2 low with PWM high, the outputs open, the wheel runs down on friction
+    };
+
+    /// @brief One wheel's part of a DriveCommand
+    struct WheelCommand {
+        WheelMode mode = WheelMode::Brake;
+        float duty = 0;             //0 to 1, only used for Forward and Backward
+
+        /// @brief Forward for a positive duty, Backward for a negative one
+        static WheelCommand Signed(float duty) {
+            return duty >= 0 ? WheelCommand{WheelMode::Forward, duty} : WheelCommand{WheelMode::Backward, -duty};
+        }
+    };
+
+    /// @brief Both wheels' modes and duties, applied together by CommandLatch
+    struct DriveCommand {
+        WheelCommand left;
+        WheelCommand right;
+    };
+
+    /// @brief The duty a wheel command drives at, 0 for Brake and Coast
+    inline float DutyOf(const WheelCommand& wheel) {
+        return wheel.mode == WheelMode::Forward || wheel.mode == WheelMode::Backward ? wheel.duty : 0;
+    }
+
+    /// @brief The compare level of a wheel command. Coast holds PWM high, the TB6612 only opens its outputs with IN1 and
+    /// @brief IN2 low while PWM is high, PWM low would short brake instead
+    inline uint16_t LevelOf(const WheelCommand& wheel, int wrapCounter) {
+        switch (wheel.mode) {
+            case WheelMode::Forward:
+            case WheelMode::Backward:
+                assert(wheel.duty <= 1 && wheel.duty >= 0); //Make sure speed is between 0 and 1
+                return (uint16_t)(wheel.duty * wrapCounter);
+            case WheelMode::Coast:
+                return (uint16_t)wrapCounter;
+            default:
+                return 0;
+        }
+    }
+
+    /// @brief The four direction pins for a command, as one word for gpio_put_masked
+    /// @param leftIn1 The masks of the four pins
+    inline uint32_t PinsOf(const DriveCommand& command, uint32_t leftIn1, uint32_t leftIn2, uint32_t rightIn1, uint32_t rightIn2) {
+        uint32_t pins = 0;
+        const WheelCommand* wheels[2] = {&command.left, &command.right};
+        const uint32_t in1[2] = {leftIn1, rightIn1}, in2[2] = {leftIn2, rightIn2};
+        for (int i = 0; i < 2; i++) {
+            switch (wheels[i]->mode) {
+                case WheelMode::Forward: pins |= in2[i]; break;
+                case WheelMode::Backward: pins |= in1[i]; break;
+                case WheelMode::Brake: pins |= in1[i] | in2[i]; break;
+                case WheelMode::Coast: break;
+            }
+        }
+        return pins;
+    }
+
+    void StartLatch(uint leftSlice, uint rightSlice, irq_handler_t wrapHandler);
+
+    /// @brief Applies a DriveCommand to both TB6612 channels in one step. The PWM compare registers are double
+    /// @brief buffered and only take a new level at the wrap of their slice, while a SIO write to the direction pins
+    /// @brief is seen at once, so setting the pins and then the duty of one motor, then the other, runs a wheel in its
+    /// @brief new direction at its old duty for up to a period, and the wheels change on different wraps unless their
+    /// @brief slices count together. Here the two slices are put in phase, both levels are written well clear of a
+    /// @brief wrap so they latch on the same one, and the four direction pins go out in one masked SIO write from the
+    /// @brief PWM wrap interrupt as those levels latch. The motor objects still configure the pins, this only writes them.
+    /// @brief There is one CommandLatch in the firmware, this one or Static::CommandLatch, it owns the PWM wrap interrupt
+    /// @brief until it is destroyed
+    class CommandLatch {
+        public:
+            CommandLatch(uint LeftMotorPWMPin, uint LeftMotorPin1, uint LeftMotorPin2, uint RightMotorPWMPin, uint RightMotorPin1, uint RightMotorPin2, int frequency, int wrapCounter);
+            ~CommandLatch();
+
+            void Apply(const DriveCommand& command);
+
+            /// @brief The last command applied, its levels may wait for the next wrap
+            const DriveCommand& Current() { return current; }
+
+            float GetDuty(const WheelCommand& wheel) { return DutyOf(wheel); }
+
+            //Closer than this to the wrap, the writes wait it out. The motors' divider of 2 makes a tick 13.3 ns, so
+            //Apply keeps interrupts off for at most 1024 ticks, 13.7 us waited as 14 us, and the writes
+            static constexpr uint32_t guardTicks = 1024;
+
+        protected:
+            CommandLatch() = delete;
+
+            void Latch();
+
+            static void WrapHandler();
+
+            const uint LEFTSLICE, LEFTCHANNEL, RIGHTSLICE, RIGHTCHANNEL;
+            const uint32_t LEFTIN1, LEFTIN2, RIGHTIN1, RIGHTIN2;    //Pin masks
+            const uint32_t DIRECTIONMASK;
+            const int WRAPCOUNTER;
+            const float TICKUS;         //Microseconds per PWM counter tick, at the divider the slices really run at
+            DriveCommand current;
+            uint32_t drivenPins;        //What the direction pins are at now
+            volatile uint32_t pendingPins;  //What they go to at the next wrap
+            volatile bool pending;
+
+#ifdef P2_HOST
+            //Per thread on the host like HostHAL's state, so every thread is its own robot with its own latch
+            static thread_local CommandLatch* owner;
+#else
+            static CommandLatch* owner;
+#endif
+    };
+
     class DualMotor {
         public:
             DualMotor(uint STBYPin, uint LeftMotorPWMPin, uint LeftMotorPin1, uint LeftMotorPin2, uint RightMotorPWMPin, uint RightMotorPin1, uint RightMotorPin2);
@@ -16,9 +146,15 @@ namespace Drivetrain
             virtual void SpinLeft(float speed);
             virtual void SpinRight(float speed);
 
+            virtual void SetDuties(float left, float right);
+
             virtual void SetState(bool state);
 
             virtual void Stop();
+            virtual void Brake();
+            virtual void Coast();
+
+            virtual void Apply(const DriveCommand& command);
 
             virtual float GetLeftDuty();
             virtual float GetRightDuty();
@@ -27,6 +163,7 @@ namespace Drivetrain
             PWM::MOTOR LeftMotor;
             PWM::MOTOR RightMotor;
             GPIO::PIN StandbyPin;
+            CommandLatch Latch;
 
         private:
             DualMotor() = delete;
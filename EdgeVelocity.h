@@ -0,0 +1,112 @@
+#ifndef EDGEVELOCITY_H
+#define EDGEVELOCITY_H
+
+#include <cstdint>
+#include "Snapshot.h"
+
+namespace Sensor {
+
+    /// @brief The blend and stop tuning of EdgeVelocity
+    struct EdgeVelocityParams {
+        float blendLow = 8;             //Counts per tick at and below which the edge period alone is used
+        float blendHigh = 24;           //Counts per tick at and above which the count difference alone is used
+        uint32_t stopTimeout_us = 250000;   //No edge for this long reads as stopped
+    };
+
+    /// @brief Hybrid count and period velocity estimator. The edge IRQ hands it every step with its time, each
+    /// @brief velocity tick asks it for the counts per second. At low speed one count more or less in a tick is a
+    /// @brief large error, so the rate comes from the edge times: the counts between the last edge before this tick
+    /// @brief and the last edge before the previous one, over the time between those two edges. Without a new edge
+    /// @brief the wheel is at most 1 count per time since the last edge, so the rate decays towards 0 instead of
+    /// @brief holding. At high speed the count difference over the tick is already fine and reacts within the tick.
+    /// @brief Between blendLow and blendHigh counts a tick the two are mixed linearly.
+    /// @brief The edge IRQ runs on the core that set it up and the velocity timer on core0, from the default alarm
+    /// @brief pool, so the count and time of the last edge go across through a Seqlock. Update must not run from an
+    /// @brief IRQ that can preempt Edge on the same core
+    class EdgeVelocity {
+        public:
+            EdgeVelocity(EdgeVelocityParams params = EdgeVelocityParams())
+            : params(params), edgeCounts(0), tickCounts(0), tick_us(0), refCounts(0), ref_us(0),
+            timed(0), haveTick(false), haveRef(false) {}
+
+            /// @brief Records one decoded step, from the edge IRQ
+            /// @param step +1 or -1, 0 for no step is ignored
+            /// @param timestamp_us When the edge came
+            void Edge(int step, uint64_t timestamp_us) {
+                if (step == 0) return;
+                edgeCounts += step;
+                lastEdge.Write({edgeCounts, timestamp_us});
+            }
+
+            /// @brief The velocity estimate at a velocity tick
+            /// @param now_us The time of the tick
+            /// @return counts per second, signed like the steps
+            float Update(uint64_t now_us) {
+                EdgeStamp edge = lastEdge.Read();
+                int32_t counts = edge.counts;
+                uint64_t last_us = edge.timestamp_us;
+
+                float counted = 0;
+                if (haveTick && now_us > tick_us) counted = (counts - tickCounts) * 1e6f / (now_us - tick_us);
+                int32_t window = haveTick ? counts - tickCounts : 0;
+                haveTick = true;
+                tickCounts = counts;
+                tick_us = now_us;
+
+                if (last_us != ref_us) {
+                    //At least one edge since the last reference edge, time the counts between the two
+                    if (haveRef && last_us > ref_us) timed = (counts - refCounts) * 1e6f / (last_us - ref_us);
+                    else timed = counted;
+                    haveRef = true;
+                    refCounts = counts;
+                    ref_us = last_us;
+                } else if (!haveRef || now_us - ref_us > params.stopTimeout_us) {
+                    timed = 0;
+                } else if (now_us > ref_us) {
+                    //No edge yet, so the next one is at least now - ref_us after the last
+                    float bound = 1e6f / (now_us - ref_us);
+                    if (timed > bound) timed = bound;
+                    if (timed < -bound) timed = -bound;
+                }
+
+                float n = window < 0 ? (float)-window : (float)window;
+                float weight = (n - params.blendLow) / (params.blendHigh - params.blendLow);
+                weight = weight < 0 ? 0 : weight > 1 ? 1 : weight;
+                return weight * counted + (1 - weight) * timed;
+            }
+
+            /// @brief Forgets the edges and the rate, as if the wheel had never turned. Not while edges are coming
+            void Reset() {
+                edgeCounts = 0;
+                lastEdge.Write({0, 0});
+                tickCounts = 0;
+                refCounts = 0;
+                ref_us = 0;
+                timed = 0;
+                haveTick = false;
+                haveRef = false;
+            }
+
+        protected:
+            /// @brief The counts after an edge and when it came, torn if read apart from the other core
+            struct EdgeStamp {
+                int32_t counts;
+                uint64_t timestamp_us;
+            };
+
+            EdgeVelocityParams params;
+            //Edge IRQ side
+            int32_t edgeCounts;
+            Buffer::Seqlock<EdgeStamp> lastEdge;
+            //Velocity tick side
+            int32_t tickCounts;
+            uint64_t tick_us;
+            int32_t refCounts;          //Counts at the reference edge the period is timed from
+            uint64_t ref_us;
+            float timed;                //Last edge timed rate
+            bool haveTick;
+            bool haveRef;
+    };
+}
+
+#endif
@@ -0,0 +1,135 @@
+#include "Fade.h"
+#include <cmath>
+#ifndef P2_HOST
+#include "hardware/dma.h"
+#endif
+
+#pragma region FadeEngine
+
+/// @brief Claims two DMA channels for a PWM slice. The slice must already be configured, e.g. by PWM::LED
+/// @param slice The PWM slice both LEDs are on
+/// @param wrapCounter The wrap counter the slice was set up with
+/// @param frequency The PWM frequency of the slice, the table advances one entry per period
+PWM::FadeEngine::FadeEngine(uint slice, int wrapCounter, int frequency)
+: SLICE(slice), WRAPCOUNTER(wrapCounter), FREQUENCY(frequency), length(0), looping(false)
+{
+    programs[0] = {Shape::Hold, 0, 0, 1};
+    programs[1] = {Shape::Hold, 0, 0, 1};
+    sequenceStart = sequence;
+
+    dataChannel = dma_claim_unused_channel(true);
+    controlChannel = dma_claim_unused_channel(true);
+
+    //The control channel writes the table start into the data channel's read address trigger, restarting it
+    dma_channel_config control = dma_channel_get_default_config(controlChannel);
+    channel_config_set_transfer_data_size(&control, DMA_SIZE_32);
+    channel_config_set_read_increment(&control, false);
+    channel_config_set_write_increment(&control, false);
+    dma_channel_configure(controlChannel, &control, &dma_hw->ch[dataChannel].al3_read_addr_trig, &sequenceStart, 1, false);
+}
+
+/// @brief Holds a channel at a brightness, stops any fade on it
+/// @param channel 0 for A, 1 for B
+/// @param brightness 0 to 1, before gamma correction
+void PWM::FadeEngine::Set(uint channel, float brightness) {
+    programs[channel & 1u] = {Shape::Hold, brightness, brightness, 1};
+    Start();
+}
+
+/// @brief Fades a channel from where it is right now to a brightness, then holds it
+/// @param channel 0 for A, 1 for B
+/// @param to Target brightness from 0 to 1
+/// @param msecs Time the fade takes
+void PWM::FadeEngine::Fade(uint channel, float to, int msecs) {
+    int steps = msecs * FREQUENCY / 1000;
+    steps = steps < 1 ? 1 : (steps > maxSteps ? maxSteps : steps);
+    programs[channel & 1u] = {Shape::Ramp, GetBrightness(channel), to, steps};
+    Start();
+}
+
+/// @brief Fades a channel in and out forever, half the period each way
+/// @param channel 0 for A, 1 for B
+/// @param peak Brightness at the top of the pulse, 0 to 1
+/// @param msecs Period of one fade in plus fade out
+void PWM::FadeEngine::Pulse(uint channel, float peak, int msecs) {
+    int steps = msecs * FREQUENCY / 1000;
+    steps = steps < 2 ? 2 : (steps > maxSteps ? maxSteps : steps);
+    programs[channel & 1u] = {Shape::Pulse, 0, peak, steps};
+    Start();
+}
+
+/// @brief Stops streaming, both channels keep the value last written
+void PWM::FadeEngine::Stop() {
+    //Abort the control channel first so it can not restart the data channel
+    dma_channel_abort(controlChannel);
+    dma_channel_abort(dataChannel);
+    looping = false;
+}
+
+/// @brief Checks if the DMA is still streaming
+/// @return true while a fade runs, always true for a pulse
+bool PWM::FadeEngine::Busy() {
+    return dma_channel_is_busy(dataChannel) || dma_channel_is_busy(controlChannel);
+}
+
+/// @brief Works out the brightness a channel is showing right now from the DMA's position in the table
+/// @param channel 0 for A, 1 for B
+/// @return 0 to 1, before gamma correction
+float PWM::FadeEngine::GetBrightness(uint channel) {
+    const Program& program = programs[channel & 1u];
+    if (length == 0) return program.from;
+    int remaining = (int)(dma_hw->ch[dataChannel].transfer_count & 0x0fffffffu);
+    int step = length - remaining - 1;
+    return Brightness(program, step < 0 ? 0 : step);
+}
+
+/// @brief The brightness of a program at a step of the table
+float PWM::FadeEngine::Brightness(const Program& program, int step) {
+    switch (program.shape) {
+        case Shape::Ramp:
+            if (looping || step >= program.steps - 1) return program.to;
+            return program.from + (program.to - program.from) * step / (float)(program.steps - 1);
+        case Shape::Pulse: {
+            int half = program.steps / 2;
+            int phase = step % program.steps;
+            return phase < half ? program.to * phase / half : program.to * (program.steps - phase) / half;
+        }
+        default:
+            return program.from;
+    }
+}
+
+/// @brief Perceptual to PWM compare value, gamma 2.2
+uint16_t PWM::FadeEngine::Gamma(float brightness) {
+    brightness = brightness < 0 ? 0 : (brightness > 1 ? 1 : brightness);
+    return (uint16_t)(std::pow(brightness, 2.2f) * (WRAPCOUNTER - 1));
+}
+
+/// @brief Renders both channel programs into the table and (re)starts the DMA from the top
+void PWM::FadeEngine::Start() {
+    Stop();
+
+    looping = programs[0].shape == Shape::Pulse || programs[1].shape == Shape::Pulse;
+    //A ramp next to a pulse jumps to its target, since the table repeats at the pulse period
+    length = 1;
+    for (const Program& program : programs) {
+        if (program.shape == Shape::Pulse || (!looping && program.shape == Shape::Ramp)) {
+            length = program.steps > length ? program.steps : length;
+        }
+    }
+
+    for (int i = 0; i < length; i++) {
+        sequence[i] = (uint32_t)Gamma(Brightness(programs[0], i)) | ((uint32_t)Gamma(Brightness(programs[1], i)) << 16);
+    }
+
+    dma_channel_config data = dma_channel_get_default_config(dataChannel);
+    channel_config_set_transfer_data_size(&data, DMA_SIZE_32);
+    channel_config_set_read_increment(&data, true);
+    channel_config_set_write_increment(&data, false);
+    //One compare value per PWM period, latched by the slice on its next wrap
+    channel_config_set_dreq(&data, pwm_get_dreq(SLICE));
+    channel_config_set_chain_to(&data, looping ? controlChannel : dataChannel);
+    dma_channel_configure(dataChannel, &data, &pwm_hw->slice[SLICE].cc, sequence, length, true);
+}
+
+#pragma endregion
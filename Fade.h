@@ -0,0 +1,64 @@
+#ifndef FADE_H
+#define FADE_H
+
+#include "PWM.h"
+
+namespace PWM
+{
+    /// @brief Non-blocking LED fades. Gamma-corrected compare values are precomputed into a table and
+    /// @brief streamed into a slice's compare register by DMA, one value per PWM wrap, so a fade takes no CPU
+    /// @brief once started and can be stopped or retargeted at any moment.
+    /// @brief One engine drives both channels of a slice, since the DMA has to write the whole CC register.
+    class FadeEngine {
+        public:
+            FadeEngine(uint slice, int wrapCounter, int frequency);
+
+            void Set(uint channel, float brightness);
+            void Fade(uint channel, float to, int msecs);
+            void Pulse(uint channel, float peak, int msecs);
+            void Stop();
+
+            bool Busy();
+            float GetBrightness(uint channel);
+
+            /// @brief Longest table the engine can stream, in PWM periods
+            static constexpr int maxSteps = 2048;
+
+        protected:
+            FadeEngine() = delete;
+
+            enum class Shape : uint8_t {
+                Hold,   //Constant brightness
+                Ramp,   //from to to over steps, then hold
+                Pulse,  //0 to peak and back over steps, repeating
+            };
+
+            struct Program {
+                Shape shape;
+                float from;
+                float to;
+                int steps;
+            };
+
+            float Brightness(const Program& program, int step);
+            uint16_t Gamma(float brightness);
+            void Start();
+
+            const uint SLICE;
+            const int WRAPCOUNTER;
+            const int FREQUENCY;
+
+            int dataChannel;
+            int controlChannel;
+            int length;
+            bool looping;
+
+            Program programs[2];
+            /// @brief Compare values, channel A in the low half and B in the high half of every word
+            uint32_t sequence[maxSteps];
+            /// @brief Read by the control channel to restart the data channel at the top of the table
+            uint32_t* sequenceStart;
+    };
+} // namespace PWM
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+
+namespace Filter {
+
+    /// @brief Streaming Hampel filter. A sample further than threshold scaled MADs from the rolling median
+    /// @brief is an outlier and is replaced by the median. Fixed window, so every update is constant time
+    /// @tparam N Window length, odd
+    template <size_t N>
+    class Hampel {
+        static_assert(N % 2 == 1 && N >= 3, "Hampel window must be odd and at least 3");
+
+        public:
+            /// @param threshold How many scaled MADs away counts as an outlier
+            /// @param minSpread The smallest deviation ever treated as an outlier, stops a flat window rejecting everything
+            Hampel(float threshold = 3.0f, float minSpread = 0.02f)
+            : threshold(threshold), minSpread(minSpread), count(0), next(0), inlierBits(0) {}
+
+            /// @brief Adds a sample
+            /// @return The filtered value, the sample itself or the median when it is an outlier
+            float Update(float sample) {
+                window[next] = sample;
+                next = (next + 1) % N;
+                if (count < N) count++;
+
+                float median = Median(window, count);
+                float deviations[N];
+                for (size_t i = 0; i < count; i++) {
+                    deviations[i] = std::fabs(window[i] - median);
+                }
+                //1.4826 scales the MAD to a standard deviation for normal noise
+                float spread = 1.4826f * Median(deviations, count);
+                float limit = threshold * spread > minSpread ? threshold * spread : minSpread;
+
+                bool inlier = count < 3 || std::fabs(sample - median) <= limit;
+                inlierBits = ((inlierBits << 1) | (inlier ? 1u : 0u)) & ((1u << N) - 1);
+                output = inlier ? sample : median;
+                return output;
+            }
+
+            /// @brief The last filtered value
+            float Value() { return output; }
+
+            /// @brief Fraction of the samples in the window that were inliers, 0 before any sample
+            float Confidence() {
+                if (count == 0) return 0;
+                return (float)__builtin_popcount(inlierBits) / (float)count;
+            }
+
+            void Clear() { count = 0; next = 0; inlierBits = 0; }
+
+        protected:
+            /// @brief Median of the first n values, sorts a copy so the window order is kept
+            static float Median(const float* values, size_t n) {
+                float sorted[N];
+                for (size_t i = 0; i < n; i++) {
+                    float v = values[i];
+                    size_t j = i;
+                    while (j > 0 && sorted[j - 1] > v) {
+                        sorted[j] = sorted[j - 1];
+                        j--;
+                    }
+                    sorted[j] = v;
+                }
+                return n % 2 == 1 ? sorted[n / 2] : 0.5f * (sorted[n / 2 - 1] + sorted[n / 2]);
+            }
+
+            const float threshold;
+            const float minSpread;
+            float window[N];
+            size_t count;
+            size_t next;
+            uint32_t inlierBits;
+            float output = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,88 @@
+#include "Fusion.h"
+#include <cmath>
+
+#pragma region WallEstimator
+
+/// @brief Starts with no wall, the first echo sets the estimate
+/// @param params The drive geometry and noise model, metersPerCount usually Sensor::MotorEncoder::metersPerCount
+Navigation::WallEstimator::WallEstimator(FusionParams params)
+: params(params), estimate{-1, 0, 0, 0}, haveCounts(false), lastLeft(0), lastRight(0), speed(0),
+lastSequence(0), measured_us(0), rejects(0), rejected(0)
+{
+    published.Write(estimate);
+}
+
+/// @brief Predicts to the counts, then corrects with the reading if it holds a new echo, and publishes the result.
+/// @brief Call once per control tick
+/// @param timestamp_us When the counts were read
+/// @param reading The distance sensor's reading this tick, from GetReading
+Navigation::WallEstimate Navigation::WallEstimator::Update(int32_t leftCounts, int32_t rightCounts, uint64_t timestamp_us, const Sensor::DistanceReading& reading) {
+    Predict(leftCounts, rightCounts, timestamp_us);
+    Correct(reading);
+    estimate.sinceMeasurement_us = measured_us ? timestamp_us - measured_us : 0;
+    published.Write(estimate);
+    return estimate;
+}
+
+/// @brief Takes the distance driven since the last call off the estimate. The first call only takes the counts as a start
+void Navigation::WallEstimator::Predict(int32_t leftCounts, int32_t rightCounts, uint64_t timestamp_us) {
+    if (!haveCounts) {
+        haveCounts = true;
+        lastLeft = leftCounts;
+        lastRight = rightCounts;
+        estimate.timestamp_us = timestamp_us;
+    }
+    float left = (leftCounts - lastLeft) * params.metersPerCount;
+    float right = (rightCounts - lastRight) * params.metersPerCount;
+    lastLeft = leftCounts;
+    lastRight = rightCounts;
+    float ds = (right + left) / 2;
+    float dh = (right - left) / params.trackWidth;
+    uint64_t dt_us = timestamp_us - estimate.timestamp_us;
+    if (dt_us > 0) speed = ds * 1e6f / dt_us;
+    estimate.timestamp_us = timestamp_us;
+
+    if (estimate.distance < 0) return;
+    estimate.distance = estimate.distance - ds > 0 ? estimate.distance - ds : 0;
+    estimate.variance += params.slip * std::fabs(ds) + params.turnNoise * std::fabs(dh);
+}
+
+/// @brief Moves the estimate towards a new echo. The echo landed age_us ago, so the distance driven since is taken
+/// @brief off it first. No echo in range drops the estimate, and an echo outside the gate is rejected, unless
+/// @brief maxRejects come in a row, then the wall has changed and the estimate restarts from it
+void Navigation::WallEstimator::Correct(const Sensor::DistanceReading& reading) {
+    if (reading.sequence == lastSequence) return;
+    lastSequence = reading.sequence;
+    measured_us = estimate.timestamp_us;
+    if (reading.distance < 0) {
+        estimate.distance = -1;
+        estimate.variance = 0;
+        rejects = 0;
+        return;
+    }
+
+    float z = reading.distance - speed * reading.age_us * 1e-6f;
+    z = z > 0 ? z : 0;
+    float r = params.measurementNoise;
+    if (estimate.distance < 0) {
+        estimate.distance = z;
+        estimate.variance = r;
+        return;
+    }
+    float innovation = z - estimate.distance;
+    float s = estimate.variance + r;
+    if (innovation * innovation > params.gate * params.gate * s) {
+        rejected++;
+        if (++rejects < params.maxRejects) return;
+        estimate.distance = z;
+        estimate.variance = r;
+        rejects = 0;
+        return;
+    }
+    rejects = 0;
+    float k = estimate.variance / s;
+    estimate.distance += k * innovation;
+    estimate.variance *= 1 - k;
+}
+
+#pragma endregion
@@ -0,0 +1,64 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include "HAL.h"
+#include "Snapshot.h"
+#include "Sensor.h"
+
+namespace Navigation
+{
+    /// @brief The fused distance to the wall ahead
+    struct WallEstimate {
+        float distance;             //Meters from the sensor to the wall ahead, -1 when no wall is in range
+        float variance;             //m^2
+        uint64_t sinceMeasurement_us;   //Since the last echo that corrected the estimate
+        uint64_t timestamp_us;      //Time of the counts the estimate was moved to
+    };
+
+    /// @brief Noise model of the wall distance estimator
+    struct FusionParams {
+        float metersPerCount;           //Wheel travel per encoder count
+        float trackWidth = 0.15f;       //Meters between the wheel contact points
+        float measurementNoise = 0.0001f;   //Echo variance in m^2, 1 cm sigma
+        float slip = 0.0004f;           //Variance in m^2 per meter driven, 2 cm sigma per meter
+        float turnNoise = 1.0f;         //Variance in m^2 per radian turned, the wall ahead changes as the robot turns
+        float gate = 3.0f;              //Echoes further than this many sigmas from the estimate are rejected
+        int maxRejects = 3;             //Rejected echoes in a row after which the estimate restarts from the echo
+    };
+
+    /// @brief A one state Kalman filter of the distance to the wall ahead. Predict runs at the encoder rate and
+    /// @brief takes the distance driven off, Correct runs when an echo lands and moves the estimate towards it.
+    /// @brief Turning makes the estimate uncertain, since the sensor then faces another part of the wall.
+    /// @brief One writer calls Update, any core reads the estimate through Snapshot.
+    class WallEstimator {
+        public:
+            WallEstimator(FusionParams params);
+
+            WallEstimate Update(int32_t leftCounts, int32_t rightCounts, uint64_t timestamp_us, const Sensor::DistanceReading& reading);
+            void Predict(int32_t leftCounts, int32_t rightCounts, uint64_t timestamp_us);
+            void Correct(const Sensor::DistanceReading& reading);
+
+            /// @brief The estimate of the last Update, tear-free from either core
+            WallEstimate Snapshot() { return published.Read(); }
+
+            /// @brief Echoes rejected by the gate so far
+            uint32_t Rejected() { return rejected; }
+
+        protected:
+            WallEstimator() = delete;
+
+            FusionParams params;
+            WallEstimate estimate;
+            bool haveCounts;
+            int32_t lastLeft;
+            int32_t lastRight;
+            float speed;                //m/s over the last Predict, to move late echoes to now
+            uint32_t lastSequence;
+            uint64_t measured_us;
+            int rejects;
+            uint32_t rejected;
+            Buffer::Seqlock<WallEstimate> published;
+    };
+} // namespace Navigation
+
+#endif
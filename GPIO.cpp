@@ -1,4 +1,6 @@
 #include "GPIO.h"
+#include "Trace.h"
+#include "Recorder.h"
 
 #pragma region PIN
 
@@ -62,27 +64,55 @@ void GPIO::PIN::SetPulls(bool PullUp, bool PullDown){
     gpio_set_pulls(pinID, PullUp, PullDown);
 }
 
-/// @brief Define the static callback array
-std::function<void(uint32_t)> GPIO::PIN::pinCallBack[NUM_BANK0_GPIOS];
-
-void GPIO::PIN::SetIRQ(uint32_t eventMask, std::function<void(uint32_t)> callback) {
-    pinCallBack[pinID] = callback;
+/// @brief Define the static dispatch table, shared by both cores
+#ifdef P2_HOST
+thread_local GPIO::IrqSlot GPIO::PIN::pinCallBack[NUM_BANK0_GPIOS];
+#else
+GPIO::IrqSlot GPIO::PIN::pinCallBack[NUM_BANK0_GPIOS];
+#endif
+
+/// @brief Sets the handler called from the GPIO IRQ for this pin, and enables the given events
+/// @param eventMask The GPIO_IRQ_ events to enable
+/// @param handler The function to call, it gets the context and the event mask
+/// @param context The pointer handed back to the handler, usually the owning object
+void GPIO::PIN::SetIRQ(uint32_t eventMask, IrqHandler handler, void* context) {
+    //Clear the handler first so the other core never sees a new context with an old handler
+    pinCallBack[pinID].handler = nullptr;
+    std::atomic_thread_fence(std::memory_order_release);
+    pinCallBack[pinID].context = context;
+    std::atomic_thread_fence(std::memory_order_release);
+    pinCallBack[pinID].handler = handler;
 
     gpio_set_irq_enabled(pinID, eventMask, true);
 }
 
+/// @brief Sets a plain function as the handler called from the GPIO IRQ for this pin
+/// @param eventMask The GPIO_IRQ_ events to enable
+/// @param callback The function to call with the event mask
+void GPIO::PIN::SetIRQ(uint32_t eventMask, void (*callback)(uint32_t)) {
+    SetIRQ(eventMask, &FunctionTrampoline, (void*)callback);
+}
+
 void GPIO::PIN::DisableIRQ() {
-    pinCallBack[pinID] = nullptr;
     gpio_set_irq_enabled(pinID, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE | GPIO_IRQ_LEVEL_HIGH | GPIO_IRQ_LEVEL_LOW, false);
-
+    pinCallBack[pinID].handler = nullptr;
 }
 
-void GPIO::PIN::MasterCallback(uint pin, uint32_t eventMask) {
-    
-    if (pinCallBack[pin]) {
-        pinCallBack[pin](eventMask);
+/// @brief The one callback registered with the SDK, looks the pin up in the dispatch table
+void P2_IRQ_FUNC(GPIO::PIN::MasterCallback)(uint pin, uint32_t eventMask) {
+    TRACE_BEGIN(GpioIrq, pin);
+    RECORD_EDGE(pin, eventMask);
+    IrqHandler handler = pinCallBack[pin].handler;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (handler) {
+        handler(pinCallBack[pin].context, eventMask);
     }
+    TRACE_END(GpioIrq, pin);
+}
 
+/// @brief Calls a plain function stored as the context
+void GPIO::PIN::FunctionTrampoline(void* context, uint32_t events) {
+    ((void (*)(uint32_t))context)(events);
 }
 
 
@@ -4,15 +4,21 @@
 
 
 #include <stdio.h>
-#include "pico/stdlib.h" 
-#include "hardware/pwm.h"
-#include "hardware/clocks.h"
+#include "HAL.h"
 #include <cassert>
 #include <atomic>
-#include <functional>
 
 namespace GPIO
 {
+    /// @brief Handler signature of the IRQ dispatch table, the context is the object the handler belongs to
+    typedef void (*IrqHandler)(void* context, uint32_t events);
+
+    /// @brief One entry of the IRQ dispatch table, a plain function pointer plus its context
+    struct IrqSlot {
+        IrqHandler handler;
+        void* context;
+    };
+
     class PIN {
         public:
             PIN(uint pin, bool output);
@@ -29,7 +35,19 @@ namespace GPIO
 
             virtual void SetPulls(bool PullUp, bool PullDown);
 
-            void SetIRQ(uint32_t eventMask, std::function<void(uint32_t)> callback);
+            void SetIRQ(uint32_t eventMask, IrqHandler handler, void* context);
+
+            void SetIRQ(uint32_t eventMask, void (*callback)(uint32_t));
+
+            /// @brief Binds a member function as the IRQ handler without any allocation
+            /// @tparam T The class the handler belongs to
+            /// @tparam Method The member function to call with the event mask
+            /// @param eventMask The events to enable
+            /// @param object The object to call the handler on
+            template <class T, void (T::*Method)(uint32_t)>
+            void SetIRQ(uint32_t eventMask, T* object) {
+                SetIRQ(eventMask, &MemberTrampoline<T, Method>, object);
+            }
 
             void DisableIRQ();
 
@@ -43,10 +61,22 @@ namespace GPIO
             
 
         private:
-            static std::function<void(uint32_t)> pinCallBack[NUM_BANK0_GPIOS];
+#ifdef P2_HOST
+            //Per thread on the host like HostHAL's state, so every thread is its own robot
+            static thread_local IrqSlot pinCallBack[NUM_BANK0_GPIOS];
+#else
+            static IrqSlot pinCallBack[NUM_BANK0_GPIOS];
+#endif
 
             static void MasterCallback(uint, uint32_t);
 
+            static void FunctionTrampoline(void* context, uint32_t events);
+
+            template <class T, void (T::*Method)(uint32_t)>
+            static void MemberTrampoline(void* context, uint32_t events) {
+                (static_cast<T*>(context)->*Method)(events);
+            }
+
     };
 
     class LED : PIN {
@@ -0,0 +1,23 @@
+//Hardware abstraction seam. Every class includes this instead of the Pico SDK headers directly,
+//so the same sources can be built for the robot or for the Linux host (P2_HOST) against HostHAL.
+#ifndef HAL_H
+#define HAL_H
+
+#ifdef P2_HOST
+#include "HostHAL.h"
+#else
+#include "pico/stdlib.h"
+#include "hardware/pwm.h"
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#endif
+
+//Define P2_IRQ_IN_RAM to run the IRQ dispatch from RAM instead of XIP flash, so a cache miss never delays an edge
+#ifdef P2_IRQ_IN_RAM
+#define P2_IRQ_FUNC(func_name) __not_in_flash_func(func_name)
+#else
+#define P2_IRQ_FUNC(func_name) func_name
+#endif
+
+#endif
@@ -0,0 +1,1859 @@
+//Host side benchmarks of the firmware classes, built with -DP2_HOST=ON
+//Usage: p2_bench [name] [iterations]
+//       p2_bench odometry [runs] [capture.bin]   replays the encoder counts of a telemetry capture
+//       p2_bench trace [records] [dump.bin]      saves the trace dump, p2_trace dump.bin trace.json shows it
+//       p2_bench replay [runs] [capture.bin]     saves the synthetic recording, p2_replay capture.bin replays it
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include "Snapshot.h"
+#include "HAL.h"
+#include "DriveTrain.h"
+#include "Sensor.h"
+#include "Control.h"
+#include "Board.h"
+#include "Static.h"
+#include "Scheduler.h"
+#include "Channel.h"
+#include "Messages.h"
+#include "Telemetry.h"
+#include "Velocity.h"
+#include "Odometry.h"
+#include "Fusion.h"
+#include "Power.h"
+#include "Coverage.h"
+#include "Trace.h"
+#include "Recorder.h"
+#include "Replay.h"
+#include "HostSim.h"
+#include "Sweep.h"
+#include "SelfTest.h"
+#include "Fade.h"
+
+#pragma region Helpers
+
+/// @brief Wall clock seconds, used to time the benches themselves
+static double WallSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// @brief Plays one ultrasonic echo for the given distance on the echo pin
+static void Echo(uint echoPin, float meters) {
+    HostHAL::SetInput(echoPin, true);
+    HostHAL::Advance((uint64_t)(meters * 100.0f * 58.0f));
+    HostHAL::SetInput(echoPin, false);
+}
+
+#pragma endregion
+
+#pragma region Benches
+
+/// @brief Runs the core1 WORK mode logic against a wall that approaches and recedes
+static int BenchControl(long iterations) {
+    using Board::Role;
+    using Board::PinOf;
+    HostHAL::Reset();
+    Drivetrain::DualMotor Drive(PinOf(Role::MotorStandby),
+        PinOf(Role::LeftMotorPWM), PinOf(Role::LeftMotorIn1), PinOf(Role::LeftMotorIn2),
+        PinOf(Role::RightMotorPWM), PinOf(Role::RightMotorIn1), PinOf(Role::RightMotorIn2));
+    Sensor::Distance DistanceSensor(PinOf(Role::DistanceTrigger), PinOf(Role::DistanceEcho));
+    Control::Bouncer Bouncer(Drive);
+
+    float wall = 2.0f;
+    long turns = 0;
+    double start = WallSeconds();
+    for (long i = 0; i < iterations; i++) {
+        if (i % 8 == 0) {
+            Echo(Board::Pin<Role::DistanceEcho>::id, wall);
+        }
+        Bouncer.Step(DistanceSensor.GetDistance(), i * 0.01f);
+        if (Bouncer.TurnTicks() == 1) turns++;
+
+        //The robot closes on the wall while driving forward and the wall resets after each turn
+        wall = Bouncer.TurnTicks() == 0 ? wall - 0.005f : 2.0f;
+        HostHAL::Advance(10000);
+    }
+    double elapsed = WallSeconds() - start;
+
+    //The compile time slice map must match the SDK lookup
+    for (const Board::PinAssignment& p : Board::pins) {
+        if (Board::SliceOf(p.pin) != pwm_gpio_to_slice_num(p.pin) || Board::ChannelOf(p.pin) != pwm_gpio_to_channel(p.pin)) {
+            printf("control: board pin map disagrees with the PWM slice lookup on GPIO %u\n", p.pin);
+            return 1;
+        }
+    }
+
+    printf("control: %ld ticks in %.3f s, %.0f ticks/s, %.0fx real time, %ld turns\n",
+        iterations, elapsed, iterations / elapsed, iterations * 0.01 / elapsed, turns);
+    return 0;
+}
+
+/// @brief Times the control step and raw drive calls through the virtual and the Static drivetrain
+template <class DriveT>
+static double TimeDrive(DriveT& drive, long iterations, double& stepNs) {
+    Control::Bouncer<DriveT> Bouncer(drive);
+    double start = WallSeconds();
+    for (long i = 0; i < iterations; i++) {
+        //A wall every 200 ticks, so every branch of the step runs
+        Bouncer.Step(i % 200 < 150 ? 2.0f : 0.3f, 0);
+    }
+    stepNs = (WallSeconds() - start) * 1e9 / iterations;
+
+    //Through a pointer the compiler can not see through, like the control loop holding a reference
+    DriveT* volatile indirect = &drive;
+    start = WallSeconds();
+    for (long i = 0; i < iterations; i++) {
+        indirect->Forward((i & 1) ? 0.25f : 0.5f);
+    }
+    return (WallSeconds() - start) * 1e9 / iterations;
+}
+
+static int BenchDispatch(long iterations) {
+    using Board::Role;
+    using Board::PinOf;
+    HostHAL::Reset();
+    double virtualStep, staticStep, virtualForward, staticForward;
+    //One drivetrain at a time, each takes the PWM wrap interrupt
+    {
+        Drivetrain::DualMotor VirtualDrive(PinOf(Role::MotorStandby),
+            PinOf(Role::LeftMotorPWM), PinOf(Role::LeftMotorIn1), PinOf(Role::LeftMotorIn2),
+            PinOf(Role::RightMotorPWM), PinOf(Role::RightMotorIn1), PinOf(Role::RightMotorIn2));
+        virtualForward = TimeDrive(VirtualDrive, iterations, virtualStep);
+    }
+
+    HostHAL::Reset();
+    {
+        Static::BoardDualMotor StaticDrive;
+        staticForward = TimeDrive(StaticDrive, iterations, staticStep);
+    }
+
+    printf("dispatch: Forward virtual %.2f ns static %.2f ns, Bouncer::Step virtual %.2f ns static %.2f ns\n",
+        virtualForward, staticForward, virtualStep, staticStep);
+    return 0;
+}
+
+/// @brief A task for BenchScheduler, burns virtual time and now and then runs long
+struct LoadTask {
+    uint32_t work_us;
+    uint32_t spikeEvery;
+    uint32_t spike_us;
+    uint32_t runs;
+};
+
+static void LoadTask_run(void* context) {
+    LoadTask* task = (LoadTask*)context;
+    task->runs++;
+    busy_wait_us(task->spikeEvery != 0 && task->runs % task->spikeEvery == 0 ? task->spike_us : task->work_us);
+}
+
+/// @brief Runs the firmware's task set for a virtual minute: control 100 Hz, LEDs 50 Hz, blink 20 Hz, telemetry 10 Hz.
+/// @brief Telemetry now and then takes 25 ms to show overrun and lateness counting
+static int BenchScheduler(long iterations) {
+    HostHAL::Reset();
+    LoadTask control = {800, 0, 0, 0};
+    LoadTask leds = {50, 0, 0, 0};
+    LoadTask blink = {5, 0, 0, 0};
+    LoadTask telemetry = {400, 50, 25000, 0};
+
+    Tasks::Scheduler scheduler;
+    scheduler.Add("control", &LoadTask_run, &control, 10000, 0, 2000);
+    scheduler.Add("leds", &LoadTask_run, &leds, 20000, 1, 1000);
+    scheduler.Add("blink", &LoadTask_run, &blink, 50000, 1, 500);
+    scheduler.Add("telemetry", &LoadTask_run, &telemetry, 100000, 2, 5000);
+
+    double start = WallSeconds();
+    uint64_t end = time_us_64() + 60ull * 1000000ull;
+    scheduler.RunUntil(end);
+    double elapsed = WallSeconds() - start;
+
+    printf("scheduler: 60 s virtual in %.4f s wall, %.0fx real time\n", elapsed, 60.0 / elapsed);
+    scheduler.PrintStats();
+    //Absolute deadlines, so after a minute the control task ran exactly 6000 times minus what was skipped
+    const Tasks::Task& task = scheduler.GetTask(0);
+    return task.stats.runs + task.stats.overruns == 6000 ? 0 : 1;
+}
+
+/// @brief Edge counter used as the IRQ handler by BenchIrq
+struct EdgeCounter {
+    volatile uint32_t edges = 0;
+    void Handler(uint32_t events) { edges = edges + 1; }
+};
+
+/// @brief Compares ISR entry to handler cost of the old std::function table against the function pointer table
+static int BenchIrq(long iterations) {
+    HostHAL::Reset();
+    EdgeCounter counter;
+
+    //The old dispatch, a std::function per pin filled with std::bind
+    static std::function<void(uint32_t)> oldTable[NUM_BANK0_GPIOS];
+    oldTable[10] = std::bind(&EdgeCounter::Handler, &counter, std::placeholders::_1);
+    std::function<void(uint32_t)>* volatile oldEntry = oldTable;
+    double start = WallSeconds();
+    for (long i = 0; i < iterations; i++) {
+        if (oldEntry[10]) oldEntry[10](GPIO_IRQ_EDGE_RISE);
+    }
+    double oldNs = (WallSeconds() - start) * 1e9 / iterations;
+
+    //The new dispatch, measured from the simulated GPIO IRQ through MasterCallback to the handler,
+    //minus the cost of the simulated GPIO itself on a pin without an IRQ
+    GPIO::PIN pin(10, false);
+    GPIO::PIN idlePin(11, false);
+    start = WallSeconds();
+    for (long i = 0; i < iterations; i++) {
+        HostHAL::SetInput(11, i & 1);
+    }
+    double baseNs = (WallSeconds() - start) * 1e9 / iterations;
+
+    pin.SetIRQ<EdgeCounter, &EdgeCounter::Handler>(GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, &counter);
+    start = WallSeconds();
+    for (long i = 0; i < iterations; i++) {
+        HostHAL::SetInput(10, i & 1);
+    }
+    double newNs = (WallSeconds() - start) * 1e9 / iterations - baseNs;
+
+    printf("irq: std::function dispatch %.2f ns/edge, table dispatch %.2f ns/edge, %u edges\n",
+        oldNs, newNs, counter.edges);
+    return 0;
+}
+
+/// @brief Plays a quadrature edge stream into an encoder at a given step rate, with some double steps
+/// that skip a state so the decoder has to flag them
+static int BenchQuadrature(long iterations) {
+    const uint pinA = 10, pinB = 11;
+    //Forward is A leading B: 00 -> 10 -> 11 -> 01
+    const uint8_t sequence[4] = {0b00, 0b10, 0b11, 0b01};
+    const float rates[] = {100, 5000, 50000};
+    bool ok = true;
+
+    //The same edge stream through both backends. The PIO table skips a double step like the decoder, but does not count it
+    for (Sensor::EncoderBackend backend : {Sensor::EncoderBackend::Interrupt, Sensor::EncoderBackend::Pio}) {
+        const char* name = backend == Sensor::EncoderBackend::Pio ? "pio" : "interrupt";
+        HostHAL::Reset();
+        HostHAL::SetInput(pinA, false);
+        HostHAL::SetInput(pinB, false);
+        Sensor::MotorEncoder Encoder(pinA, pinB, backend);
+        int phase = 0;
+        long expected = 0;
+        long expectedErrors = 0;
+
+        for (float rate : rates) {
+            uint64_t period_us = (uint64_t)(1000000.0f / rate);
+            long steps = iterations / 3;
+            double start = WallSeconds();
+            for (long i = 0; i < steps; i++) {
+                //Two thousand steps forward for every thousand back, so the count ends far from 0
+                int direction = (i / 1000) % 3 != 2 ? 1 : -1;
+                //Every 997th step both pins change at once, as if an edge was missed
+                int jump = i % 997 == 996 ? 2 : 1;
+                phase = (phase + direction * jump + 4) % 4;
+                if (jump == 2) {
+                    expectedErrors++;
+                } else {
+                    expected += direction;
+                }
+                HostHAL::SetInputs((1u << pinA) | (1u << pinB), ((uint32_t)(sequence[phase] >> 1) << pinA) | ((uint32_t)(sequence[phase] & 1) << pinB));
+                HostHAL::Advance(period_us > 0 ? period_us : 1);
+            }
+            double elapsed = WallSeconds() - start;
+            //The PIO count is only read on the velocity tick
+            HostHAL::Advance((uint64_t)(1e6f / Sensor::MotorEncoder::timerFrequency));
+            long errors = backend == Sensor::EncoderBackend::Pio ? 0 : expectedErrors;
+            printf("quadrature: %-9s %.0f steps/s, %ld steps in %.3f s, count %d expected %ld, errors %u expected %ld\n",
+                name, rate, steps, elapsed, Encoder.Counts(), expected, Encoder.ErrorCounts(), errors);
+            ok = ok && Encoder.Counts() == expected && (long)Encoder.ErrorCounts() == errors;
+        }
+    }
+    HostHAL::Reset();
+    return ok ? 0 : 1;
+}
+
+/// @brief Plays echoes of a wall 1-2 m away with occasional ghost echoes, and counts how often
+/// the raw and the filtered distance would have read as a wall under 0.55 m
+static int BenchEcho(long iterations) {
+    HostHAL::Reset();
+    Sensor::Distance DistanceSensor(9, 8);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> uniform(0, 1);
+    std::normal_distribution<float> noise(0, 0.01f);
+
+    long rawFalseWalls = 0;
+    long filteredFalseWalls = 0;
+    float confidence = 0;
+    double start = WallSeconds();
+    for (long i = 0; i < iterations; i++) {
+        float wall = 1.5f + 0.5f * std::sin(i * 0.001f) + noise(random);
+        //3% ghost echoes from the floor or a cable
+        float echo = uniform(random) < 0.03f ? 0.1f + 0.3f * uniform(random) : wall;
+        Echo(8, echo);
+        Sensor::DistanceReading reading = DistanceSensor.GetReading();
+        if (echo < 0.55f) rawFalseWalls++;
+        if (reading.distance >= 0 && reading.distance < 0.55f) filteredFalseWalls++;
+        confidence += reading.confidence;
+        HostHAL::Advance(83333);
+    }
+    double elapsed = WallSeconds() - start;
+
+    printf("echo: %ld echoes in %.3f s, false walls raw %ld filtered %ld, mean confidence %.3f\n",
+        iterations, elapsed, rawFalseWalls, filteredFalseWalls, confidence / iterations);
+    return filteredFalseWalls < rawFalseWalls ? 0 : 1;
+}
+
+/// @brief One velocity step response, closed or open loop
+struct StepResult {
+    float settling_s;   //Last time a wheel was outside 5% of the setpoint
+    float rmsError;     //Wheel speed error over the second half
+    float meanSpeed;    //Both wheels over the second half
+    float heading_deg;  //Heading change at the end, 0 for a straight line
+};
+
+static StepResult RunStep(bool closedLoop, float battery, float setpoint) {
+    using Board::Role;
+    using Board::PinOf;
+    HostHAL::Reset();
+    HostHAL::SetInputs(0xffffffffu, 0);
+
+    Sim::MotorModel left = {PinOf(Role::LeftMotorPWM), PinOf(Role::LeftMotorIn1), PinOf(Role::LeftMotorIn2),
+        PinOf(Role::LeftEncoderA), PinOf(Role::LeftEncoderB), 1.0f, 0, 0, 0};
+    Sim::MotorModel right = {PinOf(Role::RightMotorPWM), PinOf(Role::RightMotorIn1), PinOf(Role::RightMotorIn2),
+        PinOf(Role::RightEncoderA), PinOf(Role::RightEncoderB), 0.9f, 0, 0, 0};
+
+    Drivetrain::DualMotor drive(PinOf(Role::MotorStandby), left.pwmPin, left.in1Pin, left.in2Pin, right.pwmPin, right.in1Pin, right.in2Pin);
+    Sensor::MotorEncoder leftEncoder(left.encoderA, left.encoderB);
+    Sensor::MotorEncoder rightEncoder(right.encoderA, right.encoderB);
+    Control::VelocityDrive<Drivetrain::DualMotor> wheels(drive, leftEncoder, rightEncoder);
+
+    const float duration = 2.0f, dt = 50e-6f, trackWidth = Control::VelocityParams().trackWidth;
+    drive.SetState(1);
+    if (closedLoop) {
+        wheels.Forward(setpoint / Sim::MotorModel::topSpeed);
+    } else {
+        drive.Forward(setpoint / Sim::MotorModel::topSpeed);
+    }
+
+    StepResult result = {0, 0, 0, 0};
+    double squared = 0, sum = 0, heading = 0;
+    long samples = 0;
+    long steps = (long)(duration / dt);
+    for (long i = 1; i <= steps; i++) {
+        left.Step(dt, battery);
+        right.Step(dt, battery);
+        HostHAL::Advance(50);
+        if (closedLoop && i % 200 == 0) wheels.Update();
+
+        float t = i * dt;
+        heading += (right.speed - left.speed) / trackWidth * dt;
+        if (std::fabs(left.speed - setpoint) > 0.05f * setpoint || std::fabs(right.speed - setpoint) > 0.05f * setpoint) {
+            result.settling_s = t;
+        }
+        if (t > duration / 2) {
+            squared += (left.speed - setpoint) * (left.speed - setpoint) + (right.speed - setpoint) * (right.speed - setpoint);
+            sum += left.speed + right.speed;
+            samples += 2;
+        }
+    }
+    result.rmsError = (float)std::sqrt(squared / samples);
+    result.meanSpeed = (float)(sum / samples);
+    result.heading_deg = (float)(heading * 180 / M_PI);
+    HostHAL::Reset();
+    return result;
+}
+
+/// @brief Step responses of the wheel velocity loop against the motor model. The right motor is 10% weaker,
+/// @brief and the battery is run full and at 75%, open loop duty against Control::VelocityDrive
+static int BenchVelocity(long iterations) {
+    const float setpoint = 0.25f;
+    int failed = 0;
+    for (float battery : {1.0f, 0.75f}) {
+        for (bool closedLoop : {false, true}) {
+            StepResult r = RunStep(closedLoop, battery, setpoint);
+            printf("velocity: %-6s battery %3.0f%%  setpoint %.2f m/s  mean %.3f m/s  settling %s%.2f s  rms error %.4f m/s  heading %+6.1f deg\n",
+                closedLoop ? "closed" : "open", battery * 100, setpoint, r.meanSpeed,
+                r.settling_s >= 1.99f ? ">" : " ", r.settling_s, r.rmsError, r.heading_deg);
+            if (closedLoop && (r.settling_s > 0.5f || std::fabs(r.meanSpeed - setpoint) > 0.01f)) failed = 1;
+        }
+    }
+    return failed;
+}
+
+/// @brief Velocity estimates of two encoders fed the same edges, against the true wheel speed
+struct EdgeStreamResult {
+    double countsRms, hybridRms;    //rad/s over the samples
+    long samples;
+    float countsLast, hybridLast;   //At the end of the stream
+};
+
+/// @brief Plays a quadrature edge stream for a wheel speed profile onto pins 10-11, counted by the tick, and 12-13,
+/// @brief timed by the edges. Each edge comes at the exact microsecond the wheel crosses it, with the edges of a
+/// @brief cycle moved by up to 0.08 counts like a real encoder's uneven duty and phase. Samples both estimates
+/// @brief just after each velocity tick from skip_s on
+static EdgeStreamResult PlayEdgeStream(const std::function<float(float)>& speed, float seconds, float skip_s) {
+    HostHAL::Reset();
+    const uint8_t sequence[4] = {0b00, 0b10, 0b11, 0b01};
+    const float offsets[4] = {0, 0.08f, -0.05f, 0.03f};
+    const float countsPerRadian = Sensor::MotorEncoder::encoderCPR * Sensor::MotorEncoder::gearRatio / (2 * (float)M_PI);
+    const uint32_t mask = 0xfu << 10;
+    HostHAL::SetInputs(mask, 0);
+    Sensor::MotorEncoder counted(10, 11);
+    Sensor::MotorEncoder hybrid(12, 13, Sensor::EncoderBackend::Interrupt, Sensor::VelocityMethod::Hybrid);
+
+    EdgeStreamResult r = {0, 0, 0, 0, 0};
+    double position = 0;            //Counts
+    long edge = 0;                  //Index of the last edge played
+    const uint64_t segment_us = 1000, end_us = (uint64_t)(seconds * 1e6f);
+    uint64_t now = 0, nextSample = 10001;
+    while (now < end_us) {
+        uint64_t segmentEnd = std::min(end_us, (now / segment_us + 1) * segment_us);
+        double v = speed(now * 1e-6f) * countsPerRadian;
+        while (now < segmentEnd) {
+            //The next edge ahead in the direction of travel, its position moved by the phase error
+            long next = v >= 0 ? edge + 1 : edge - 1;
+            double at = next + offsets[((next % 4) + 4) % 4];
+            double until = v != 0 ? (at - position) / v : 1e9;
+            uint64_t edgeTime = until >= 0 && until < 1e3 ? now + (uint64_t)std::ceil(until * 1e6) : UINT64_MAX;
+            uint64_t stop = std::min(std::min(segmentEnd, nextSample), edgeTime);
+            position += v * (stop - now) * 1e-6;
+            HostHAL::AdvanceTo(stop);
+            now = stop;
+            if (stop == edgeTime) {
+                edge = next;
+                uint8_t ab = sequence[((edge % 4) + 4) % 4];
+                uint32_t pins = ((uint32_t)(ab >> 1) << 10) | ((uint32_t)(ab & 1) << 11);
+                HostHAL::SetInputs(mask, pins | pins << 2);
+            }
+            if (stop == nextSample) {
+                nextSample += 10000;
+                float truth = speed(now * 1e-6f);
+                r.countsLast = counted.Snapshot().angularVelocity;
+                r.hybridLast = hybrid.Snapshot().angularVelocity;
+                if (now * 1e-6f < skip_s) continue;
+                r.countsRms += (r.countsLast - truth) * (r.countsLast - truth);
+                r.hybridRms += (r.hybridLast - truth) * (r.hybridLast - truth);
+                r.samples++;
+            }
+        }
+    }
+    r.countsRms = std::sqrt(r.countsRms / std::max(1L, r.samples));
+    r.hybridRms = std::sqrt(r.hybridRms / std::max(1L, r.samples));
+    HostHAL::Reset();
+    return r;
+}
+
+/// @brief Plays synthetic edge streams at steady wheel speeds from a crawl to full speed, a ramp and a stop, and
+/// @brief compares the count difference velocity with the hybrid edge period one. Then times EdgeVelocity itself
+static int BenchEdges(long iterations) {
+    int failed = 0;
+    for (float speed : {0.05f, 0.2f, 1.0f, 5.0f, 20.0f}) {
+        EdgeStreamResult r = PlayEdgeStream([speed](float) { return speed; }, 3, 0.5f);
+        printf("edges: %5.2f rad/s  counts %.4f rad/s RMS  hybrid %.4f rad/s RMS  (%ld ticks)\n", speed, r.countsRms, r.hybridRms, r.samples);
+        if (speed < 2 && r.hybridRms * 3 > r.countsRms) failed = 1;
+        if (r.hybridRms > r.countsRms * 1.2 + 0.01) failed = 1;
+    }
+
+    //Up to 10 rad/s in 2 s, back down in 2 s, then standing still
+    auto ramp = [](float t) { return t < 2 ? 5 * t : t < 4 ? 10 - 5 * (t - 2) : 0.0f; };
+    EdgeStreamResult r = PlayEdgeStream(ramp, 4.0f, 0);
+    printf("edges: ramp 0-10-0 rad/s  counts %.4f rad/s RMS  hybrid %.4f rad/s RMS\n", r.countsRms, r.hybridRms);
+    EdgeStreamResult stopped = PlayEdgeStream(ramp, 4.0f + Sensor::EdgeVelocityParams().stopTimeout_us * 1e-6f + 0.02f, 4.0f);
+    printf("edges: after stopping  counts %.4f rad/s  hybrid %.4f rad/s, %.4f RMS while it decays\n", stopped.countsLast, stopped.hybridLast, stopped.hybridRms);
+    if (r.hybridRms > r.countsRms || stopped.hybridLast != 0) failed = 1;
+
+    //The tick side on its own, an edge every other call
+    Sensor::EdgeVelocity estimator;
+    volatile float sink = 0;
+    double start = WallSeconds();
+    for (long i = 0; i < iterations; i++) {
+        if (i & 1) estimator.Edge(1, (uint64_t)i * 5000);
+        sink = sink + estimator.Update((uint64_t)i * 10000);
+    }
+    printf("edges: EdgeVelocity::Update %.1f ns a tick on the host\n", (WallSeconds() - start) * 1e9 / iterations);
+    return failed;
+}
+
+/// @brief Encoder counts at one instant, what Odometry is replayed from
+struct CountSample {
+    uint64_t timestamp_us;
+    int32_t left;
+    int32_t right;
+};
+
+/// @brief 100 Hz counts of a 1 m square driven at 0.25 m/s, spinning left in place at the corners.
+/// @brief Each wheel slips with the variance the odometry model assumes
+static std::vector<CountSample> SquareLog(std::mt19937& random, float slip) {
+    const float metersPerCount = Sensor::MotorEncoder::metersPerCount, track = 0.15f, speed = 0.25f, dt = 0.01f;
+    std::normal_distribution<float> noise(0, 1);
+    std::vector<CountSample> log;
+    double left = 0, right = 0;
+    uint64_t t = 0;
+    auto drive = [&](float leftSpeed, float rightSpeed, float seconds) {
+        //Whole ticks, slowed a touch so the move comes out exact
+        int ticks = (int)std::ceil(seconds / dt);
+        for (int i = 0; i < ticks; i++) {
+            float dl = leftSpeed * seconds / ticks, dr = rightSpeed * seconds / ticks;
+            left += dl + noise(random) * std::sqrt(slip * std::fabs(dl));
+            right += dr + noise(random) * std::sqrt(slip * std::fabs(dr));
+            t += 10000;
+            log.push_back({t, (int32_t)std::lround(left / metersPerCount), (int32_t)std::lround(right / metersPerCount)});
+        }
+    };
+    log.push_back({0, 0, 0});
+    for (int side = 0; side < 4; side++) {
+        drive(speed, speed, 1.0f / speed);
+        drive(-speed, speed, (float)M_PI / 2 * track / 2 / speed);
+    }
+    return log;
+}
+
+static Navigation::Pose ReplayCounts(const std::vector<CountSample>& log) {
+    Navigation::Odometry odometry({Sensor::MotorEncoder::metersPerCount});
+    for (const CountSample& sample : log) odometry.Update(sample.left, sample.right, sample.timestamp_us);
+    return odometry.Snapshot();
+}
+
+/// @brief Replays square drives through Odometry. Without slip the pose must close the square, with slip the
+/// @brief spread of the final poses over many runs must match the covariance the odometry predicts.
+/// @brief With a capture file, replays its encoder counts instead
+static int BenchOdometry(long iterations, const char* capture) {
+    if (capture) {
+        FILE* file = fopen(capture, "rb");
+        if (!file) {
+            printf("odometry: can not open %s\n", capture);
+            return 1;
+        }
+        std::vector<CountSample> log;
+        Telemetry::Decoder decoder;
+        Telemetry::Frame frame;
+        int byte;
+        while ((byte = fgetc(file)) != EOF) {
+            decoder.Push((uint8_t)byte);
+            while (decoder.Next(frame)) {
+                Telemetry::Record record;
+                if (frame.type == Telemetry::FrameType::State && Telemetry::DecodeRecord(frame.payload, frame.length, record)) {
+                    log.push_back({record.timestamp_us, record.leftCounts, record.rightCounts});
+                }
+            }
+        }
+        fclose(file);
+        Navigation::Pose pose = ReplayCounts(log);
+        printf("odometry: %zu samples, x %.3f m  y %.3f m  heading %.1f deg  travelled %.2f m\n",
+            log.size(), pose.x, pose.y, pose.heading * 180 / M_PI, pose.distance);
+        return 0;
+    }
+
+    std::mt19937 random(11);
+    std::vector<CountSample> exact = SquareLog(random, 0);
+    double start = WallSeconds();
+    Navigation::Pose pose = ReplayCounts(exact);
+    double updateNs = (WallSeconds() - start) / exact.size() * 1e9;
+    printf("odometry: exact square, %zu updates at %.0f ns, end x %+.4f m  y %+.4f m  heading %+.2f deg  travelled %.3f m\n",
+        exact.size(), updateNs, pose.x, pose.y, pose.heading * 180 / M_PI, pose.distance);
+    bool closed = std::fabs(pose.x) < 0.01f && std::fabs(pose.y) < 0.01f && std::fabs(pose.heading) < 0.01f;
+
+    //Monte Carlo against the predicted covariance
+    const float slip = Navigation::OdometryParams().slip;
+    long runs = iterations < 500 ? iterations : 500;
+    long insideX = 0, insideHeading = 0;
+    Navigation::Pose predicted = {};
+    for (long run = 0; run < runs; run++) {
+        std::vector<CountSample> log = SquareLog(random, slip);
+        //The truth is the exact square, so the replayed pose is the error
+        Navigation::Pose noisy = ReplayCounts(log);
+        predicted = noisy;
+        if (std::fabs(noisy.x) < 2 * std::sqrt(noisy.covariance[0])) insideX++;
+        if (std::fabs(noisy.heading) < 2 * std::sqrt(noisy.covariance[5])) insideHeading++;
+    }
+    printf("odometry: %ld slipping squares, predicted sigma x %.3f m  y %.3f m  heading %.1f deg, inside 2 sigma x %.0f%%  heading %.0f%%\n",
+        runs, std::sqrt(predicted.covariance[0]), std::sqrt(predicted.covariance[3]), std::sqrt(predicted.covariance[5]) * 180 / M_PI,
+        100.0 * insideX / runs, 100.0 * insideHeading / runs);
+    return closed ? 0 : 1;
+}
+
+/// @brief Covers a 3 x 2 m cell with the zig-zag follower and with the bounce strategy of the firmware, both on
+/// @brief the velocity loop in Sim, and compares the area covered per second and per kilojoule. The bouncer gets three
+/// @brief times as long as the zig-zag took and is also measured at the time the zig-zag finished
+static int BenchCoverage(long iterations) {
+    (void)iterations;
+    //The sweep starts in the corner at the origin, the first lane along the wall
+    Sim::WorldParams world;
+    world.startX = 0.1f;
+    world.startY = world.sweptWidth / 2;
+    Navigation::CoverageParams area = {2.8f, 2.0f, 0.16f, 0.02f};
+    Navigation::ZigZagPlanner planner(area);
+    Navigation::ZigZagFollower follower(planner);
+    const float lowBatteryTime = Control::BounceParams().lowBatteryTime;
+
+    double start = WallSeconds();
+    Sim::EpisodeResult zigzag = Sim::Run(world, 1, 600, [&](Sim::Core1& core1, float distance, float time) {
+        //The planner frame is the cell frame moved along by startX, so the first lane starts under the robot
+        Navigation::Pose pose = core1.odometry.Snapshot();
+        pose.x -= world.startX;
+        Navigation::Twist twist = follower.Step(pose, distance, time < lowBatteryTime ? 1.0f : 0.5f);
+        core1.wheels.SetState(1);
+        core1.wheels.SetVelocity(twist.linear, twist.angular);
+        if (follower.Done()) core1.wheels.Stop();
+        core1.wheels.Update();
+        return follower.Done();
+    });
+    printf("coverage: zig-zag %d lanes %.2f m apart, %s after %.0f s, covered %.2f m^2 (%.1f%%)  %.0f J  wall contact %ld ticks\n",
+        planner.Lanes(), planner.LaneSpacing(), follower.Done() ? "done" : "not done", zigzag.seconds, zigzag.area,
+        zigzag.fraction * 100, zigzag.joules, zigzag.wallTicks);
+
+    Sim::EpisodeResult atZigzag = {};
+    //The bouncer needs the drive, which only exists inside the run
+    std::optional<Control::Bouncer<Control::VelocityDrive<Drivetrain::DualMotor>>> bouncer;
+    Sim::EpisodeResult bounce = Sim::Run(world, 1, 3 * zigzag.seconds, [&](Sim::Core1& core1, float distance, float time) {
+        if (!bouncer) bouncer.emplace(core1.wheels);
+        bouncer->Step(distance, time);
+        core1.wheels.Update();
+        return false;
+    }, [&](const Sim::EpisodeResult& r) {
+        if (r.seconds <= zigzag.seconds) atZigzag = r;
+    });
+    printf("coverage: bounce at %.0f s covered %.2f m^2 (%.1f%%)  %.0f J, at %.0f s covered %.2f m^2 (%.1f%%)  %.0f J  wall contact %ld ticks\n",
+        atZigzag.seconds, atZigzag.area, atZigzag.fraction * 100, atZigzag.joules,
+        bounce.seconds, bounce.area, bounce.fraction * 100, bounce.joules, bounce.wallTicks);
+
+    printf("coverage: zig-zag %.4f m^2/s  %.2f m^2/kJ,  bounce %.4f m^2/s  %.2f m^2/kJ over the same time,  %.4f m^2/s  %.2f m^2/kJ over %.0f s, %.1f s to run\n",
+        zigzag.area / zigzag.seconds, zigzag.area / zigzag.joules * 1000,
+        atZigzag.area / atZigzag.seconds, atZigzag.area / atZigzag.joules * 1000,
+        bounce.area / bounce.seconds, bounce.area / bounce.joules * 1000, bounce.seconds, WallSeconds() - start);
+    return follower.Done() && zigzag.fraction > 0.9f && zigzag.area / zigzag.joules > bounce.area / bounce.joules ? 0 : 1;
+}
+
+/// @brief Checks the simulated sonar against the firmware's distance sensor with the robot standing square on to
+/// @brief a wall, then runs 60 s firmware bounce episodes in the cell on the raw drive and on the velocity loop,
+/// @brief checks a seed replays identically and reports the episodes per minute on one thread
+static int BenchSim(long iterations) {
+    (void)iterations;
+    const int episodes = 20;
+    Sim::WorldParams standing;
+    standing.startX = 1.0f;
+    standing.startY = 1.0f;
+    float expected = standing.length - standing.startX - standing.sonar.sensorOffset;
+    double error = 0;
+    long readings = 0;
+    Sim::EpisodeResult still = Sim::Run(standing, 1, 5, [&](Sim::Core1&, float distance, float time) {
+        if (time > 0.5f && distance > 0) {
+            error += std::fabs(distance - expected);
+            readings++;
+        }
+        return false;
+    });
+    printf("sim: sonar square on to a wall at %.3f m, %ld echoes %ld missed, mean error %.1f mm\n",
+        expected, still.echoes, still.missed, readings ? error / readings * 1000 : -1.0);
+
+    int failed = readings > 0 && error / readings < 0.005 ? 0 : 1;
+    for (bool velocityControl : {false, true}) {
+        double collisions = 0, fraction = 0, joules = 0, simulated = 0;
+        double start = WallSeconds();
+        for (int seed = 1; seed <= episodes; seed++) {
+            Sim::EpisodeResult r = Sim::RunBouncer({}, seed, Control::BounceParams(), velocityControl);
+            collisions += r.collisions;
+            fraction += r.fraction;
+            joules += r.joules;
+            simulated += r.seconds;
+        }
+        double elapsed = WallSeconds() - start;
+        Sim::EpisodeResult a = Sim::RunBouncer({}, 7, Control::BounceParams(), velocityControl);
+        Sim::EpisodeResult b = Sim::RunBouncer({}, 7, Control::BounceParams(), velocityControl);
+        bool repeatable = a.collisions == b.collisions && a.area == b.area && a.joules == b.joules;
+        printf("sim: bounce %-8s %d x 60 s episodes in %.2f s, %.0f episodes/min %.0fx real time, mean %.1f collisions %.1f%% covered %.0f J, seed repeat %s\n",
+            velocityControl ? "velocity" : "duty", episodes, elapsed, episodes / elapsed * 60, simulated / elapsed,
+            collisions / episodes, fraction / episodes * 100, joules / episodes, repeatable ? "identical" : "DIFFERENT");
+        if (!repeatable) failed = 1;
+    }
+    return failed;
+}
+
+/// @brief Pings a wall square on at several distances with the fixed 12 Hz trigger and with echo re-arming, and
+/// @brief reports the echo rate each reaches. Then drives at the wall flat out from staggered starts and measures
+/// @brief how far past the 0.55 m wall distance the robot is when the filtered reading first drops under it. Last
+/// @brief the sensor ignores every fifth ping, and the longest wait for an echo is measured
+static int BenchRearm(long iterations) {
+    (void)iterations;
+    const float wallDistance = Control::BounceParams().wallDistance;
+    float closeRate = 0, silentGap_ms = 0;
+    for (Sensor::TriggerMode mode : {Sensor::TriggerMode::Fixed, Sensor::TriggerMode::Rearm}) {
+        const char* name = mode == Sensor::TriggerMode::Fixed ? "fixed" : "rearm";
+        printf("rearm: %-5s", name);
+        for (float distance : {0.3f, 1.0f, 2.0f, 3.5f}) {
+            Sim::WorldParams world;
+            world.trigger.mode = mode;
+            world.startX = world.length - world.sonar.sensorOffset - distance;
+            Sensor::TriggerStats stats = {};
+            Sim::Run(world, 1, 3, [&](Sim::Core1& core1, float, float) {
+                stats = core1.distance.GetTriggerStats();
+                return false;
+            });
+            printf("  %.1f m %5.1f Hz", distance, stats.rate);
+            if (mode == Sensor::TriggerMode::Rearm && distance < 0.5f) closeRate = stats.rate;
+        }
+
+        const int runs = 20;
+        double overshoot = 0, worst = 0, speed = 0;
+        for (int run = 0; run < runs; run++) {
+            Sim::WorldParams world;
+            world.trigger.mode = mode;
+            world.startX = 0.5f + run * 0.0137f;
+            //Matched motors drive straight, so the odometry x gives the distance to the wall
+            world.rightGain = world.leftGain;
+            float seen = -1, v = 0;
+            Sim::Run(world, run + 1, 10, [&](Sim::Core1& core1, float distance, float) {
+                core1.drive.SetState(1);
+                core1.drive.Forward(1.0f);
+                if (distance > 0 && distance < wallDistance) {
+                    Navigation::Pose pose = core1.odometry.Snapshot();
+                    seen = world.length - world.sonar.sensorOffset - pose.x;
+                    v = core1.leftEncoder.Snapshot().linearVelocity;
+                    return true;
+                }
+                return false;
+            });
+            overshoot += wallDistance - seen;
+            worst = std::max(worst, (double)(wallDistance - seen));
+            speed += v;
+        }
+        speed /= runs;
+        printf("\nrearm: %-5s at %.2f m/s the wall is seen %.0f mm late on average (%.0f ms), %.0f mm at worst\n",
+            name, speed, overshoot / runs * 1000, overshoot / runs / speed * 1000, worst * 1000);
+
+        //The echoes seen by the control ticks, so the gaps are to the 10 ms tick
+        Sim::WorldParams world;
+        world.trigger.mode = mode;
+        world.sonar.silentEvery = 5;
+        //An answered ping that finds nothing is the sensor's own 38 ms timeout, not what is measured here
+        world.sonar.dropout = 0;
+        world.startX = world.length - world.sonar.sensorOffset - 1.0f;
+        Sensor::TriggerStats stats = {};
+        uint32_t sequence = 0;
+        float last = 0, gap = 0;
+        Sim::Run(world, 1, 10, [&](Sim::Core1& core1, float, float time) {
+            Sensor::DistanceReading reading = core1.distance.Snapshot();
+            if (reading.sequence != sequence) {
+                if (sequence != 0) gap = std::max(gap, time - last);
+                sequence = reading.sequence;
+                last = time;
+            }
+            stats = core1.distance.GetTriggerStats();
+            return false;
+        });
+        printf("rearm: %-5s every fifth ping unanswered at 1.0 m: %.1f Hz, %u sent again, longest wait %.0f ms\n",
+            name, stats.rate, stats.fallbacks, gap * 1000);
+        if (mode == Sensor::TriggerMode::Rearm) silentGap_ms = gap * 1000;
+    }
+    //Without the fallback a missed ping waits out the 83 ms period
+    return closeRate >= 40 && silentGap_ms < 1000.0f / Sensor::Distance::triggerFrequency ? 0 : 1;
+}
+
+/// @brief Drives at a wall flat out with the fixed 12 Hz trigger from staggered starts and compares the last echo
+/// @brief and the fused estimate against the true distance every control tick: the error, how often the truth lies
+/// @brief within two sigmas of the estimate, and how late each sees the 0.55 m wall distance. Then runs bounce
+/// @brief episodes deciding on each
+static int BenchFusion(long iterations) {
+    (void)iterations;
+    const float wallDistance = Control::BounceParams().wallDistance;
+    const int runs = 20;
+    double heldSquares = 0, fusedSquares = 0, heldLate = 0, fusedLate = 0, fusedWorst = 0, sinceEcho = 0;
+    long ticks = 0, inside = 0, corrections = 0;
+    for (int run = 0; run < runs; run++) {
+        Sim::WorldParams world;
+        world.startX = 0.5f + run * 0.0137f;
+        //Matched motors drive straight, so the odometry x gives the true distance to the wall
+        world.rightGain = world.leftGain;
+        float heldSeen = -1, fusedSeen = -1;
+        Sim::Run(world, run + 1, 10, [&](Sim::Core1& core1, float distance, float) {
+            core1.drive.SetState(1);
+            core1.drive.Forward(1.0f);
+            float truth = world.length - world.sonar.sensorOffset - core1.odometry.Snapshot().x;
+            Navigation::WallEstimate wall = core1.wall.Snapshot();
+            //Skip the start, before the first echo and until the estimate has seen a few
+            if (distance > 0 && wall.distance >= 0 && core1.distance.GetReading().sequence > 3) {
+                heldSquares += (distance - truth) * (distance - truth);
+                fusedSquares += (wall.distance - truth) * (wall.distance - truth);
+                if ((wall.distance - truth) * (wall.distance - truth) <= 4 * wall.variance) inside++;
+                sinceEcho += wall.sinceMeasurement_us;
+                if (wall.sinceMeasurement_us == 0) corrections++;
+                ticks++;
+            }
+            if (heldSeen < 0 && distance > 0 && distance < wallDistance) heldSeen = truth;
+            if (fusedSeen < 0 && wall.distance >= 0 && wall.distance < wallDistance) fusedSeen = truth;
+            return heldSeen >= 0 && fusedSeen >= 0;
+        });
+        heldLate += wallDistance - heldSeen;
+        fusedLate += wallDistance - fusedSeen;
+        fusedWorst = std::max(fusedWorst, std::fabs((double)(wallDistance - fusedSeen)));
+    }
+    double heldRms = std::sqrt(heldSquares / ticks), fusedRms = std::sqrt(fusedSquares / ticks);
+    printf("fusion: %ld ticks, %ld echoes, the estimate is %.1f ms past its echo on average\n", ticks, corrections, sinceEcho / ticks / 1000);
+    printf("fusion: error against the truth, last echo %.1f mm RMS, fused %.1f mm RMS, truth within 2 sigma %.1f%%\n",
+        heldRms * 1000, fusedRms * 1000, 100.0 * inside / ticks);
+    printf("fusion: the wall is seen %.0f mm late on the last echo, %.1f mm on the estimate, %.1f mm at worst\n",
+        heldLate / runs * 1000, fusedLate / runs * 1000, fusedWorst * 1000);
+
+    const int episodes = 20;
+    for (bool fusion : {false, true}) {
+        Sim::WorldParams world;
+        world.wallFusion = fusion;
+        double collisions = 0, wallTicks = 0, covered = 0;
+        for (int seed = 1; seed <= episodes; seed++) {
+            Sim::EpisodeResult r = Sim::RunBouncer(world, seed, Control::BounceParams(), true);
+            collisions += r.collisions;
+            wallTicks += r.wallTicks;
+            covered += r.fraction;
+        }
+        printf("fusion: bouncer on the %-8s %.2f collisions, %.0f wall ticks, %.1f%% covered per episode\n",
+            fusion ? "estimate" : "echo", collisions / episodes, wallTicks / episodes, covered / episodes * 100);
+    }
+    return fusedRms < heldRms && inside * 10 >= ticks * 8 ? 0 : 1;
+}
+
+/// @brief Runs 60 s episodes of the bouncer and of the time to collision governor on the same seeds, on the raw
+/// @brief drive and on the velocity loop, and compares the average forward speed, the distance spent reversing,
+/// @brief the collisions and how close the robot came to a wall
+static int BenchGovernor(long iterations) {
+    (void)iterations;
+    const int episodes = 20;
+    int failed = 0;
+    for (bool velocityControl : {false, true}) {
+        double speed[2] = {}, collisions[2] = {};
+        for (int policy = 0; policy < 2; policy++) {
+            double backward = 0, clearance = 0, closest = 1e9, covered = 0;
+            for (int seed = 1; seed <= episodes; seed++) {
+                Sim::EpisodeResult r = policy == 0
+                    ? Sim::RunBouncer({}, seed, Control::BounceParams(), velocityControl)
+                    : Sim::RunGovernor({}, seed, Control::GovernorParams(), velocityControl);
+                speed[policy] += r.forward / r.seconds;
+                backward += r.backward;
+                collisions[policy] += r.collisions;
+                clearance += r.clearance;
+                closest = std::min(closest, (double)r.clearance);
+                covered += r.fraction;
+            }
+            printf("governor: %-8s %-8s forward %.3f m/s, reversed %.2f m, %.2f collisions, clearance %.0f mm mean %.0f mm worst, %.1f%% covered\n",
+                velocityControl ? "velocity" : "duty", policy == 0 ? "bouncer" : "governor", speed[policy] / episodes,
+                backward / episodes, collisions[policy] / episodes, clearance / episodes * 1000, closest * 1000, covered / episodes * 100);
+        }
+        if (speed[1] <= speed[0] || collisions[1] > collisions[0]) failed = 1;
+    }
+    return failed;
+}
+
+/// @brief Checks Power::Ledger's thresholds land at the old 45/55/60 s fractions of the budget, then runs 60 s
+/// @brief episodes of each motion strategy and compares the energy the ledger works out, the plant's own energy
+/// @brief and the energy per meter driven
+static int BenchEnergy(long iterations) {
+    (void)iterations;
+    int failed = 0;
+    //The logic alone, one second at a time, until the budget is gone
+    Power::Ledger ledger;
+    float at[4] = {0, 0, 0, 0};
+    for (int second = 1; ledger.GetLevel() != Power::Level::Empty && second < 100000; second++) {
+        Power::Level before = ledger.GetLevel();
+        ledger.Load(Power::Channel::Logic, 1, 1);
+        if (ledger.GetLevel() != before) at[(int)ledger.GetLevel()] = ledger.UsedTime(60);
+    }
+    printf("energy: budget %.0f J, low at %.1f s, critical at %.1f s, empty at %.1f s of a 60 s run, pack at %.2f V\n",
+        ledger.Joules(), at[1], at[2], at[3], ledger.Voltage());
+    if (std::fabs(at[1] - 45) > 0.5f || std::fabs(at[2] - 55) > 0.5f || at[3] < 59.5f) failed = 1;
+
+    //Stalled at full duty the winding takes the whole pack voltage over its resistance
+    Power::Ledger stall;
+    stall.Motor(Power::Channel::LeftMotor, 1, 0, 1);
+    float expected = stall.OpenCircuitVoltage() / (Power::MotorParams().resistance + Power::BatteryParams().internalResistance);
+    printf("energy: stalled motor draws %.2f A, %.2f A expected, the pack sags to %.2f V\n",
+        stall.Totals(Power::Channel::LeftMotor).current, expected, stall.Voltage());
+    if (std::fabs(stall.Totals(Power::Channel::LeftMotor).current - expected) > 0.1f * expected) failed = 1;
+
+    const int episodes = 10;
+    struct Strategy {
+        const char* name;
+        std::function<Sim::EpisodeResult(uint32_t seed)> run;
+    };
+    Strategy strategies[] = {
+        {"bouncer duty", [](uint32_t seed) { return Sim::RunBouncer({}, seed, Control::BounceParams(), false); }},
+        {"bouncer velocity", [](uint32_t seed) { return Sim::RunBouncer({}, seed, Control::BounceParams(), true); }},
+        {"governor velocity", [](uint32_t seed) { return Sim::RunGovernor({}, seed, Control::GovernorParams(), true); }},
+        {"zig-zag", [](uint32_t seed) {
+            Sim::WorldParams world;
+            world.startX = 0.1f;
+            world.startY = world.sweptWidth / 2;
+            Navigation::ZigZagPlanner planner({2.8f, 2.0f, 0.16f, 0.02f});
+            Navigation::ZigZagFollower follower(planner);
+            return Sim::Run(world, seed, 60, [&](Sim::Core1& core1, float distance, float) {
+                Navigation::Pose pose = core1.odometry.Snapshot();
+                pose.x -= world.startX;
+                Navigation::Twist twist = follower.Step(pose, distance, 1.0f);
+                core1.wheels.SetState(1);
+                core1.wheels.SetVelocity(twist.linear, twist.angular);
+                if (follower.Done()) core1.wheels.Stop();
+                core1.wheels.Update();
+                return follower.Done();
+            });
+        }},
+    };
+    for (const Strategy& strategy : strategies) {
+        double ledgerJoules = 0, plantJoules = 0, meters = 0, area = 0;
+        for (int seed = 1; seed <= episodes; seed++) {
+            Sim::EpisodeResult r = strategy.run(seed);
+            ledgerJoules += r.ledgerJoules;
+            plantJoules += r.joules;
+            meters += r.meters;
+            area += r.area;
+        }
+        printf("energy: %-18s %5.0f J by the ledger (plant %4.0f J), %4.1f s of the budget, %5.1f m driven, %5.1f J/m, %.2f m^2/kJ\n",
+            strategy.name, ledgerJoules / episodes, plantJoules / episodes, ledgerJoules / episodes / Power::BatteryParams().budget * 60,
+            meters / episodes, ledgerJoules / meters, area / ledgerJoules * 1000);
+    }
+    return failed;
+}
+
+/// @brief Where a wheel's TB6612 channel stands against a command: the pins and the PWM level it sets
+static bool WheelAt(const Drivetrain::WheelCommand& wheel, uint pwmPin, uint in1Pin, uint in2Pin) {
+    using Drivetrain::WheelMode;
+    bool in1 = wheel.mode == WheelMode::Backward || wheel.mode == WheelMode::Brake;
+    bool in2 = wheel.mode == WheelMode::Forward || wheel.mode == WheelMode::Brake;
+    float duty = wheel.mode == WheelMode::Coast ? 1.0f : wheel.mode == WheelMode::Brake ? 0.0f : wheel.duty;
+    return HostHAL::GetOutput(in1Pin) == in1 && HostHAL::GetOutput(in2Pin) == in2 && std::fabs(HostHAL::GetPwmDuty(pwmPin) - duty) < 2e-5f;
+}
+
+/// @brief What the wheels went through after the commands of DriveWindows
+struct WindowResult {
+    long changes, both, reversals;
+    double mixed_us, worstMixed_us;     //A wheel neither at its old command nor its new one, mostly new direction at old duty
+    double skew_us, worstSkew_us;       //Between the two wheels reaching their new commands
+    double peak_A, applied_A;           //Mean peak winding current of the reversing wheels, and what the new command alone draws
+};
+
+/// @brief Sends random Forward and Backward commands to each wheel at random points of the PWM period, with the motor
+/// @brief slices latching their levels like the chip, and times each wheel from the command to its new pins and level
+/// @param send Sends a command to the drivetrain under test
+static WindowResult DriveWindows(long commands, uint32_t seed, const std::function<void(const Drivetrain::DriveCommand&)>& send) {
+    using Board::Role;
+    using Board::PinOf;
+    const uint pwm[2] = {PinOf(Role::LeftMotorPWM), PinOf(Role::RightMotorPWM)};
+    const uint in1[2] = {PinOf(Role::LeftMotorIn1), PinOf(Role::RightMotorIn1)};
+    const uint in2[2] = {PinOf(Role::LeftMotorIn2), PinOf(Role::RightMotorIn2)};
+    const uint32_t period_us = (uint32_t)(1e6f / HostHAL::GetPwmFrequency(pwm[0])) + 1;
+    //The winding current with the wheel still at the speed of the old command, free running there
+    const float volts = Power::Ledger().OpenCircuitVoltage(), resistance = Power::MotorParams().resistance;
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> duty(0.2f, 0.9f), phase(0, 1);
+    std::bernoulli_distribution backward(0.5);
+
+    WindowResult result = {};
+    Drivetrain::DriveCommand last = {{Drivetrain::WheelMode::Forward, 0.5f}, {Drivetrain::WheelMode::Forward, 0.5f}};
+    send(last);
+    HostHAL::Advance(2 * period_us);
+    for (long i = 0; i < commands; i++) {
+        HostHAL::Advance(1 + (uint64_t)(phase(random) * period_us));
+        Drivetrain::DriveCommand next = {Drivetrain::WheelCommand::Signed(backward(random) ? -duty(random) : duty(random)),
+            Drivetrain::WheelCommand::Signed(backward(random) ? -duty(random) : duty(random))};
+        const Drivetrain::WheelCommand* from[2] = {&last.left, &last.right};
+        const Drivetrain::WheelCommand* to[2] = {&next.left, &next.right};
+        send(next);
+
+        long reached[2] = {-1, -1};
+        float peak[2] = {0, 0};
+        for (long t = 0; t <= 2 * (long)period_us && (reached[0] < 0 || reached[1] < 0); t++) {
+            for (int w = 0; w < 2; w++) {
+                if (reached[w] >= 0) continue;
+                if (WheelAt(*to[w], pwm[w], in1[w], in2[w])) { reached[w] = t; continue; }
+                if (!WheelAt(*from[w], pwm[w], in1[w], in2[w])) result.mixed_us += 1;
+                float sign = HostHAL::GetOutput(in2[w]) ? 1.0f : HostHAL::GetOutput(in1[w]) ? -1.0f : 0.0f;
+                float emf = (from[w]->mode == Drivetrain::WheelMode::Forward ? 1.0f : -1.0f) * from[w]->duty * volts;
+                peak[w] = std::max(peak[w], std::fabs(sign * HostHAL::GetPwmDuty(pwm[w]) * volts - emf) / resistance);
+            }
+            HostHAL::Advance(1);
+        }
+        for (int w = 0; w < 2; w++) {
+            if (from[w]->mode == to[w]->mode && from[w]->duty == to[w]->duty) continue;
+            result.changes++;
+            if (from[w]->mode != to[w]->mode) {
+                float applied = std::fabs(to[w]->duty + from[w]->duty) * volts / resistance;
+                result.reversals++;
+                result.peak_A += std::max(peak[w], applied);
+                result.applied_A += applied;
+            }
+        }
+        double skew = reached[0] > reached[1] ? reached[0] - reached[1] : reached[1] - reached[0];
+        result.skew_us += skew;
+        result.worstSkew_us = std::max(result.worstSkew_us, skew);
+        result.both++;
+        last = next;
+    }
+    return result;
+}
+
+/// @brief Drives two equal wheels straight, forward and back at random duties for 50 to 300 ms each, and integrates the
+/// @brief heading the difference of their speeds turns the robot through
+/// @return the largest heading in degrees, all of it from the two wheels not changing together
+static float StraightHeading(long commands, uint32_t seed, const std::function<void(const Drivetrain::DriveCommand&)>& send) {
+    using Board::Role;
+    using Board::PinOf;
+    Sim::MotorModel left = {PinOf(Role::LeftMotorPWM), PinOf(Role::LeftMotorIn1), PinOf(Role::LeftMotorIn2),
+        PinOf(Role::LeftEncoderA), PinOf(Role::LeftEncoderB), 1.0f, 0, 0, 0};
+    Sim::MotorModel right = {PinOf(Role::RightMotorPWM), PinOf(Role::RightMotorIn1), PinOf(Role::RightMotorIn2),
+        PinOf(Role::RightEncoderA), PinOf(Role::RightEncoderB), 1.0f, 0, 0, 0};
+    const uint32_t step_us = 20;
+    const float trackWidth = Control::VelocityParams().trackWidth;
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> duty(0.2f, 0.9f);
+    std::uniform_int_distribution<uint32_t> hold(50000 / step_us, 300000 / step_us);
+    std::bernoulli_distribution backward(0.5);
+    float heading = 0, worst = 0;
+    //Both wheels on one command before the models start
+    send({Drivetrain::WheelCommand::Signed(0.5f), Drivetrain::WheelCommand::Signed(0.5f)});
+    HostHAL::Advance(5000);
+    for (long i = 0; i < commands; i++) {
+        Drivetrain::WheelCommand wheel = Drivetrain::WheelCommand::Signed(backward(random) ? -duty(random) : duty(random));
+        send({wheel, wheel});
+        for (uint32_t steps = hold(random); steps > 0; steps--) {
+            left.Step(step_us * 1e-6f, 1.0f);
+            right.Step(step_us * 1e-6f, 1.0f);
+            heading += (right.speed - left.speed) / trackWidth * step_us * 1e-6f;
+            worst = std::max(worst, std::fabs(heading));
+            HostHAL::Advance(step_us);
+        }
+    }
+    return worst * 180 / (float)M_PI;
+}
+
+/// @brief The old DualMotor path, each motor's pins then its level, left first
+static void LegacySend(PWM::MOTOR& left, PWM::MOTOR& right, const Drivetrain::DriveCommand& command) {
+    if (command.left.mode == Drivetrain::WheelMode::Forward) left.Forward(command.left.duty); else left.Backward(command.left.duty);
+    if (command.right.mode == Drivetrain::WheelMode::Forward) right.Forward(command.right.duty); else right.Backward(command.right.duty);
+}
+
+/// @brief The distance one wheel runs on after the drive goes from 0.6 forward to the given stop
+static float StopDistance(const std::function<void(Drivetrain::DualMotor&)>& stop, float& stopSeconds) {
+    using Board::Role;
+    using Board::PinOf;
+    HostHAL::Reset();
+    Drivetrain::DualMotor drive(PinOf(Role::MotorStandby),
+        PinOf(Role::LeftMotorPWM), PinOf(Role::LeftMotorIn1), PinOf(Role::LeftMotorIn2),
+        PinOf(Role::RightMotorPWM), PinOf(Role::RightMotorIn1), PinOf(Role::RightMotorIn2));
+    Sim::MotorModel wheel = {PinOf(Role::LeftMotorPWM), PinOf(Role::LeftMotorIn1), PinOf(Role::LeftMotorIn2),
+        PinOf(Role::LeftEncoderA), PinOf(Role::LeftEncoderB), 1.0f, 0, 0, 0};
+    const uint32_t step_us = 200;
+    drive.SetState(true);
+    drive.Forward(0.6f);
+    for (int i = 0; i < 2500; i++) {
+        wheel.Step(step_us * 1e-6f, 1.0f);
+        HostHAL::Advance(step_us);
+    }
+    stop(drive);
+    double from = wheel.position;
+    int steps = 0;
+    for (; steps < 25000 && std::fabs(wheel.speed) > 0.001f; steps++) {
+        wheel.Step(step_us * 1e-6f, 1.0f);
+        HostHAL::Advance(step_us);
+    }
+    stopSeconds = steps * step_us * 1e-6f;
+    HostHAL::Reset();
+    return (float)((wheel.position - from) / Sim::MotorModel::countsPerMeter);
+}
+
+/// @brief Compares the old per motor drive path with Drivetrain::CommandLatch on the chip's latched PWM levels: how long
+/// @brief a wheel runs on a mix of its old and new command, how far apart the wheels change and the current a reversing
+/// @brief wheel sees. Then the short brake against coasting, and the bouncer's straightness in the simulator
+static int BenchDrive(long iterations) {
+    using Board::Role;
+    using Board::PinOf;
+    long commands = std::min<long>(std::max<long>(iterations / 50, 100), 2000);
+    const uint32_t motorSlices = (1u << pwm_gpio_to_slice_num(PinOf(Role::LeftMotorPWM))) | (1u << pwm_gpio_to_slice_num(PinOf(Role::RightMotorPWM)));
+    //The two pwm_init calls of the old constructors are a few microseconds apart on the Pico, the host runs them at one instant
+    const uint16_t constructorGap = 200;
+    int failed = 0;
+
+    HostHAL::Reset();
+    HostHAL::SetPwmLatching(motorSlices);
+    WindowResult legacy;
+    float legacyHeading;
+    {
+        PWM::MOTOR left(PinOf(Role::LeftMotorPWM), PinOf(Role::LeftMotorIn1), PinOf(Role::LeftMotorIn2));
+        PWM::MOTOR right(PinOf(Role::RightMotorPWM), PinOf(Role::RightMotorIn1), PinOf(Role::RightMotorIn2));
+        pwm_set_counter(pwm_gpio_to_slice_num(PinOf(Role::LeftMotorPWM)), constructorGap);
+        legacy = DriveWindows(commands, 7, [&](const Drivetrain::DriveCommand& command) { LegacySend(left, right, command); });
+        gpio_put(PinOf(Role::MotorStandby), true);
+        legacyHeading = StraightHeading(commands / 10, 11, [&](const Drivetrain::DriveCommand& command) { LegacySend(left, right, command); });
+    }
+
+    HostHAL::Reset();
+    HostHAL::SetPwmLatching(motorSlices);
+    WindowResult latched;
+    float latchedHeading;
+    {
+        Drivetrain::DualMotor drive(PinOf(Role::MotorStandby),
+            PinOf(Role::LeftMotorPWM), PinOf(Role::LeftMotorIn1), PinOf(Role::LeftMotorIn2),
+            PinOf(Role::RightMotorPWM), PinOf(Role::RightMotorIn1), PinOf(Role::RightMotorIn2));
+        latched = DriveWindows(commands, 7, [&](const Drivetrain::DriveCommand& command) { drive.Apply(command); });
+        drive.SetState(true);
+        latchedHeading = StraightHeading(commands / 10, 11, [&](const Drivetrain::DriveCommand& command) { drive.Apply(command); });
+    }
+
+    //The same windows through Static::DualMotor's own latch
+    HostHAL::Reset();
+    HostHAL::SetPwmLatching(motorSlices);
+    WindowResult staticLatched;
+    {
+        Static::BoardDualMotor drive;
+        staticLatched = DriveWindows(commands, 7, [&](const Drivetrain::DriveCommand& command) { drive.Apply(command); });
+    }
+
+    //The latch brings slices started apart into phase and leaves the other slices counting where they were
+    HostHAL::Reset();
+    bool inPhase, othersKept, pastWrap;
+    uint64_t guardWait_us;
+    {
+        PWM::MOTOR left(PinOf(Role::LeftMotorPWM), PinOf(Role::LeftMotorIn1), PinOf(Role::LeftMotorIn2));
+        PWM::MOTOR right(PinOf(Role::RightMotorPWM), PinOf(Role::RightMotorIn1), PinOf(Role::RightMotorIn2));
+        PWM::LED green(PinOf(Role::GreenLed));
+        pwm_set_counter(pwm_gpio_to_slice_num(PinOf(Role::LeftMotorPWM)), constructorGap);
+        HostHAL::Advance(123);
+        int64_t ledOrigin = HostHAL::GetPwmOrigin(PinOf(Role::GreenLed));
+        Drivetrain::CommandLatch latch(PinOf(Role::LeftMotorPWM), PinOf(Role::LeftMotorIn1), PinOf(Role::LeftMotorIn2),
+            PinOf(Role::RightMotorPWM), PinOf(Role::RightMotorIn1), PinOf(Role::RightMotorIn2), PWM::MOTOR::frequency, PWM::MOTOR::wrapCounter);
+        HostHAL::Advance(345);
+        inPhase = pwm_get_counter(pwm_gpio_to_slice_num(PinOf(Role::LeftMotorPWM))) == pwm_get_counter(pwm_gpio_to_slice_num(PinOf(Role::RightMotorPWM)));
+        othersKept = HostHAL::GetPwmOrigin(PinOf(Role::GreenLed)) == ledOrigin && HostHAL::GetPwmDuty(PinOf(Role::GreenLed)) == 0
+            && pwm_hw->en == (motorSlices | (1u << pwm_gpio_to_slice_num(PinOf(Role::GreenLed))));
+
+        //A command that comes just inside the guard waits the wrap out with interrupts off
+        const uint leftSlice = pwm_gpio_to_slice_num(PinOf(Role::LeftMotorPWM));
+        while (pwm_get_counter(leftSlice) + Drivetrain::CommandLatch::guardTicks < (uint32_t)PWM::MOTOR::wrapCounter) HostHAL::Advance(1);
+        uint64_t before_us = time_us_64();
+        latch.Apply({Drivetrain::WheelCommand::Signed(0.5f), Drivetrain::WheelCommand::Signed(-0.5f)});
+        guardWait_us = time_us_64() - before_us;
+        pastWrap = pwm_get_counter(leftSlice) < Drivetrain::CommandLatch::guardTicks;
+    }
+    HostHAL::Reset();
+
+    for (const auto& [name, r] : {std::pair<const char*, const WindowResult&>{"per motor", legacy}, {"latched", latched}, {"static", staticLatched}}) {
+        printf("drive: %-9s %ld commands, a wheel mixed %6.1f us per change, the wheels %6.1f us apart (%4.0f us worst), reversing peak %.2f A for %.2f A\n",
+            name, r.both, r.mixed_us / r.changes, r.skew_us / r.both, r.worstSkew_us, r.peak_A / r.reversals, r.applied_A / r.reversals);
+    }
+    if (latched.mixed_us != 0 || latched.worstSkew_us != 0) failed = 1;
+    if (staticLatched.mixed_us != 0 || staticLatched.worstSkew_us != 0) failed = 1;
+    printf("drive: %ld straight commands on equal wheels, heading at worst %.3f deg per motor, %.3f deg latched\n",
+        commands / 10, legacyHeading, latchedHeading);
+    printf("drive: slices %u ticks apart are %s after the latch, the LED slice %s\n", constructorGap,
+        inPhase ? "in phase" : "STILL APART", othersKept ? "runs on" : "WAS RESTARTED");
+    if (!inPhase || !othersKept) failed = 1;
+    printf("drive: a command inside the %u tick guard waits %llu us with interrupts off, %s\n", Drivetrain::CommandLatch::guardTicks,
+        (unsigned long long)guardWait_us, pastWrap ? "just past the wrap" : "NOT PAST THE WRAP");
+    //1024 ticks of 13.3 ns, 13.7 us, waited as 14 us. The nominal 1000 Hz tick would wait 15 or 16
+    if (!pastWrap || guardWait_us > 14) failed = 1;
+
+    //From 0.6 forward, the TB6612 short brake against open outputs
+    float brakeSeconds, coastSeconds;
+    float brake = StopDistance([](Drivetrain::DualMotor& drive) { drive.Brake(); }, brakeSeconds);
+    float coast = StopDistance([](Drivetrain::DualMotor& drive) { drive.Coast(); }, coastSeconds);
+    printf("drive: from 0.6 forward the wheel runs on %.1f mm in %.0f ms braking, %.1f mm in %.0f ms coasting\n",
+        brake * 1000, brakeSeconds * 1000, coast * 1000, coastSeconds * 1000);
+    if (!(brake < coast)) failed = 1;
+    return failed;
+}
+
+/// @brief What a simulated boot is made to go wrong with
+enum class BootFault {
+    None,
+    ButtonHeld,     //Held down from power on
+    NoWall,         //Nothing within range of the distance sensor
+    LeftStalled,    //The left motor does not turn
+    MotorPhase,     //The left motor slice counting out of step with the right one
+};
+
+/// @brief How a simulated boot went
+struct BootResult {
+    SelfTest::Status status;
+    float ready_ms;         //Until both cores had every result
+    float core0_ms;         //Until core0 had its own
+    float moved_mm;         //By the motor pulse
+    int polls;              //Runner passes of both cores together
+    int toggles;            //Of the boot blink, and when it was done
+    float blink_ms;
+};
+
+/// @brief Boots the robot in the simulated cell with both cores' self-test runners polled every millisecond, like
+/// @brief Runner::Run does on each core, while the world moves on in its 200 us steps. Then runs the blink off its timer
+static BootResult SimulatedBoot(BootFault fault) {
+    using Board::Role;
+    using Board::PinOf;
+    static int toggles;
+    static uint64_t blinkDone_us;
+    toggles = 0;
+    blinkDone_us = 0;
+    Sim::WorldParams params;
+    if (fault == BootFault::NoWall) params.sonar.maxRange = 1.5f;
+    if (fault == BootFault::LeftStalled) params.leftGain = 0;
+
+    HostHAL::Reset();
+    HostHAL::SetPwmLatching((1u << pwm_gpio_to_slice_num(PinOf(Role::LeftMotorPWM))) | (1u << pwm_gpio_to_slice_num(PinOf(Role::RightMotorPWM))));
+    HostHAL::SetInputs(0xffffffffu, 0);
+    if (fault == BootFault::ButtonHeld) HostHAL::SetInput(PinOf(Role::MainButton), true);
+    BootResult result = {};
+    {
+        //Core0's LEDs and core1's objects, constructed like p2.cpp
+        PWM::LED blue(PinOf(Role::BlueLed));
+        PWM::LED green(PinOf(Role::GreenLed));
+        Sim::World world(params, 1);
+        Sim::Core1 core1;
+        if (fault == BootFault::MotorPhase) pwm_set_counter(pwm_gpio_to_slice_num(PinOf(Role::LeftMotorPWM)), 1000);
+        float startX = world.x;
+        uint64_t boot_us = time_us_64();
+
+        std::atomic<SelfTest::Status> status = 0;
+        SelfTest::Runner core0(status), core1Runner(status);
+        SelfTest::LevelCheck button(PinOf(Role::MainButton), false);
+        SelfTest::PwmCheck ledPwm(Board::Pin<Role::BlueLed>::slice, PWM::LED::frequency, PWM::LED::wrapCounter);
+        core0.Add(SelfTest::Check::Button, &SelfTest::LevelCheck::Poll, &button, 100000);
+        core0.Add(SelfTest::Check::LedPwm, &SelfTest::PwmCheck::Poll, &ledPwm, 100000);
+        SelfTest::EchoCheck echo(core1.distance);
+        SelfTest::MotorPulse<Drivetrain::DualMotor> pulse(core1.drive, core1.leftEncoder, core1.rightEncoder);
+        SelfTest::PwmCheck motorPwm(Board::Pin<Role::LeftMotorPWM>::slice, PWM::MOTOR::frequency, PWM::MOTOR::wrapCounter, Board::Pin<Role::RightMotorPWM>::slice);
+        core1Runner.Add(SelfTest::Check::Echo, &SelfTest::EchoCheck::Poll, &echo, 300000);
+        core1Runner.Add(SelfTest::Check::LeftEncoder, &SelfTest::MotorPulse<Drivetrain::DualMotor>::Left, &pulse, 300000);
+        core1Runner.Add(SelfTest::Check::RightEncoder, &SelfTest::MotorPulse<Drivetrain::DualMotor>::Right, &pulse, 300000);
+        core1Runner.Add(SelfTest::Check::MotorPwm, &SelfTest::PwmCheck::Poll, &motorPwm, 100000);
+
+        bool core0Done = false, core1Done = false;
+        for (int step = 0; !(core0Done && core1Done) && step < 10000; step++) {
+            if (step % 5 == 0) {
+                uint64_t now_us = time_us_64();
+                if (!core0Done) {
+                    result.polls++;
+                    core0Done = core0.Poll(now_us);
+                    if (core0Done) result.core0_ms = (now_us - boot_us) / 1000.0f;
+                }
+                if (!core1Done) {
+                    result.polls++;
+                    core1Done = core1Runner.Poll(now_us);
+                }
+            }
+            if (!(core0Done && core1Done)) world.Step();
+        }
+        result.ready_ms = (time_us_64() - boot_us) / 1000.0f;
+        result.status = status;
+
+        //The blink once every required check passed, core0 has its scheduler running alongside
+        SelfTest::Blink blink;
+        if (SelfTest::Passed(result.status)) {
+            blink.Start(100, 20, [](bool on, void*) {
+                toggles++;
+                if (!on && toggles >= 20) blinkDone_us = time_us_64();
+            }, nullptr);
+        }
+        for (int step = 0; blink.Running() && step < 20000; step++) world.Step();
+        result.toggles = toggles;
+        result.blink_ms = (blinkDone_us - boot_us) / 1000.0f;
+        result.moved_mm = (world.x - startX) * 1000;
+    }
+    HostHAL::Reset();
+    return result;
+}
+
+/// @brief Boots the simulated robot with the self-test on both cores and against the old serialized core1 boot, then
+/// @brief with one fault each and checks the status word names it and only it, and that only an advisory one boots
+static int BenchSelfTest(long iterations) {
+    (void)iterations;
+    using SelfTest::Check;
+    using SelfTest::Result;
+    int failed = 0;
+
+    //The old boot: 500 ms for the distance sensor, one look at it and the button, then 200 blinks of 10 ms before
+    //core1 said it was ready and core0 started its tasks
+    const float serialized_ms = 500 + 200 * 10;
+    BootResult nominal = SimulatedBoot(BootFault::None);
+    printf("selftest: ready in %.1f ms (core0 %.1f ms) against %.0f ms serialized, %d polls, pulse moved %.2f mm, status %03x\n",
+        nominal.ready_ms, nominal.core0_ms, serialized_ms, nominal.polls, nominal.moved_mm, nominal.status);
+    printf("selftest: blink %d toggles off its timer alongside the tasks, done at %.0f ms\n", nominal.toggles, nominal.blink_ms);
+    if (nominal.status != SelfTest::allPassed || nominal.toggles != 20 || !(nominal.ready_ms < serialized_ms)) failed = 1;
+
+    struct Expectation {
+        BootFault fault;
+        const char* name;
+        Check check;
+        Result result;
+        bool boots;     //The fault is in an advisory check
+    };
+    const Expectation faults[] = {
+        {BootFault::ButtonHeld, "button held", Check::Button, Result::Fail, false},
+        {BootFault::NoWall, "no wall", Check::Echo, Result::Timeout, false},
+        {BootFault::LeftStalled, "left stalled", Check::LeftEncoder, Result::Timeout, true},
+        {BootFault::MotorPhase, "motor phase", Check::MotorPwm, Result::Fail, false},
+    };
+    for (const Expectation& expected : faults) {
+        BootResult r = SimulatedBoot(expected.fault);
+        //Timeout is both bits, so it also masks the check out
+        SelfTest::Status wanted = (SelfTest::allPassed & ~SelfTest::Encode(expected.check, Result::Timeout)) | SelfTest::Encode(expected.check, expected.result);
+        printf("selftest: %-12s -> %s %s, status %03x in %.1f ms, %s\n", expected.name, SelfTest::Name(expected.check),
+            SelfTest::Name(SelfTest::Decode(r.status, expected.check)), r.status, r.ready_ms, r.toggles > 0 ? "boots" : "reboots");
+        if (r.status != wanted || r.toggles != (expected.boots ? 20 : 0)) failed = 1;
+    }
+    return failed;
+}
+
+/// @brief A FadeEngine with its DMA channels and table in reach, and Stop with the aborts the other way round
+class FadeProbe : public PWM::FadeEngine {
+    public:
+        using FadeEngine::FadeEngine;
+
+        uint DataChannel() { return dataChannel; }
+        uint ControlChannel() { return controlChannel; }
+        int Length() { return length; }
+        uint16_t Entry(int step, uint channel) { return (uint16_t)(sequence[step] >> (16 * (channel & 1u))); }
+
+        /// @brief The order Stop must not use
+        void StopDataFirst() {
+            dma_channel_abort(dataChannel);
+            dma_channel_abort(controlChannel);
+            looping = false;
+        }
+};
+
+/// @brief Streams fades through the HostHAL DMA model into the LED slice and checks the compare value at every wrap
+/// @brief against the gamma table, that a ramp ends and holds and that a pulse repeats. Then stops a pulse at the
+/// @brief instant the data channel chained to the control channel, once in Stop's order and once the other way round
+static int BenchFade(long iterations) {
+    (void)iterations;
+    using Board::Role;
+    using Board::PinOf;
+    int failed = 0;
+    HostHAL::Reset();
+    PWM::LED green(PinOf(Role::GreenLed));
+    PWM::LED blue(PinOf(Role::BlueLed));
+    const uint greenPin = PinOf(Role::GreenLed);
+    const uint greenChannel = pwm_gpio_to_channel(greenPin);
+    FadeProbe fades(Board::Pin<Role::GreenLed>::slice, PWM::LED::wrapCounter, PWM::LED::frequency);
+    const double period_us = 1e6 / HostHAL::GetPwmFrequency(greenPin);
+
+    //Just past the next wrap, where the DMA has written the entry for it
+    auto nextWrap = [&]() {
+        double origin = (double)HostHAL::GetPwmOrigin(greenPin), now = (double)time_us_64();
+        HostHAL::AdvanceTo((uint64_t)std::ceil(origin + (std::floor((now - origin) / period_us) + 1) * period_us));
+    };
+    //The duty is over the wrapCounter counts of a period
+    auto level = [&]() { return (int)std::lround(HostHAL::GetPwmDuty(greenPin) * PWM::LED::wrapCounter); };
+
+    //A 100 ms ramp is 100 wraps, the gamma worked out apart from the engine
+    fades.Fade(greenChannel, 1, 100);
+    int steps = fades.Length(), worst = 0;
+    for (int step = 0; step < steps; step++) {
+        nextWrap();
+        int expected = (int)(std::pow(step / (float)(steps - 1), 2.2f) * (PWM::LED::wrapCounter - 1));
+        worst = std::max(worst, std::abs(level() - expected));
+        if (level() != fades.Entry(step, greenChannel)) failed = 1;
+    }
+    bool rampBusy = fades.Busy();
+    for (int i = 0; i < 5; i++) nextWrap();
+    bool held = level() == PWM::LED::wrapCounter - 1 && fades.GetBrightness(greenChannel) == 1;
+    printf("fade: ramp over %d wraps, %d counts from gamma 2.2 at worst, %s after, %s\n", steps, worst,
+        rampBusy ? "still streaming" : "done", held ? "holds full" : "does not hold");
+    if (worst > 1 || rampBusy || !held) failed = 1;
+
+    //A 200 ms pulse loops its table through the control channel
+    fades.Pulse(greenChannel, 1, 200);
+    steps = fades.Length();
+    std::vector<int> levels;
+    bool looped = true;
+    for (int step = 0; step < 3 * steps; step++) {
+        nextWrap();
+        levels.push_back(level());
+        if (step >= steps && levels[step] != levels[step - steps]) looped = false;
+        if (!fades.Busy()) looped = false;
+    }
+    printf("fade: pulse repeats its %d entries %s\n", steps, looped ? "every time" : "wrongly");
+    if (!looped) failed = 1;
+
+    //The data channel has written its last entry and the control channel's restart is in flight
+    auto toRestart = [&]() {
+        for (int step = 0; step < 2 * fades.Length(); step++) {
+            nextWrap();
+            if (!dma_channel_is_busy(fades.DataChannel()) && dma_channel_is_busy(fades.ControlChannel())) return true;
+        }
+        return false;
+    };
+    const char* names[2] = {"control first (Stop)", "data first"};
+    bool streaming[2];
+    for (int order = 0; order < 2; order++) {
+        fades.Pulse(greenChannel, 1, 200);
+        if (!toRestart()) failed = 1;
+        if (order == 0) fades.Stop();
+        else fades.StopDataFirst();
+        int stoppedAt = level();
+        for (int i = 0; i < 10; i++) nextWrap();
+        streaming[order] = fades.Busy() || level() != stoppedAt;
+        printf("fade: stopped at the restart, %-20s %s\n", names[order], streaming[order] ? "keeps streaming" : "stops");
+    }
+    fades.Stop();
+    //The other order has to show up, or the model can not tell them apart
+    if (streaming[0] || !streaming[1]) failed = 1;
+    HostHAL::Reset();
+    return failed;
+}
+
+/// @brief Sweeps a small grid of the bouncer's tuning on one thread and on several, checks the ranking is the same
+/// @brief whatever the thread count and reports the speedup. The speedup needs that many cores to be real
+static int BenchSweep(long iterations) {
+    (void)iterations;
+    Sim::GridSpec grid;
+    grid.baseSpeed = {0.4f, 0.6f, 0.8f};
+    grid.wallDistance = {0.35f, 0.55f};
+    std::vector<Sim::Candidate> candidates = Sim::Grid(grid);
+    Sim::SweepParams params;
+    params.episodes = 4;
+
+    unsigned cores = std::thread::hardware_concurrency();
+    unsigned many = cores > 1 ? cores : 4;
+    Sim::SweepResult one = Sim::Sweep(candidates, params, 1);
+    Sim::SweepResult several = Sim::Sweep(candidates, params, many);
+    bool same = one.ranked.size() == several.ranked.size();
+    for (size_t i = 0; same && i < one.ranked.size(); i++) {
+        const Sim::CandidateResult& a = one.ranked[i];
+        const Sim::CandidateResult& b = several.ranked[i];
+        same = a.candidate.bounce.baseSpeed == b.candidate.bounce.baseSpeed && a.candidate.bounce.wallDistance == b.candidate.bounce.wallDistance
+            && a.collisions == b.collisions && a.coverage == b.coverage && a.joules == b.joules;
+    }
+    const Sim::CandidateResult& best = one.ranked.front();
+    printf("sweep: %zu episodes, 1 thread %.2f s, %u threads %.2f s (%.2fx on %u cores, %zu stolen), ranking %s\n",
+        one.episodes, one.seconds, many, several.seconds, one.seconds / several.seconds, cores, several.stolen, same ? "identical" : "DIFFERENT");
+    printf("sweep: best baseSpeed %.2f wallDistance %.2f, %.2f collisions %.1f%% covered %.0f J score %.1f\n",
+        best.candidate.bounce.baseSpeed, best.candidate.bounce.wallDistance, best.collisions, best.coverage, best.joules, best.score);
+    return same ? 0 : 1;
+}
+
+/// @brief Records from two threads standing in for the cores, with an interrupt-like second producer on core0,
+/// @brief then dumps the rings through the Telemetry frame decoder and checks every core's entries come back
+/// @brief complete and in order. Also times a single record
+/// @param capture Where to save the dump for p2_trace, or nullptr
+static int BenchTrace(long iterations, const char* capture) {
+    const uint32_t perProducer = 600;
+    Trace::Resume();
+    Trace::rings[0].Clear();
+    Trace::rings[1].Clear();
+
+    HostHAL::Reset();
+    double start = WallSeconds();
+    for (long i = 0; i < iterations; i++) {
+        Trace::Record(Trace::Id::Task, Trace::Kind::Begin, (uint32_t)i);
+    }
+    double recordNs = (WallSeconds() - start) / iterations * 1e9;
+
+    //Payload high bits tell the producers apart, low bits count
+    Trace::rings[0].Clear();
+    std::thread core1([&] {
+        HostHAL::SetCoreNum(1);
+        for (uint32_t i = 0; i < perProducer; i++) {
+            Trace::Record(Trace::Id::Task, Trace::Kind::Instant, 0x10000 | i);
+            std::this_thread::yield();
+        }
+    });
+    std::thread isr([&] {
+        HostHAL::SetCoreNum(0);
+        for (uint32_t i = 0; i < perProducer / 2; i++) {
+            Trace::Record(Trace::Id::GpioIrq, Trace::Kind::Instant, 0x20000 | i);
+            std::this_thread::yield();
+        }
+    });
+    HostHAL::SetCoreNum(0);
+    for (uint32_t i = 0; i < perProducer / 2; i++) {
+        Trace::Record(Trace::Id::Task, Trace::Kind::Instant, i);
+        std::this_thread::yield();
+    }
+    core1.join();
+    isr.join();
+
+    Trace::Freeze();
+    std::vector<uint8_t> dump;
+    uint16_t sequence = 0;
+    Trace::Dump([](const uint8_t* data, size_t length, void* context) {
+        std::vector<uint8_t>* out = (std::vector<uint8_t>*)context;
+        out->insert(out->end(), data, data + length);
+    }, &dump, sequence);
+    Trace::Resume();
+    if (capture) {
+        FILE* file = fopen(capture, "wb");
+        if (file) {
+            fwrite(dump.data(), 1, dump.size(), file);
+            fclose(file);
+        }
+    }
+
+    Telemetry::Decoder decoder;
+    Telemetry::Frame frame;
+    Trace::Entry entries[Trace::entriesPerFrame];
+    std::vector<uint32_t> next(3, 0);
+    uint32_t seen[2] = {0, 0};
+    bool ordered = true;
+    for (uint8_t byte : dump) {
+        decoder.Push(byte);
+        while (decoder.Next(frame)) {
+            uint8_t core;
+            size_t count;
+            if (frame.type != Telemetry::FrameType::Trace || !Trace::DecodeEntries(frame.payload, frame.length, core, entries, count)) continue;
+            for (size_t i = 0; i < count; i++) {
+                uint32_t producer = entries[i].payload >> 16;
+                if ((entries[i].payload & 0xffff) != next[producer]) ordered = false;
+                next[producer] = (entries[i].payload & 0xffff) + 1;
+                seen[core]++;
+            }
+        }
+    }
+    printf("trace: record %.1f ns, dump %zu bytes in %lu frames, core0 %lu of %lu entries  core1 %lu of %lu  %s\n",
+        recordNs, dump.size(), (unsigned long)decoder.Frames(), (unsigned long)seen[0], (unsigned long)perProducer,
+        (unsigned long)seen[1], (unsigned long)perProducer, ordered ? "in order" : "OUT OF ORDER");
+    Trace::rings[0].Clear();
+    Trace::rings[1].Clear();
+    return ordered && seen[0] == perProducer && seen[1] == perProducer && decoder.CrcErrors() == 0 ? 0 : 1;
+}
+
+/// @brief Records a synthetic 62 s session through Replay::recorder on the virtual clock: a button press into
+/// @brief WORK mode, 12 Hz echoes of a wall that approaches at 0.24 m/s and jumps back after each bounce, and
+/// @brief PIO encoder counts every 10 ms. Replays it twice for determinism, once with a variant tuning, and
+/// @brief checks the replayed odometry travelled what the counts say
+static int BenchReplay(long iterations, const char* capturePath) {
+    (void)iterations;
+    using Board::Role;
+    using Board::PinOf;
+    const float speed = 0.24f, duration = 62;
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> jump(1.0f, 2.5f);
+
+    std::vector<uint8_t> capture;
+    uint16_t sequence = 0;
+    auto drain = [&] {
+        Replay::recorder.Drain([](const uint8_t* data, size_t length, void* context) {
+            std::vector<uint8_t>* out = (std::vector<uint8_t>*)context;
+            out->insert(out->end(), data, data + length);
+        }, &capture, sequence, 64);
+    };
+
+    HostHAL::Reset();
+    float wall = 2.0f;
+    double counts = 0;
+    uint64_t nextEcho = 0;
+    for (uint64_t t = 0; t < (uint64_t)(duration * 1e6); t += 10000) {
+        HostHAL::AdvanceTo(t);
+        float seconds = t / 1e6f;
+        bool moving = seconds > 0.6f;
+        //Button on core0, pressed and released to go into WORK mode
+        HostHAL::SetCoreNum(0);
+        if (t == 500000) Replay::recorder.Edge(PinOf(Role::MainButton), GPIO_IRQ_EDGE_RISE);
+        if (t == 600000) Replay::recorder.Edge(PinOf(Role::MainButton), GPIO_IRQ_EDGE_FALL);
+        //Encoder ticks on core0, both wheels forward
+        if (moving) counts += speed * 0.01 / Sensor::MotorEncoder::metersPerCount;
+        Replay::recorder.Counts(PinOf(Role::LeftEncoderA), (int32_t)counts);
+        Replay::recorder.Counts(PinOf(Role::RightEncoderA), (int32_t)counts);
+        //Echo on core1
+        HostHAL::SetCoreNum(1);
+        if (moving) wall -= speed * 0.01f;
+        if (wall < 0.3f) wall = jump(random);
+        if (t >= nextEcho) {
+            nextEcho += 1000000 / Sensor::Distance::triggerFrequency;
+            Replay::recorder.Edge(PinOf(Role::DistanceEcho), GPIO_IRQ_EDGE_RISE);
+            HostHAL::Advance((uint64_t)(wall * 5800));
+            Replay::recorder.Edge(PinOf(Role::DistanceEcho), GPIO_IRQ_EDGE_FALL);
+        }
+        if (t % 20000 == 0) drain();
+    }
+    HostHAL::SetCoreNum(0);
+    drain();
+    HostHAL::Reset();
+    if (capturePath) {
+        FILE* file = fopen(capturePath, "wb");
+        if (file) {
+            fwrite(capture.data(), 1, capture.size(), file);
+            fclose(file);
+        }
+    }
+
+    uint32_t lost = 0;
+    std::vector<Replay::Input> inputs = Replay::ReadCapture(capture.data(), capture.size(), &lost);
+    double start = WallSeconds();
+    std::vector<Replay::Tick> first = Replay::Session(inputs).Run();
+    double elapsed = WallSeconds() - start;
+    std::vector<Replay::Tick> second = Replay::Session(inputs).Run();
+    Control::BounceParams variant;
+    variant.wallDistance = 0.4f;
+    std::vector<Replay::Tick> other = Replay::Session(inputs, variant).Run();
+
+    float travelled = first.empty() ? 0 : first.back().pose.distance;
+    //The run ends when workTime reaches 60 s, the wheels turned from 0.6 s until the last replayed tick
+    float expected = first.empty() ? 0 : speed * (first.back().timestamp_us / 1e6f - 0.6f);
+    long difference = Replay::FirstDifference(first, other);
+    printf("replay: %zu inputs in %zu bytes, %lu lost, %zu ticks replayed in %.1f ms (%.0fx real time), repeat %s\n",
+        inputs.size(), capture.size(), (unsigned long)lost, first.size(), elapsed * 1e3,
+        first.empty() ? 0 : first.back().timestamp_us / 1e6 / elapsed, Replay::Digest(first) == Replay::Digest(second) ? "identical" : "DIFFERENT");
+    printf("replay: odometry travelled %.3f m of %.3f m, wallDistance 0.4 first decides differently at %.2f s\n",
+        travelled, expected, difference < 0 ? -1.0 : first[difference].timestamp_us / 1e6);
+    bool faithful = std::fabs(travelled - expected) < 0.01f * expected;
+    return lost == 0 && faithful && Replay::Digest(first) == Replay::Digest(second) && difference >= 0 ? 0 : 1;
+}
+
+/// @brief Compares encoding a binary State frame with the printf the firmware used to do, then decodes
+/// @brief a stream with every tenth frame corrupted and checks every good frame comes back
+static int BenchTelemetry(long iterations) {
+    Telemetry::Record record = {123456789, 0.42f, 1000, -998, 0.31f, 0.30f, 0.6f, 0.6f, 1, 812, 40, 0};
+    uint8_t frame[Telemetry::maxFrame];
+    char text[64];
+    volatile size_t sink = 0;
+
+    double start = WallSeconds();
+    for (long i = 0; i < iterations; i++) {
+        record.distance = 0.001f * (i & 1023);
+        sink = sink + Telemetry::EncodeRecord(record, (uint16_t)i, frame);
+    }
+    double encodeNs = (WallSeconds() - start) / iterations * 1e9;
+
+    start = WallSeconds();
+    for (long i = 0; i < iterations; i++) {
+        sink = sink + snprintf(text, sizeof(text), " Distance: %.2f \n", 0.001f * (i & 1023));
+    }
+    double printNs = (WallSeconds() - start) / iterations * 1e9;
+
+    size_t frameSize = Telemetry::EncodeRecord(record, 0, frame);
+    printf("telemetry: %zu byte frame with %zu fields, encode %.1f ns, distance printf %.1f ns\n",
+        frameSize, (size_t)12, encodeNs, printNs);
+
+    //Stream with garbage between frames and a flipped byte in every tenth frame
+    long frames = iterations < 100000 ? iterations : 100000;
+    std::vector<uint8_t> stream;
+    std::mt19937 random(7);
+    long corrupted = 0;
+    for (long i = 0; i < frames; i++) {
+        record.timestamp_us = (uint64_t)i;
+        size_t length = Telemetry::EncodeRecord(record, (uint16_t)i, frame);
+        if (i % 10 == 9) {
+            frame[Telemetry::headerSize + random() % Telemetry::recordSize] ^= 0x10;
+            corrupted++;
+        }
+        stream.insert(stream.end(), frame, frame + length);
+        if (i % 7 == 0) stream.push_back(Telemetry::sync0);
+    }
+
+    Telemetry::Decoder decoder;
+    Telemetry::Frame decoded;
+    long good = 0, wrong = 0;
+    start = WallSeconds();
+    for (uint8_t byte : stream) {
+        decoder.Push(byte);
+        while (decoder.Next(decoded)) {
+            Telemetry::Record back;
+            Telemetry::DecodeRecord(decoded.payload, decoded.length, back);
+            if (back.timestamp_us % 65536 != decoded.sequence) wrong++;
+            good++;
+        }
+    }
+    double decodeNs = (WallSeconds() - start) / stream.size() * 1e9;
+    printf("telemetry: decoded %ld of %ld frames, %ld corrupted, %lu CRC errors, %lu lost, %ld mismatched, %.1f ns per byte\n",
+        good, frames, corrupted, (unsigned long)decoder.CrcErrors(), (unsigned long)decoder.Lost(), wrong, decodeNs);
+    return good == frames - corrupted && wrong == 0 ? 0 : 1;
+}
+
+/// @brief One ping-pong pass between two threads acting as the two cores, core0 sends a Command and core1 answers with Telemetry
+/// @return the one way latencies in ns, half of each round trip
+static std::vector<double> PingPong(long rounds, bool doorbell) {
+    Buffer::Channel<Message::Command, Message::commandCapacity> commands(doorbell);
+    Buffer::Channel<Message::Telemetry, Message::telemetryCapacity> replies(doorbell);
+    std::vector<double> latencies;
+    latencies.reserve(rounds);
+
+    //Throw away doorbells a previous pass left behind
+    HostHAL::SetCoreNum(1);
+    multicore_fifo_drain();
+    HostHAL::SetCoreNum(0);
+    multicore_fifo_drain();
+
+    std::thread core1([&]() {
+        HostHAL::SetCoreNum(1);
+        Message::Command command;
+        for (long i = 0; i < rounds; i++) {
+            while (!commands.Receive(command)) {
+                if (doorbell) commands.Wait(UINT64_MAX);
+                else std::this_thread::yield();
+            }
+            replies.Send({(uint32_t)i, 0, command.value, 0, 0, 0, 0, 0});
+        }
+    });
+
+    Message::Telemetry reply;
+    for (long i = 0; i < rounds; i++) {
+        auto start = std::chrono::steady_clock::now();
+        commands.Send({Message::CommandType::SetMode, (float)i});
+        while (!replies.Receive(reply)) {
+            if (doorbell) replies.Wait(UINT64_MAX);
+            else std::this_thread::yield();
+        }
+        latencies.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / 2);
+    }
+    core1.join();
+    return latencies;
+}
+
+/// @brief Streams Telemetry from one thread to another as fast as the ring allows, then measures latency
+/// @brief with the receiver spinning (yielding) and with the receiver blocked on the FIFO doorbell
+static int BenchChannel(long iterations) {
+    Buffer::Channel<Message::Telemetry, Message::telemetryCapacity> channel;
+    std::atomic<long> outOfOrder(0);
+    long full = 0;
+
+    std::thread consumer([&]() {
+        Message::Telemetry message;
+        for (uint32_t expected = 0; expected < (uint32_t)iterations; expected++) {
+            while (!channel.Receive(message)) {
+                std::this_thread::yield();
+            }
+            if (message.sequence != expected) outOfOrder++;
+        }
+    });
+
+    double start = WallSeconds();
+    for (long i = 0; i < iterations; i++) {
+        Message::Telemetry message = {(uint32_t)i, (uint64_t)i, 1.0f, 0, 0, 0, 0, 1};
+        //Yield so it also works when both threads share one CPU
+        while (!channel.Send(message)) {
+            full++;
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    double elapsed = WallSeconds() - start;
+    printf("channel: %ld messages of %zu bytes in %.3f s, %.1f M msg/s, sender found it full %ld times, %ld out of order\n",
+        iterations, sizeof(Message::Telemetry), elapsed, iterations / elapsed / 1e6, full, outOfOrder.load());
+
+    long rounds = iterations < 20000 ? iterations : 20000;
+    for (bool doorbell : {false, true}) {
+        std::vector<double> latencies = PingPong(rounds, doorbell);
+        std::sort(latencies.begin(), latencies.end());
+        double sum = 0;
+        for (double l : latencies) sum += l;
+        printf("channel: %-8s one way latency mean %8.0f ns  p50 %8.0f ns  p99 %8.0f ns  max %8.0f ns\n",
+            doorbell ? "doorbell" : "spin", sum / latencies.size(), latencies[latencies.size() / 2],
+            latencies[latencies.size() * 99 / 100], latencies.back());
+    }
+    return outOfOrder == 0 ? 0 : 1;
+}
+
+/// @brief State used by BenchSeqlock, every field holds the same value when the copy is consistent
+struct StressState {
+    uint32_t fields[8];
+};
+
+/// @brief One writer thread and three reader threads hammer a seqlock and a plain shared struct, and count torn reads
+static int BenchSeqlock(long iterations) {
+    Buffer::Seqlock<StressState> lock;
+    static volatile StressState plain;
+    std::atomic<bool> done(false);
+    std::atomic<long> reads(0), retries(0), torn(0), plainTorn(0);
+
+    std::thread writer([&]() {
+        for (long i = 0; i < iterations; i++) {
+            StressState state;
+            for (uint32_t& f : state.fields) f = (uint32_t)i;
+            lock.Write(state);
+            for (int f = 0; f < 8; f++) plain.fields[f] = (uint32_t)i;
+            //Leave the readers some room, like a timer callback would. The signal fence keeps the loop from being optimised out
+            for (int spin = 0; spin < 200; spin++) {
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+            }
+        }
+        done = true;
+    });
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; r++) {
+        readers.emplace_back([&]() {
+            long localReads = 0, localRetries = 0, localTorn = 0, localPlainTorn = 0;
+            while (!done) {
+                StressState state;
+                while (!lock.TryRead(state)) localRetries++;
+                localReads++;
+                for (uint32_t f : state.fields) {
+                    if (f != state.fields[0]) { localTorn++; break; }
+                }
+
+                uint32_t copy[8];
+                for (int f = 0; f < 8; f++) copy[f] = plain.fields[f];
+                for (uint32_t f : copy) {
+                    if (f != copy[0]) { localPlainTorn++; break; }
+                }
+            }
+            reads += localReads;
+            retries += localRetries;
+            torn += localTorn;
+            plainTorn += localPlainTorn;
+        });
+    }
+
+    double start = WallSeconds();
+    writer.join();
+    for (auto& reader : readers) reader.join();
+    double elapsed = WallSeconds() - start;
+
+    printf("seqlock: %ld writes, %ld reads in %.3f s, %ld retries, torn reads seqlock %ld plain %ld\n",
+        iterations, reads.load(), elapsed, retries.load(), torn.load(), plainTorn.load());
+    return torn == 0 ? 0 : 1;
+}
+
+#pragma endregion
+
+int main(int argc, char** argv) {
+    const char* name = argc > 1 ? argv[1] : "all";
+    long iterations = argc > 2 ? atol(argv[2]) : 1000000;
+    bool all = strcmp(name, "all") == 0;
+    bool ran = false;
+    int result = 0;
+
+    if (all || strcmp(name, "control") == 0) { BenchControl(iterations); ran = true; }
+
+    if (all || strcmp(name, "irq") == 0) { BenchIrq(iterations); ran = true; }
+
+    if (all || strcmp(name, "quadrature") == 0) { result |= BenchQuadrature(iterations); ran = true; }
+
+    if (all || strcmp(name, "echo") == 0) { result |= BenchEcho(iterations); ran = true; }
+
+    if (all || strcmp(name, "seqlock") == 0) { result |= BenchSeqlock(iterations); ran = true; }
+
+    if (all || strcmp(name, "dispatch") == 0) { result |= BenchDispatch(iterations); ran = true; }
+
+    if (all || strcmp(name, "scheduler") == 0) { result |= BenchScheduler(iterations); ran = true; }
+
+    if (all || strcmp(name, "channel") == 0) { result |= BenchChannel(iterations); ran = true; }
+
+    if (all || strcmp(name, "telemetry") == 0) { result |= BenchTelemetry(iterations); ran = true; }
+
+    if (all || strcmp(name, "velocity") == 0) { result |= BenchVelocity(iterations); ran = true; }
+
+    if (all || strcmp(name, "edges") == 0) { result |= BenchEdges(iterations); ran = true; }
+
+    if (all || strcmp(name, "odometry") == 0) { result |= BenchOdometry(iterations, argc > 3 ? argv[3] : nullptr); ran = true; }
+
+    if (all || strcmp(name, "coverage") == 0) { result |= BenchCoverage(iterations); ran = true; }
+
+    if (all || strcmp(name, "trace") == 0) { result |= BenchTrace(iterations, argc > 3 ? argv[3] : nullptr); ran = true; }
+
+    if (all || strcmp(name, "sim") == 0) { result |= BenchSim(iterations); ran = true; }
+    if (all || strcmp(name, "rearm") == 0) { result |= BenchRearm(iterations); ran = true; }
+    if (all || strcmp(name, "fusion") == 0) { result |= BenchFusion(iterations); ran = true; }
+    if (all || strcmp(name, "governor") == 0) { result |= BenchGovernor(iterations); ran = true; }
+    if (all || strcmp(name, "energy") == 0) { result |= BenchEnergy(iterations); ran = true; }
+    if (all || strcmp(name, "drive") == 0) { result |= BenchDrive(iterations); ran = true; }
+    if (all || strcmp(name, "selftest") == 0) { result |= BenchSelfTest(iterations); ran = true; }
+    if (all || strcmp(name, "fade") == 0) { result |= BenchFade(iterations); ran = true; }
+    if (all || strcmp(name, "sweep") == 0) { result |= BenchSweep(iterations); ran = true; }
+    if (all || strcmp(name, "replay") == 0) { result |= BenchReplay(iterations, argc > 3 ? argv[3] : nullptr); ran = true; }
+
+    if (!ran) {
+        printf("Unknown bench '%s'\n", name);
+        return 1;
+    }
+    return result;
+}
@@ -0,0 +1,835 @@
+#include "HostHAL.h"
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cmath>
+#include <cassert>
+#include <cstring>
+
+#pragma region Register File
+
+namespace {
+
+    struct PinState {
+        bool output = false;
+        bool driven = false;   //Level the chip drives when output
+        bool external = false; //Level driven from outside when input
+        bool externalSet = false;
+        bool pullUp = false;
+        bool pullDown = false;
+        uint function = GPIO_FUNC_NULL;
+        uint32_t irqMask = 0;
+    };
+
+    struct SliceState {
+        uint32_t div = 1 << 4;
+        uint32_t top = 0xffff;
+        bool enabled = false;
+        uint16_t level[2] = {0, 0};
+        int64_t origin_us = 0;      //When the counter was last at 0, it counts up from there every period. Before the start for a counter set early on
+        uint16_t next[2] = {0, 0};  //Levels written since the last wrap, with latching on
+        bool latchPending = false;
+        double latch_us = 0;        //The wrap the next levels take effect at
+        bool irqEnabled = false;
+        double irqCleared_us = 0;   //The first wrap after this raises the slice's IRQ
+        alarm_id_t wrapAlarm = 0;   //Runs the PWM IRQ handler at the wraps while the IRQ is enabled
+    };
+
+    /// @brief A DMA channel beyond its registers
+    struct DmaChannelState {
+        dma_channel_config config = {};
+        uint32_t reload = 0;        //The count a trigger starts from
+        bool busy = false;
+        bool inFlight = false;      //Unpaced and triggered, its transfers land at the next DMA step
+        uint64_t inFlight_us = 0;
+        alarm_id_t dreqAlarm = 0;   //Paced by a PWM wrap, runs the next transfer
+    };
+
+    struct TimerEntry {
+        alarm_id_t id;
+        uint64_t due;
+        alarm_callback_t alarm;     //Set for one-shot alarms
+        repeating_timer *repeating; //Set for repeating timers
+        void *userData;
+    };
+
+    /// @brief A PIO state machine running QuadratureEncoder.pio, see HostHAL::ClaimQuadrature
+    struct QuadratureState {
+        uint pinA;
+        uint8_t last;               //B in bit 1, A in bit 0, the order `in pins, 2` reads them
+        int32_t count;              //The program's Y
+    };
+
+    constexpr int quadratureMachines = 12;    //3 PIO blocks of 4 state machines
+
+    struct State {
+        PinState pins[NUM_BANK0_GPIOS];
+        QuadratureState quadrature[quadratureMachines];
+        uint quadratureClaimed = 0;
+        SliceState slices[NUM_PWM_SLICES];
+        DmaChannelState dma[NUM_DMA_CHANNELS];
+        uint32_t dmaClaimed = 0;
+        dma_hw_t dmaRegisters = {};
+        pwm_hw_t pwmRegisters = {};
+        std::vector<TimerEntry> timers;
+        gpio_irq_callback_t irqCallback = nullptr;
+        uint64_t now_us = 0;
+        alarm_id_t nextID = 1;
+        uint core = 0;
+        uint32_t levels = 0;    //PinLevel of GPIO 0-31, kept up to date so gpio_get_all is one load
+        uint32_t latching = 0;  //Slices that double buffer their levels, see HostHAL::SetPwmLatching
+        bool masked = false;    //Interrupts off, timers wait until they are back on
+        irq_handler_t pwmHandler = nullptr;
+    };
+
+    thread_local State state;
+
+    bool PinLevel(uint gpio) {
+        const PinState& p = state.pins[gpio];
+        if (p.output) return p.driven;
+        if (p.externalSet) return p.external;
+        return p.pullUp;
+    }
+
+    /// @brief The jump table of QuadratureEncoder.pio, by the last and the new BA state
+    constexpr int8_t quadratureSteps[16] = {
+        0, -1, +1, 0,
+        +1, 0, 0, -1,
+        -1, 0, 0, +1,
+        0, +1, -1, 0,
+    };
+
+    uint8_t QuadraturePins(uint pinA) {
+        return (uint8_t)((PinLevel(pinA + 1) ? 2 : 0) | (PinLevel(pinA) ? 1 : 0));
+    }
+
+    /// @brief Steps every claimed state machine whose pins a SetInputs changed
+    void RunQuadrature(uint32_t mask) {
+        for (uint i = 0; i < state.quadratureClaimed; i++) {
+            QuadratureState& q = state.quadrature[i];
+            if (!(mask & (3u << q.pinA))) continue;
+            uint8_t now = QuadraturePins(q.pinA);
+            q.count += quadratureSteps[q.last << 2 | now];
+            q.last = now;
+        }
+    }
+
+    /// @brief Refreshes the levels word after a change to a pin's state
+    void UpdateLevel(uint gpio) {
+        if (gpio >= 32) return;
+        state.levels = (state.levels & ~(1u << gpio)) | ((uint32_t)PinLevel(gpio) << gpio);
+    }
+
+    alarm_id_t AddTimer(uint64_t due, alarm_callback_t alarm, repeating_timer *repeating, void *userData) {
+        alarm_id_t id = state.nextID++;
+        state.timers.push_back({id, due, alarm, repeating, userData});
+        return id;
+    }
+
+    bool RemoveTimer(alarm_id_t id) {
+        for (size_t i = 0; i < state.timers.size(); i++) {
+            if (state.timers[i].id == id) {
+                state.timers.erase(state.timers.begin() + i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool LandDma(uint64_t before_us);
+
+    /// @brief Runs the earliest timer due at or before the limit, returns false when none is due or interrupts are off.
+    bool RunNextTimer(uint64_t limit_us) {
+        if (state.masked) return false;
+        size_t next = state.timers.size();
+        for (size_t i = 0; i < state.timers.size(); i++) {
+            if (state.timers[i].due <= limit_us && (next == state.timers.size() || state.timers[i].due < state.timers[next].due)) {
+                next = i;
+            }
+        }
+        if (next == state.timers.size()) return false;
+        //DMA transfers in flight from before land first, they may add timers of their own
+        if (LandDma(state.timers[next].due)) return true;
+
+        TimerEntry entry = state.timers[next];
+        state.timers.erase(state.timers.begin() + next);
+        if (entry.due > state.now_us) state.now_us = entry.due;
+
+        if (entry.repeating) {
+            repeating_timer *rt = entry.repeating;
+            if (rt->callback(rt)) {
+                uint64_t period = rt->delay_us < 0 ? -rt->delay_us : rt->delay_us;
+                state.timers.push_back({entry.id, entry.due + period, nullptr, rt, entry.userData});
+            }
+        } else {
+            int64_t again = entry.alarm(entry.id, entry.userData);
+            if (again > 0) {
+                state.timers.push_back({entry.id, state.now_us + again, entry.alarm, nullptr, entry.userData});
+            } else if (again < 0) {
+                state.timers.push_back({entry.id, entry.due - again, entry.alarm, nullptr, entry.userData});
+            }
+        }
+        return true;
+    }
+}
+
+#pragma endregion
+
+#pragma region Inter-core FIFO
+
+namespace {
+
+    struct Fifo {
+        std::mutex lock;
+        std::condition_variable changed;
+        std::deque<uint32_t> words;
+    };
+
+    constexpr size_t fifoDepth = 4;
+
+    /// @brief fifos[n] is the one core n reads, not thread_local on purpose
+    Fifo fifos[2];
+
+    Fifo& Inbox() { return fifos[state.core & 1u]; }
+
+    Fifo& Outbox() { return fifos[(state.core & 1u) ^ 1u]; }
+
+    /// @brief Real time deadline for a timeout, capped so a "forever" timeout does not overflow the clock
+    std::chrono::steady_clock::time_point Deadline(uint64_t timeout_us) {
+        const uint64_t day_us = 86400ull * 1000000ull;
+        return std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_us < day_us ? timeout_us : day_us);
+    }
+}
+
+void multicore_fifo_push_blocking(uint32_t data) {
+    multicore_fifo_push_timeout_us(data, UINT64_MAX);
+}
+
+bool multicore_fifo_push_timeout_us(uint32_t data, uint64_t timeout_us) {
+    Fifo& fifo = Outbox();
+    std::unique_lock<std::mutex> guard(fifo.lock);
+    if (!fifo.changed.wait_until(guard, Deadline(timeout_us), [&] { return fifo.words.size() < fifoDepth; })) return false;
+    fifo.words.push_back(data);
+    fifo.changed.notify_all();
+    return true;
+}
+
+uint32_t multicore_fifo_pop_blocking() {
+    uint32_t data = 0;
+    while (!multicore_fifo_pop_timeout_us(UINT64_MAX, &data)) {
+    }
+    return data;
+}
+
+bool multicore_fifo_pop_timeout_us(uint64_t timeout_us, uint32_t *out) {
+    Fifo& fifo = Inbox();
+    std::unique_lock<std::mutex> guard(fifo.lock);
+    if (!fifo.changed.wait_until(guard, Deadline(timeout_us), [&] { return !fifo.words.empty(); })) return false;
+    *out = fifo.words.front();
+    fifo.words.pop_front();
+    fifo.changed.notify_all();
+    return true;
+}
+
+bool multicore_fifo_rvalid() {
+    Fifo& fifo = Inbox();
+    std::lock_guard<std::mutex> guard(fifo.lock);
+    return !fifo.words.empty();
+}
+
+bool multicore_fifo_wready() {
+    Fifo& fifo = Outbox();
+    std::lock_guard<std::mutex> guard(fifo.lock);
+    return fifo.words.size() < fifoDepth;
+}
+
+void multicore_fifo_drain() {
+    Fifo& fifo = Inbox();
+    std::lock_guard<std::mutex> guard(fifo.lock);
+    fifo.words.clear();
+    fifo.changed.notify_all();
+}
+
+#pragma endregion
+
+#pragma region GPIO
+
+void gpio_init(uint gpio) {
+    PinState& p = state.pins[gpio];
+    p.output = false;
+    p.driven = false;
+    p.function = GPIO_FUNC_SIO;
+    UpdateLevel(gpio);
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    state.pins[gpio].output = out;
+    UpdateLevel(gpio);
+}
+
+void gpio_put(uint gpio, bool value) {
+    state.pins[gpio].driven = value;
+    UpdateLevel(gpio);
+}
+
+void gpio_put_masked(uint32_t mask, uint32_t value) {
+    for (uint gpio = 0; gpio < 32; gpio++) {
+        if (mask & (1u << gpio)) {
+            state.pins[gpio].driven = (value >> gpio) & 1u;
+            UpdateLevel(gpio);
+        }
+    }
+}
+
+bool gpio_get(uint gpio) {
+    return PinLevel(gpio);
+}
+
+uint32_t gpio_get_all() {
+    return state.levels;
+}
+
+void gpio_set_pulls(uint gpio, bool up, bool down) {
+    state.pins[gpio].pullUp = up;
+    state.pins[gpio].pullDown = down;
+    UpdateLevel(gpio);
+}
+
+void gpio_pull_up(uint gpio) { gpio_set_pulls(gpio, true, false); }
+
+void gpio_pull_down(uint gpio) { gpio_set_pulls(gpio, false, true); }
+
+bool gpio_is_pulled_up(uint gpio) { return state.pins[gpio].pullUp; }
+
+void gpio_set_function(uint gpio, gpio_function fn) {
+    state.pins[gpio].function = fn;
+}
+
+void gpio_set_irq_callback(gpio_irq_callback_t callback) {
+    state.irqCallback = callback;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+    if (enabled) {
+        state.pins[gpio].irqMask |= event_mask;
+    } else {
+        state.pins[gpio].irqMask &= ~event_mask;
+    }
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    //Only the bank0 and PWM wrap IRQs are simulated, and they are always enabled
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    if (num == PWM_IRQ_WRAP_0) state.pwmHandler = handler;
+}
+
+void irq_set_priority(uint num, uint8_t hardware_priority) {
+    //A handler runs to the end before the next, so priorities change nothing here
+}
+
+uint32_t save_and_disable_interrupts() {
+    uint32_t status = state.masked;
+    state.masked = true;
+    return status;
+}
+
+void restore_interrupts(uint32_t status) {
+    state.masked = status != 0;
+}
+
+#pragma endregion
+
+#pragma region PWM
+
+namespace {
+
+    double TickUs(const SliceState& s) {
+        return 1e6 * s.div / 16.0 / clock_get_hz(clk_sys);
+    }
+
+    /// @brief The first wrap of the slice, the counter going from top to 0, strictly after the given time
+    double WrapAfter(const SliceState& s, double time_us) {
+        double period_us = TickUs(s) * (s.top + 1);
+        return s.origin_us + (std::floor((time_us - s.origin_us) / period_us) + 1) * period_us;
+    }
+
+    /// @brief Takes the written levels over once their wrap has passed
+    void Latch(SliceState& s) {
+        if (s.latchPending && s.latch_us <= (double)state.now_us) {
+            s.level[0] = s.next[0];
+            s.level[1] = s.next[1];
+            s.latchPending = false;
+        }
+    }
+
+    /// @brief The raw wrap flag, set by any wrap since the last pwm_clear_irq
+    bool Raised(const SliceState& s) {
+        return s.enabled && WrapAfter(s, s.irqCleared_us) <= (double)state.now_us;
+    }
+
+    /// @brief Stands in for the wrap interrupt, due at each wrap of the slice while its IRQ is enabled
+    int64_t WrapAlarm(alarm_id_t id, void *user_data) {
+        SliceState& s = state.slices[(uintptr_t)user_data];
+        if (s.irqEnabled && Raised(s) && state.pwmHandler) state.pwmHandler();
+        //The handler may have disabled the IRQ, or disabled and enabled it again under a new alarm
+        if (s.wrapAlarm != id || !s.enabled) {
+            if (s.wrapAlarm == id) s.wrapAlarm = 0;
+            return 0;
+        }
+        int64_t again = (int64_t)std::ceil(WrapAfter(s, (double)state.now_us) - (double)state.now_us);
+        return again > 0 ? again : 1;
+    }
+}
+
+pwm_config pwm_get_default_config() {
+    return pwm_config{0, 1 << 4, 0xffff};
+}
+
+void pwm_config_set_clkdiv(pwm_config *c, float div) {
+    c->div = (uint32_t)(div * 16.0f);
+}
+
+void pwm_config_set_wrap(pwm_config *c, uint16_t wrap) {
+    c->top = wrap;
+}
+
+uint pwm_gpio_to_slice_num(uint gpio) {
+    return gpio < 32 ? ((gpio >> 1u) & 7u) : (8u + ((gpio >> 1u) & 3u));
+}
+
+uint pwm_gpio_to_channel(uint gpio) {
+    return gpio & 1u;
+}
+
+void pwm_init(uint slice_num, pwm_config *c, bool start) {
+    SliceState& s = state.slices[slice_num];
+    s.div = c->div;
+    s.top = c->top;
+    s.level[0] = 0;
+    s.level[1] = 0;
+    s.latchPending = false;
+    s.enabled = start;
+    s.origin_us = (int64_t)state.now_us;
+    state.pwmRegisters.en = (state.pwmRegisters.en & ~(1u << slice_num)) | ((uint32_t)start << slice_num);
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled) {
+    SliceState& s = state.slices[slice_num];
+    if (enabled && !s.enabled) s.origin_us = (int64_t)state.now_us;
+    s.enabled = enabled;
+    state.pwmRegisters.en = (state.pwmRegisters.en & ~(1u << slice_num)) | ((uint32_t)enabled << slice_num);
+}
+
+void pwm_set_mask_enabled(uint32_t mask) {
+    for (uint slice = 0; slice < NUM_PWM_SLICES; slice++) {
+        pwm_set_enabled(slice, (mask >> slice) & 1u);
+    }
+}
+
+void pwm_set_counter(uint slice_num, uint16_t c) {
+    SliceState& s = state.slices[slice_num];
+    Latch(s);
+    bool raised = Raised(s);
+    double tick_us = 1e6 * s.div / 16.0 / clock_get_hz(clk_sys);
+    s.origin_us = (int64_t)state.now_us - (int64_t)(c * tick_us);
+    //Moving the counter is not a wrap, the pending levels and the IRQ wait for the next real one
+    if (s.latchPending) s.latch_us = WrapAfter(s, (double)state.now_us);
+    if (!raised) s.irqCleared_us = (double)state.now_us;
+}
+
+uint16_t pwm_get_counter(uint slice_num) {
+    const SliceState& s = state.slices[slice_num];
+    double tick_us = 1e6 * s.div / 16.0 / clock_get_hz(clk_sys);
+    return (uint16_t)((int64_t)(((int64_t)state.now_us - s.origin_us) / tick_us) % (s.top + 1));
+}
+
+void pwm_set_gpio_level(uint gpio, uint16_t level) {
+    pwm_set_chan_level(pwm_gpio_to_slice_num(gpio), pwm_gpio_to_channel(gpio), level);
+}
+
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level) {
+    SliceState& s = state.slices[slice_num];
+    if (!(state.latching & (1u << slice_num)) || !s.enabled) {
+        s.level[chan] = level;
+        return;
+    }
+    Latch(s);
+    if (!s.latchPending) {
+        s.next[0] = s.level[0];
+        s.next[1] = s.level[1];
+        s.latchPending = true;
+        s.latch_us = WrapAfter(s, (double)state.now_us);
+    }
+    s.next[chan] = level;
+}
+
+void pwm_set_irq_enabled(uint slice_num, bool enabled) {
+    SliceState& s = state.slices[slice_num];
+    s.irqEnabled = enabled;
+    if (!enabled && s.wrapAlarm) {
+        RemoveTimer(s.wrapAlarm);
+        s.wrapAlarm = 0;
+    } else if (enabled && !s.wrapAlarm && s.enabled) {
+        uint64_t due = (uint64_t)std::ceil(WrapAfter(s, (double)state.now_us));
+        s.wrapAlarm = AddTimer(due, WrapAlarm, nullptr, (void *)(uintptr_t)slice_num);
+    }
+}
+
+void pwm_clear_irq(uint slice_num) {
+    state.slices[slice_num].irqCleared_us = (double)state.now_us;
+}
+
+uint32_t pwm_get_irq_status_mask() {
+    uint32_t mask = 0;
+    for (uint slice = 0; slice < NUM_PWM_SLICES; slice++) {
+        if (state.slices[slice].irqEnabled && Raised(state.slices[slice])) mask |= 1u << slice;
+    }
+    return mask;
+}
+
+uint32_t clock_get_hz(clock_index clk_index) {
+    return 150000000;
+}
+
+#pragma endregion
+
+#pragma region DMA
+
+namespace {
+
+    void TriggerDma(uint channel);
+
+    /// @brief The slice whose cc register an address is, -1 for none
+    int PwmCcSlice(uintptr_t address) {
+        for (uint slice = 0; slice < NUM_PWM_SLICES; slice++) {
+            if (address == (uintptr_t)&state.pwmRegisters.slice[slice].cc) return (int)slice;
+        }
+        return -1;
+    }
+
+    /// @brief The channel whose al3_read_addr_trig an address is, -1 for none
+    int DmaTriggerChannel(uintptr_t address) {
+        for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+            if (address == (uintptr_t)&state.dmaRegisters.ch[channel].al3_read_addr_trig) return (int)channel;
+        }
+        return -1;
+    }
+
+    /// @brief Moves one word. A write to a register the model knows takes effect like on the chip, the last one
+    /// @brief fires the chain
+    void TransferDma(uint channel) {
+        DmaChannelState& d = state.dma[channel];
+        dma_channel_hw_t& r = state.dmaRegisters.ch[channel];
+        size_t bytes = (size_t)1 << d.config.size;
+        int slice = PwmCcSlice(r.write_addr), target = DmaTriggerChannel(r.write_addr);
+        if (slice >= 0) {
+            uint32_t cc = 0;
+            std::memcpy(&cc, (const void *)r.read_addr, bytes);
+            state.pwmRegisters.slice[slice].cc = cc;
+            pwm_set_chan_level((uint)slice, 0, (uint16_t)cc);
+            pwm_set_chan_level((uint)slice, 1, (uint16_t)(cc >> 16));
+        } else if (target >= 0) {
+            uintptr_t address;
+            std::memcpy(&address, (const void *)r.read_addr, sizeof(address));
+            state.dmaRegisters.ch[target].al3_read_addr_trig = address;
+            state.dmaRegisters.ch[target].read_addr = address;
+            TriggerDma((uint)target);
+        } else {
+            std::memcpy((void *)r.write_addr, (const void *)r.read_addr, bytes);
+        }
+        if (d.config.readIncrement) r.read_addr += bytes;
+        if (d.config.writeIncrement) r.write_addr += bytes;
+        if (--r.transfer_count > 0) return;
+        d.busy = false;
+        d.inFlight = false;
+        if (d.config.chainTo != channel) TriggerDma(d.config.chainTo);
+    }
+
+    /// @brief Stands in for the PWM DREQ, one transfer at each wrap of the slice
+    int64_t DreqAlarm(alarm_id_t id, void *user_data) {
+        uint channel = (uint)(uintptr_t)user_data;
+        DmaChannelState& d = state.dma[channel];
+        if (d.dreqAlarm != id) return 0;
+        TransferDma(channel);
+        if (!d.busy || d.dreqAlarm != id) {
+            if (d.dreqAlarm == id) d.dreqAlarm = 0;
+            return 0;
+        }
+        //Due at the wrap rounded up, which the rounding can leave a hair short of it, so half a period on is the next
+        const SliceState& s = state.slices[d.config.dreq - DREQ_PWM_WRAP0];
+        double period_us = TickUs(s) * (s.top + 1);
+        return (int64_t)std::ceil(WrapAfter(s, state.now_us + period_us / 2) - (double)state.now_us);
+    }
+
+    /// @brief Restarts a channel from its written count, paced by its DREQ or in flight at once
+    void TriggerDma(uint channel) {
+        DmaChannelState& d = state.dma[channel];
+        dma_channel_hw_t& r = state.dmaRegisters.ch[channel];
+        if (d.dreqAlarm) {
+            RemoveTimer(d.dreqAlarm);
+            d.dreqAlarm = 0;
+        }
+        r.transfer_count = d.reload;
+        d.busy = d.reload > 0;
+        d.inFlight = false;
+        if (!d.busy) return;
+        if (d.config.dreq >= DREQ_PWM_WRAP0 && d.config.dreq < DREQ_PWM_WRAP0 + NUM_PWM_SLICES) {
+            const SliceState& s = state.slices[d.config.dreq - DREQ_PWM_WRAP0];
+            uint64_t due = (uint64_t)std::ceil(WrapAfter(s, (double)state.now_us));
+            d.dreqAlarm = AddTimer(due, DreqAlarm, nullptr, (void *)(uintptr_t)channel);
+        } else {
+            d.inFlight = true;
+            d.inFlight_us = state.now_us;
+        }
+    }
+
+    /// @brief Completes the unpaced channels that went in flight before the given time, and what they chain to
+    /// @return true when any landed
+    bool LandDma(uint64_t before_us) {
+        bool landed = false;
+        for (bool again = true; again;) {
+            again = false;
+            for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+                DmaChannelState& d = state.dma[channel];
+                if (!d.inFlight || d.inFlight_us >= before_us) continue;
+                d.inFlight = false;
+                while (d.busy && !d.inFlight && !d.dreqAlarm) TransferDma(channel);
+                landed = again = true;
+            }
+        }
+        return landed;
+    }
+}
+
+uint pwm_get_dreq(uint slice_num) {
+    return DREQ_PWM_WRAP0 + slice_num;
+}
+
+pwm_hw_t *HostPwmRegisters() {
+    return &state.pwmRegisters;
+}
+
+dma_hw_t *HostDmaRegisters() {
+    return &state.dmaRegisters;
+}
+
+int dma_claim_unused_channel(bool required) {
+    for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        if (state.dmaClaimed & (1u << channel)) continue;
+        state.dmaClaimed |= 1u << channel;
+        return (int)channel;
+    }
+    assert(!required && "Every DMA channel is taken");
+    return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    return dma_channel_config{DMA_SIZE_32, true, false, DREQ_FORCE, channel};
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, dma_channel_transfer_size size) {
+    c->size = size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    c->readIncrement = incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    c->writeIncrement = incr;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+    c->dreq = dreq;
+}
+
+void channel_config_set_chain_to(dma_channel_config *c, uint chain_to) {
+    c->chainTo = chain_to;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr, const volatile void *read_addr, uint transfer_count, bool trigger) {
+    DmaChannelState& d = state.dma[channel];
+    dma_channel_hw_t& r = state.dmaRegisters.ch[channel];
+    d.config = *config;
+    r.write_addr = (uintptr_t)write_addr;
+    r.read_addr = (uintptr_t)read_addr;
+    r.transfer_count = transfer_count;
+    d.reload = transfer_count;
+    if (trigger) TriggerDma(channel);
+    LandDma(UINT64_MAX);
+}
+
+void dma_channel_abort(uint channel) {
+    DmaChannelState& d = state.dma[channel];
+    //The abort waits for the transfer in flight to retire, so it still lands
+    if (d.inFlight) TransferDma(channel);
+    if (d.dreqAlarm) {
+        RemoveTimer(d.dreqAlarm);
+        d.dreqAlarm = 0;
+    }
+    d.busy = false;
+    d.inFlight = false;
+    //The other channels went on meanwhile
+    LandDma(UINT64_MAX);
+}
+
+bool dma_channel_is_busy(uint channel) {
+    return state.dma[channel].busy;
+}
+
+#pragma endregion
+
+#pragma region Time
+
+uint64_t time_us_64() {
+    return state.now_us;
+}
+
+uint32_t time_us_32() {
+    return (uint32_t)state.now_us;
+}
+
+void sleep_us(uint64_t us) {
+    HostHAL::Advance(us);
+}
+
+void sleep_ms(uint32_t ms) {
+    HostHAL::Advance((uint64_t)ms * 1000);
+}
+
+void busy_wait_us(uint64_t us) {
+    HostHAL::Advance(us);
+}
+
+uint get_core_num() {
+    return state.core;
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data, repeating_timer *out) {
+    uint64_t period = delay_us < 0 ? -delay_us : delay_us;
+    out->delay_us = delay_us;
+    out->callback = callback;
+    out->user_data = user_data;
+    out->alarm_id = AddTimer(state.now_us + period, nullptr, out, user_data);
+    return true;
+}
+
+bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t callback, void *user_data, repeating_timer *out) {
+    return add_repeating_timer_us((int64_t)delay_ms * 1000, callback, user_data, out);
+}
+
+bool cancel_repeating_timer(repeating_timer *timer) {
+    return RemoveTimer(timer->alarm_id);
+}
+
+void alarm_pool_init_default() {
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+    return AddTimer(state.now_us + us, callback, nullptr, user_data);
+}
+
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+    return add_alarm_in_us((uint64_t)ms * 1000, callback, user_data, fire_if_past);
+}
+
+bool cancel_alarm(alarm_id_t alarm_id) {
+    return RemoveTimer(alarm_id);
+}
+
+#pragma endregion
+
+#pragma region Simulation Control
+
+void HostHAL::Reset() {
+    state = State();
+}
+
+void HostHAL::AdvanceTo(uint64_t time_us) {
+    while (RunNextTimer(time_us) || LandDma(time_us)) {
+    }
+    if (time_us > state.now_us) state.now_us = time_us;
+}
+
+void HostHAL::Advance(uint64_t us) {
+    AdvanceTo(state.now_us + us);
+}
+
+void HostHAL::SetInput(uint gpio, bool level) {
+    SetInputs(1u << gpio, (uint32_t)level << gpio);
+}
+
+void HostHAL::SetInputs(uint32_t mask, uint32_t levels) {
+    uint32_t events[32];
+    //Only the pins in the mask, the simulator drives a few pins at a time at a high rate
+    for (uint32_t pending = mask; pending; pending &= pending - 1) {
+        uint gpio = (uint)__builtin_ctz(pending);
+        events[gpio] = 0;
+        bool level = (levels >> gpio) & 1u;
+        bool previous = PinLevel(gpio);
+        PinState& p = state.pins[gpio];
+        p.external = level;
+        p.externalSet = true;
+        UpdateLevel(gpio);
+
+        if (level && !previous) events[gpio] |= GPIO_IRQ_EDGE_RISE;
+        if (!level && previous) events[gpio] |= GPIO_IRQ_EDGE_FALL;
+        events[gpio] |= level ? GPIO_IRQ_LEVEL_HIGH : GPIO_IRQ_LEVEL_LOW;
+        events[gpio] &= p.irqMask;
+        if (p.output) events[gpio] = 0;
+    }
+
+    RunQuadrature(mask);
+
+    for (uint32_t pending = mask; pending; pending &= pending - 1) {
+        uint gpio = (uint)__builtin_ctz(pending);
+        if (events[gpio] && state.irqCallback) {
+            state.irqCallback(gpio, events[gpio]);
+        }
+    }
+}
+
+void HostHAL::SetCoreNum(uint core) {
+    state.core = core;
+}
+
+bool HostHAL::GetOutput(uint gpio) {
+    return state.pins[gpio].driven;
+}
+
+float HostHAL::GetPwmDuty(uint gpio) {
+    SliceState& s = state.slices[pwm_gpio_to_slice_num(gpio)];
+    if (!s.enabled) return 0;
+    Latch(s);
+    return (float)s.level[pwm_gpio_to_channel(gpio)] / (float)(s.top + 1);
+}
+
+int64_t HostHAL::GetPwmOrigin(uint gpio) {
+    return state.slices[pwm_gpio_to_slice_num(gpio)].origin_us;
+}
+
+float HostHAL::GetPwmFrequency(uint gpio) {
+    const SliceState& s = state.slices[pwm_gpio_to_slice_num(gpio)];
+    return (float)clock_get_hz(clk_sys) * 16.0f / (float)s.div / (float)(s.top + 1);
+}
+
+void HostHAL::SetPwmLatching(uint32_t sliceMask) {
+    state.latching = sliceMask;
+}
+
+uint HostHAL::ClaimQuadrature(uint pinA) {
+    assert(state.quadratureClaimed < quadratureMachines && "Every PIO state machine is taken");
+    uint sm = state.quadratureClaimed++;
+    state.quadrature[sm] = {pinA, QuadraturePins(pinA), 0};
+    return sm;
+}
+
+int32_t HostHAL::QuadratureCount(uint sm) {
+    return state.quadrature[sm].count;
+}
+
+#pragma endregion
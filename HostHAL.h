@@ -0,0 +1,253 @@
+//Simulated Pico SDK for the Linux host build (P2_HOST).
+//Provides the subset of the SDK the firmware classes use, backed by a simulated register file and a virtual clock.
+//All state is thread_local, so every thread is its own independent robot.
+#ifndef HOSTHAL_H
+#define HOSTHAL_H
+
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+
+typedef unsigned int uint;
+
+#pragma region SDK Constants & Types
+
+#define NUM_BANK0_GPIOS 48
+#define NUM_PWM_SLICES 12
+#define NUM_DMA_CHANNELS 16
+#define DREQ_PWM_WRAP0 32
+#define DREQ_FORCE 63
+#define IO_IRQ_BANK0 21
+#define PWM_IRQ_WRAP_0 8
+#define PWM_DEFAULT_IRQ_NUM() PWM_IRQ_WRAP_0
+#define PICO_HIGHEST_IRQ_PRIORITY 0x00
+#define PICO_OK 0
+
+#define hard_assert(x) assert(x)
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+
+enum gpio_irq_level {
+    GPIO_IRQ_LEVEL_LOW = 0x1u,
+    GPIO_IRQ_LEVEL_HIGH = 0x2u,
+    GPIO_IRQ_EDGE_FALL = 0x4u,
+    GPIO_IRQ_EDGE_RISE = 0x8u,
+};
+
+enum gpio_function {
+    GPIO_FUNC_PWM = 4,
+    GPIO_FUNC_SIO = 5,
+    GPIO_FUNC_NULL = 0x1f,
+};
+
+enum clock_index {
+    clk_sys = 5,
+};
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+typedef void (*irq_handler_t)(void);
+
+typedef struct {
+    uint32_t csr;
+    uint32_t div;
+    uint32_t top;
+} pwm_config;
+
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+
+struct repeating_timer;
+typedef bool (*repeating_timer_callback_t)(struct repeating_timer *rt);
+
+struct repeating_timer {
+    int64_t delay_us;
+    alarm_id_t alarm_id;
+    repeating_timer_callback_t callback;
+    void *user_data;
+};
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2,
+};
+
+/// @brief The fields of a channel's CTRL register, kept apart on the host
+typedef struct {
+    uint32_t size;
+    bool readIncrement;
+    bool writeIncrement;
+    uint dreq;
+    uint chainTo;
+} dma_channel_config;
+
+/// @brief The channel registers the firmware addresses directly. Address registers are pointer wide on the host,
+/// @brief so a DMA transfer into one copies a whole host pointer
+typedef struct {
+    uintptr_t read_addr;
+    uintptr_t write_addr;
+    uint32_t transfer_count;        //Transfers left, reloaded from the written count by a trigger
+    uintptr_t al3_read_addr_trig;   //A write sets the read address and triggers the channel
+} dma_channel_hw_t;
+
+typedef struct {
+    dma_channel_hw_t ch[NUM_DMA_CHANNELS];
+} dma_hw_t;
+
+/// @brief Only cc is modelled, a DMA write to it sets both levels of the slice
+typedef struct {
+    uint32_t csr;
+    uint32_t div;
+    uint32_t ctr;
+    uint32_t cc;
+    uint32_t top;
+} pwm_slice_hw_t;
+
+/// @brief en reads back the enabled slices, writing it does nothing, use pwm_set_mask_enabled
+typedef struct {
+    pwm_slice_hw_t slice[NUM_PWM_SLICES];
+    uint32_t en;
+} pwm_hw_t;
+
+#define dma_hw (HostDmaRegisters())
+#define pwm_hw (HostPwmRegisters())
+
+#pragma endregion
+
+#pragma region SDK Functions
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+void gpio_put_masked(uint32_t mask, uint32_t value);
+bool gpio_get(uint gpio);
+uint32_t gpio_get_all();
+void gpio_set_pulls(uint gpio, bool up, bool down);
+void gpio_pull_up(uint gpio);
+void gpio_pull_down(uint gpio);
+bool gpio_is_pulled_up(uint gpio);
+void gpio_set_function(uint gpio, gpio_function fn);
+void gpio_set_irq_callback(gpio_irq_callback_t callback);
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled);
+void irq_set_enabled(uint num, bool enabled);
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_set_priority(uint num, uint8_t hardware_priority);
+uint32_t save_and_disable_interrupts();
+void restore_interrupts(uint32_t status);
+
+pwm_config pwm_get_default_config();
+void pwm_config_set_clkdiv(pwm_config *c, float div);
+void pwm_config_set_wrap(pwm_config *c, uint16_t wrap);
+uint pwm_gpio_to_slice_num(uint gpio);
+uint pwm_gpio_to_channel(uint gpio);
+void pwm_init(uint slice_num, pwm_config *c, bool start);
+void pwm_set_enabled(uint slice_num, bool enabled);
+void pwm_set_mask_enabled(uint32_t mask);
+void pwm_set_gpio_level(uint gpio, uint16_t level);
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level);
+void pwm_set_counter(uint slice_num, uint16_t c);
+uint16_t pwm_get_counter(uint slice_num);
+void pwm_set_irq_enabled(uint slice_num, bool enabled);
+void pwm_clear_irq(uint slice_num);
+uint32_t pwm_get_irq_status_mask();
+uint pwm_get_dreq(uint slice_num);
+pwm_hw_t *HostPwmRegisters();
+
+//A channel paced by DREQ_PWM_WRAPn moves one word at each wrap of the slice, an unpaced one moves all of them at once.
+//A transfer started by a chain stays in flight until the clock moves on or the next DMA call returns, so a bench can
+//call into the DMA at the instant a chain fired, like the other core could
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_dreq(dma_channel_config *c, uint dreq);
+void channel_config_set_chain_to(dma_channel_config *c, uint chain_to);
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr, const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_channel_abort(uint channel);
+bool dma_channel_is_busy(uint channel);
+dma_hw_t *HostDmaRegisters();
+
+uint32_t clock_get_hz(clock_index clk_index);
+
+uint64_t time_us_64();
+uint32_t time_us_32();
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void busy_wait_us(uint64_t us);
+uint get_core_num();
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data, repeating_timer *out);
+bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t callback, void *user_data, repeating_timer *out);
+bool cancel_repeating_timer(repeating_timer *timer);
+void alarm_pool_init_default();
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past);
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past);
+bool cancel_alarm(alarm_id_t alarm_id);
+
+//The inter-core FIFOs are shared by every thread, so two threads with SetCoreNum 0 and 1 talk like the two cores.
+//Timeouts are in real time, since the other side is a real thread and not on the virtual clock
+void multicore_fifo_push_blocking(uint32_t data);
+bool multicore_fifo_push_timeout_us(uint32_t data, uint64_t timeout_us);
+uint32_t multicore_fifo_pop_blocking();
+bool multicore_fifo_pop_timeout_us(uint64_t timeout_us, uint32_t *out);
+bool multicore_fifo_rvalid();
+bool multicore_fifo_wready();
+void multicore_fifo_drain();
+
+#pragma endregion
+
+#pragma region Simulation Control
+/// @brief Host only controls for driving the simulated hardware from a bench, replay or simulator.
+namespace HostHAL {
+
+    /// @brief Clears the register file, timers and virtual clock of the calling thread.
+    void Reset();
+
+    /// @brief Runs every timer and alarm due up to the given absolute virtual time, then sets the clock to it.
+    void AdvanceTo(uint64_t time_us);
+
+    /// @brief Advances the virtual clock by the given amount, running any timers that come due.
+    void Advance(uint64_t us);
+
+    /// @brief Drives an input pin from outside the chip, raising the GPIO IRQ if it is enabled for that edge.
+    void SetInput(uint gpio, bool level);
+
+    /// @brief Drives several input pins at the same instant, the IRQs are raised only after all of them changed
+    /// @param mask The pins to drive, bit n is GPIO n
+    /// @param levels The levels to drive them to
+    void SetInputs(uint32_t mask, uint32_t levels);
+
+    /// @brief Sets which core get_core_num() reports for the calling thread.
+    void SetCoreNum(uint core);
+
+    /// @brief The level the chip is driving on an output pin.
+    bool GetOutput(uint gpio);
+
+    /// @brief The PWM compare level of a pin as a fraction of its slice's wrap, 0 when the slice is disabled.
+    float GetPwmDuty(uint gpio);
+
+    /// @brief The PWM frequency of the slice a pin is on, from the configured divider and wrap.
+    float GetPwmFrequency(uint gpio);
+
+    /// @brief When the counter of a pin's slice was last at 0. Periods repeat from there until pwm_set_counter moves it
+    int64_t GetPwmOrigin(uint gpio);
+
+    /// @brief Double buffers the PWM compare levels of some slices like the chip, a new level takes effect at the next
+    /// @brief wrap of its slice instead of at once. Off for every slice by default, so a level is seen as soon as it is set
+    /// @param sliceMask The slices to latch, bit n is slice n
+    void SetPwmLatching(uint32_t sliceMask);
+
+    /// @brief Starts a PIO state machine running QuadratureEncoder.pio on a pin pair. It steps through the program's
+    /// @brief jump table on every SetInputs that changes its pins, where the chip samples them every 14 cycles
+    /// @param pinA Pin A, pin B is pinA + 1
+    /// @return The state machine, for QuadratureCount
+    uint ClaimQuadrature(uint pinA);
+
+    /// @brief The count the state machine would push, B leading A counting up like the program's Y
+    int32_t QuadratureCount(uint sm);
+
+} // namespace HostHAL
+#pragma endregion
+
+#endif
@@ -0,0 +1,299 @@
+#include "HostSim.h"
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include "Board.h"
+
+using Board::Role;
+using Board::PinOf;
+
+#pragma region Plant
+
+/// @brief Moves the wheel on by dt from the pins the drivetrain drives, and plays the whole counts it turned
+/// @brief through onto the encoder pins
+/// @param battery Fraction of the full battery voltage
+void Sim::MotorModel::Step(float dt, float battery) {
+    bool standby = HostHAL::GetOutput(PinOf(Role::MotorStandby));
+    bool in1 = HostHAL::GetOutput(in1Pin), in2 = HostHAL::GetOutput(in2Pin);
+    float target = 0, tau = coastTimeConstant;
+    if (standby && in1 != in2) {
+        float duty = HostHAL::GetPwmDuty(pwmPin);
+        float effective = duty * battery - deadband;
+        float direction = in2 ? 1.0f : -1.0f;
+        target = effective > 0 ? direction * topSpeed * gain * effective / (1 - deadband) : 0;
+        tau = effective > 0 ? timeConstant : brakeTimeConstant;
+    } else if (standby && in1 && in2) {
+        tau = brakeTimeConstant;
+    }
+    //Exact for the step, so a brake with a time constant near dt can not overshoot
+    speed = target + (speed - target) * std::exp(-dt / tau);
+    position += speed * countsPerMeter * dt;
+
+    //One legal Gray step per count, forward is 00, 10, 11, 01 with A first
+    static const uint8_t gray[4] = {0b00, 0b10, 0b11, 0b01};
+    while (emitted != (long)std::floor(position)) {
+        emitted += position > emitted ? 1 : -1;
+        uint8_t ab = gray[((emitted % 4) + 4) % 4];
+        HostHAL::SetInputs((1u << encoderA) | (1u << encoderB), ((uint32_t)(ab >> 1) << encoderA) | ((uint32_t)(ab & 1u) << encoderB));
+    }
+}
+
+Sim::Cell::Cell(float length, float width)
+: length(length), width(width), cells((long)(length / cell) * (long)(width / cell)), covered(0)
+{
+    swept.assign(cells, 0);
+}
+
+/// @brief Marks the floor under the swept width, which is centered on the wheel axle
+void Sim::Cell::Sweep(float x, float y, float heading, float sweptWidth) {
+    long columns = (long)(length / cell);
+    for (float s = -sweptWidth / 2; s <= sweptWidth / 2; s += cell / 2) {
+        float px = x - s * std::sin(heading), py = y + s * std::cos(heading);
+        if (px < 0 || py < 0 || px >= length || py >= width) continue;
+        long index = (long)(py / cell) * columns + (long)(px / cell);
+        if (index < cells && !swept[index]) {
+            swept[index] = 1;
+            covered++;
+        }
+    }
+}
+
+/// @brief Casts the rays of the sonar cone from the robot's pose at the walls
+/// @return the nearest wall that echoes, -1 for none in range
+float Sim::Cell::Cast(float x, float y, float heading, const SonarParams& sonar) {
+    float sx = x + sonar.sensorOffset * std::cos(heading), sy = y + sonar.sensorOffset * std::sin(heading);
+    float minSquare = std::cos(sonar.maxIncidence);
+    float nearest = 1e9f;
+    for (int i = 0; i < sonar.rays; i++) {
+        float offset = sonar.rays > 1 ? -sonar.halfAngle + 2 * sonar.halfAngle * i / (sonar.rays - 1) : 0;
+        float dx = std::cos(heading + offset), dy = std::sin(heading + offset);
+        //The first wall the ray meets, and how square on it meets it
+        float hit = 1e9f, square = 0;
+        if (dx > 1e-6f && (length - sx) / dx < hit) { hit = (length - sx) / dx; square = dx; }
+        if (dx < -1e-6f && -sx / dx < hit) { hit = -sx / dx; square = -dx; }
+        if (dy > 1e-6f && (width - sy) / dy < hit) { hit = (width - sy) / dy; square = dy; }
+        if (dy < -1e-6f && -sy / dy < hit) { hit = -sy / dy; square = -dy; }
+        if (square >= minSquare) nearest = std::min(nearest, hit);
+    }
+    nearest = nearest < 0 ? 0 : nearest;
+    return nearest > sonar.maxRange ? -1 : nearest;
+}
+
+/// @brief The robot at its start pose, standing still. The motor models take the pins of Board
+/// @param seed Seeds the sonar noise, the same seed and inputs give the same episode
+Sim::World::World(const WorldParams& params, uint32_t seed)
+: params(params), cell(params.length, params.width),
+left{PinOf(Role::LeftMotorPWM), PinOf(Role::LeftMotorIn1), PinOf(Role::LeftMotorIn2), PinOf(Role::LeftEncoderA), PinOf(Role::LeftEncoderB), params.leftGain, 0, 0, 0},
+right{PinOf(Role::RightMotorPWM), PinOf(Role::RightMotorIn1), PinOf(Role::RightMotorIn2), PinOf(Role::RightEncoderA), PinOf(Role::RightEncoderB), params.rightGain, 0, 0, 0},
+x(params.startX), y(params.startY), heading(params.startHeading), contact(false), collisions(0), joules(0), echoes(0), missed(0), silenced(0),
+random(seed), pinged(false), lastTrigger_us(0), echoRise_us(0), echoFall_us(0), echoPending(false), echoHigh(false)
+{
+}
+
+/// @brief The sensor fires on the falling edge of the 10 us trigger pulse and raises echo once its 40 kHz burst
+/// @brief is out, about 0.45 ms later. The echo stays high for the round trip, 58 us per cm, or 38 ms for none.
+/// @brief A silent ping raises nothing
+void Sim::World::Trigger(uint64_t now_us) {
+    const SonarParams& sonar = params.sonar;
+    float distance = cell.Cast(x, y, heading, sonar);
+    std::uniform_real_distribution<float> chance(0, 1);
+    std::normal_distribution<float> noise(0, sonar.noise);
+    if (sonar.silentEvery > 0 && (echoes + silenced + 1) % sonar.silentEvery == 0) {
+        silenced++;
+        return;
+    }
+    uint32_t pulse_us = 38000;
+    if (distance >= 0 && chance(random) >= sonar.dropout) {
+        float measured = std::max(0.02f, distance + noise(random));
+        pulse_us = (uint32_t)(measured * 5800);
+    } else {
+        missed++;
+    }
+    echoes++;
+    echoRise_us = now_us + 10 + 450;
+    echoFall_us = echoRise_us + pulse_us;
+    echoPending = true;
+}
+
+/// @brief One plant step: the motors and encoders, then the sonar edges and timers through the step, then the true pose
+void Sim::World::Step() {
+    const float dt = params.step_us * 1e-6f, trackWidth = Control::VelocityParams().trackWidth;
+    left.Step(dt, params.battery);
+    right.Step(dt, params.battery);
+
+    //Pings at the start of every trigger PWM period. Sensor::Distance can move the counter, so the next period start
+    //is worked out from where the counter was last at 0 every time
+    uint trigger = PinOf(Role::DistanceTrigger), echo = PinOf(Role::DistanceEcho);
+    uint64_t end = time_us_64() + params.step_us;
+    bool running = HostHAL::GetPwmDuty(trigger) > 0;
+    uint64_t period_us = running ? (uint64_t)(1e6f / HostHAL::GetPwmFrequency(trigger) + 0.5f) : 0;
+    while (true) {
+        uint64_t next = UINT64_MAX, ping = UINT64_MAX;
+        if (running) {
+            int64_t origin = HostHAL::GetPwmOrigin(trigger);
+            int64_t after = pinged ? (int64_t)lastTrigger_us + 1 : std::max<int64_t>(origin, 0);
+            int64_t periods = origin >= after ? 0 : (after - origin + (int64_t)period_us - 1) / (int64_t)period_us;
+            ping = (uint64_t)(origin + periods * (int64_t)period_us);
+            next = ping;
+        }
+        if (echoPending) next = std::min(next, echoHigh ? echoFall_us : echoRise_us);
+        if (next > end) break;
+        //A counter moved by an alarm inside the last hop can put the ping a little in the past
+        HostHAL::AdvanceTo(std::max(next, time_us_64()));
+        if (next == ping) {
+            //A trigger while the last echo is still out is ignored, like the sensor does
+            if (!echoPending) Trigger(next);
+            pinged = true;
+            lastTrigger_us = next;
+        } else if (!echoHigh) {
+            HostHAL::SetInput(echo, true);
+            echoHigh = true;
+        } else {
+            HostHAL::SetInput(echo, false);
+            echoHigh = false;
+            echoPending = false;
+        }
+    }
+    HostHAL::AdvanceTo(end);
+
+    //True pose from the wheel speeds, held inside the walls
+    float v = (left.speed + right.speed) / 2, w = (right.speed - left.speed) / trackWidth;
+    x += v * std::cos(heading + w * dt / 2) * dt;
+    y += v * std::sin(heading + w * dt / 2) * dt;
+    heading = std::remainder(heading + w * dt, 2 * (float)M_PI);
+    float r = params.radius;
+    bool touching = x < r || y < r || x > cell.length - r || y > cell.width - r;
+    if (touching && !contact) collisions++;
+    contact = touching;
+    x = std::clamp(x, r, cell.length - r);
+    y = std::clamp(y, r, cell.width - r);
+
+    //0.5 W for the electronics and 2 W per motor at full duty. Only a set direction drives, a coasting motor holds PWM high
+    float on = HostHAL::GetOutput(PinOf(Role::MotorStandby)) ? 1.0f : 0.0f;
+    float leftOn = HostHAL::GetOutput(left.in1Pin) != HostHAL::GetOutput(left.in2Pin) ? on : 0.0f;
+    float rightOn = HostHAL::GetOutput(right.in1Pin) != HostHAL::GetOutput(right.in2Pin) ? on : 0.0f;
+    float leftDuty = leftOn * HostHAL::GetPwmDuty(left.pwmPin), rightDuty = rightOn * HostHAL::GetPwmDuty(right.pwmPin);
+    joules += (0.5 + 2.0 * (leftDuty + rightDuty)) * dt;
+}
+
+#pragma endregion
+
+#pragma region Episodes
+
+/// @brief Built like core1_main builds them, the encoders on the Interrupt backend since the host has no PIO
+Sim::Core1::Core1(Sensor::TriggerParams trigger)
+: drive(PinOf(Role::MotorStandby),
+    PinOf(Role::LeftMotorPWM), PinOf(Role::LeftMotorIn1), PinOf(Role::LeftMotorIn2),
+    PinOf(Role::RightMotorPWM), PinOf(Role::RightMotorIn1), PinOf(Role::RightMotorIn2)),
+distance(PinOf(Role::DistanceTrigger), PinOf(Role::DistanceEcho), trigger),
+leftEncoder(PinOf(Role::LeftEncoderA), PinOf(Role::LeftEncoderB)),
+rightEncoder(PinOf(Role::RightEncoderA), PinOf(Role::RightEncoderB)),
+wheels(drive, leftEncoder, rightEncoder),
+odometry({Sensor::MotorEncoder::metersPerCount}),
+wall({Sensor::MotorEncoder::metersPerCount})
+{
+}
+
+/// @brief Runs one episode on the calling thread's HostHAL. Every 10 ms the odometry takes the encoder counts,
+/// @brief the distance sensor is read and the strategy runs, like control_task
+/// @param seed Seeds the sonar noise
+/// @param limit_s Simulated seconds at most
+/// @param sample Called with the result so far once a simulated second
+Sim::EpisodeResult Sim::Run(const WorldParams& params, uint32_t seed, float limit_s, const Strategy& strategy,
+    const std::function<void(const EpisodeResult&)>& sample) {
+    HostHAL::Reset();
+    //Motor levels take effect on the PWM wrap like on the chip, where Drivetrain::CommandLatch also switches the pins
+    HostHAL::SetPwmLatching((1u << pwm_gpio_to_slice_num(PinOf(Role::LeftMotorPWM))) | (1u << pwm_gpio_to_slice_num(PinOf(Role::RightMotorPWM))));
+    HostHAL::SetInputs(0xffffffffu, 0);
+    World world(params, seed);
+    Core1 core1(params.trigger);
+    core1.odometry.Reset(params.startX, params.startY, params.startHeading);
+
+    EpisodeResult result = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, params.length + params.width, 0, 0};
+    float lastX = world.x, lastY = world.y;
+    int32_t lastLeft = 0, lastRight = 0;
+    const long stepsPerTick = 10000 / params.step_us;
+    long steps = (long)(limit_s * 1e6f / params.step_us), ticks = 0;
+    bool done = false;
+    for (long i = 1; i <= steps && !done; i++) {
+        world.Step();
+        if (i % stepsPerTick != 0) continue;
+
+        ticks++;
+        if (world.contact) result.wallTicks++;
+        world.cell.Sweep(world.x, world.y, world.heading, params.sweptWidth);
+        float moved = (world.x - lastX) * std::cos(world.heading) + (world.y - lastY) * std::sin(world.heading);
+        if (moved > 0) result.forward += moved;
+        else result.backward -= moved;
+        lastX = world.x;
+        lastY = world.y;
+        float clearance = std::min(std::min(world.x, params.length - world.x), std::min(world.y, params.width - world.y)) - params.radius;
+        result.clearance = std::max(0.0f, std::min(result.clearance, clearance));
+        Sensor::EncoderState left = core1.leftEncoder.Snapshot();
+        Sensor::EncoderState right = core1.rightEncoder.Snapshot();
+        uint64_t counted_us = left.timestamp_us > right.timestamp_us ? left.timestamp_us : right.timestamp_us;
+        core1.odometry.Update(left.counts, right.counts, counted_us);
+        Sensor::DistanceReading reading = core1.distance.GetReading();
+        Navigation::WallEstimate wall = core1.wall.Update(left.counts, right.counts, counted_us, reading);
+        core1.ledger.Motor(Power::Channel::LeftMotor, core1.drive.GetLeftDuty(), left.angularVelocity, 0.01f);
+        core1.ledger.Motor(Power::Channel::RightMotor, core1.drive.GetRightDuty(), right.angularVelocity, 0.01f);
+        core1.ledger.Load(Power::Channel::Logic, 1, 0.01f);
+        core1.ledger.Travel((left.counts - lastLeft + right.counts - lastRight) / 2.0f * Sensor::MotorEncoder::metersPerCount);
+        lastLeft = left.counts;
+        lastRight = right.counts;
+        done = strategy(core1, params.wallFusion ? wall.distance : reading.distance, ticks * 0.01f);
+
+        result.seconds = ticks * 0.01f;
+        result.area = world.cell.Area();
+        result.fraction = world.cell.Fraction();
+        result.joules = (float)world.joules;
+        result.collisions = world.collisions;
+        result.echoes = world.echoes;
+        result.missed = world.missed;
+        result.ledgerJoules = core1.ledger.Joules();
+        result.meters = core1.ledger.Meters();
+        if (sample && ticks % 100 == 0) sample(result);
+    }
+    HostHAL::Reset();
+    return result;
+}
+
+/// @brief The firmware's WORK mode from the start: Control::Bouncer on the raw drive, or on the velocity loop
+/// @brief like P2_VELOCITY_CONTROL, with the episode time as the workTime
+Sim::EpisodeResult Sim::RunBouncer(const WorldParams& params, uint32_t seed, Control::BounceParams bounce, bool velocityControl, float limit_s) {
+    //The bouncer needs the drive, which only exists inside the run
+    std::optional<Control::Bouncer<Drivetrain::DualMotor>> raw;
+    std::optional<Control::Bouncer<Control::VelocityDrive<Drivetrain::DualMotor>>> closed;
+    return Run(params, seed, limit_s, [&](Core1& core1, float distance, float time) {
+        if (velocityControl) {
+            if (!closed) closed.emplace(core1.wheels, bounce);
+            closed->Step(distance, time);
+            core1.wheels.Update();
+        } else {
+            if (!raw) raw.emplace(core1.drive, bounce);
+            raw->Step(distance, time);
+        }
+        return false;
+    });
+}
+
+/// @brief The time to collision governor in WORK mode from the start, on the raw drive or on the velocity loop,
+/// @brief with the encoder speed from the mean of the wheels
+Sim::EpisodeResult Sim::RunGovernor(const WorldParams& params, uint32_t seed, Control::GovernorParams governor, bool velocityControl, float limit_s) {
+    std::optional<Control::Governor<Drivetrain::DualMotor>> raw;
+    std::optional<Control::Governor<Control::VelocityDrive<Drivetrain::DualMotor>>> closed;
+    return Run(params, seed, limit_s, [&](Core1& core1, float distance, float time) {
+        float velocity = (core1.leftEncoder.Snapshot().linearVelocity + core1.rightEncoder.Snapshot().linearVelocity) / 2;
+        if (velocityControl) {
+            if (!closed) closed.emplace(core1.wheels, governor);
+            closed->Step(distance, velocity, time);
+            core1.wheels.Update();
+        } else {
+            if (!raw) raw.emplace(core1.drive, governor);
+            raw->Step(distance, velocity, time);
+        }
+        return false;
+    });
+}
+
+#pragma endregion
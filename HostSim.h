@@ -0,0 +1,169 @@
+//Headless 2D simulator of the robot in a closed rectangular cell, for the Linux host build (P2_HOST).
+//The firmware classes run unmodified on HostHAL's simulated pins. The simulator reads the TB6612 pins the
+//drivetrain drives, turns them into wheel speeds and quantized encoder edges, and answers the distance sensor's
+//12 Hz trigger with an echo pulse ray-cast from the true pose, with noise and missed echoes.
+//
+//  Sim::EpisodeResult r = Sim::RunBouncer({}, seed, Control::BounceParams(), true);
+#ifndef HOSTSIM_H
+#define HOSTSIM_H
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+#include "HAL.h"
+#include "DriveTrain.h"
+#include "Sensor.h"
+#include "Control.h"
+#include "Velocity.h"
+#include "Odometry.h"
+#include "Fusion.h"
+#include "Power.h"
+
+namespace Sim
+{
+    #pragma region Plant
+    /// @brief First order DC gearmotor with its quadrature encoder, driven by the simulated TB6612 pins.
+    /// @brief IN1 and IN2 set the direction, both high is a short brake and both low or standby lets it coast.
+    /// @brief With a direction set the PWM low time also short brakes, so duty 0 brakes
+    struct MotorModel {
+        uint pwmPin, in1Pin, in2Pin, encoderA, encoderB;
+        float gain;             //Fraction of the nominal top speed this motor reaches
+        float speed;            //Wheel m/s
+        double position;        //Encoder counts, fractional
+        long emitted;           //Counts put on the encoder pins so far
+
+        static constexpr float topSpeed = 0.4f;     //Wheel m/s at full duty on a full battery
+        static constexpr float deadband = 0.05f;    //Duty lost to friction
+        static constexpr float timeConstant = 0.06f;
+        static constexpr float brakeTimeConstant = 0.015f;
+        static constexpr float coastTimeConstant = 0.15f;
+        static constexpr float countsPerMeter = 28 * 98.5f / (2 * (float)M_PI * 0.025f);
+
+        void Step(float dt, float battery);
+    };
+
+    /// @brief The HC-SR04 as the simulator sees it. The beam is a cone of rays, a ray that meets a wall further
+    /// @brief than maxIncidence from square on glances off and returns nothing
+    struct SonarParams {
+        float halfAngle = 0.26f;        //Radians, about 15 degrees
+        int rays = 9;                   //Across the cone
+        float maxIncidence = 1.05f;     //Radians from the wall normal
+        float noise = 0.003f;           //Meters, standard deviation
+        float dropout = 0.01f;          //Chance an echo is missed
+        int silentEvery = 0;            //Every so many pings the sensor ignores one and raises no echo, 0 for never
+        float maxRange = 4.0f;          //Meters, further reads as no echo
+        float sensorOffset = 0.08f;     //Ahead of the wheel axle
+    };
+
+    /// @brief The cell and the robot in it
+    struct WorldParams {
+        float length = 3.0f;            //Meters along x, the corner at the origin
+        float width = 2.0f;
+        float startX = 0.5f;            //The start pose, by default halfway up the cell facing along x
+        float startY = 1.0f;
+        float startHeading = 0;
+        float radius = 0.08f;           //Robot footprint, for wall contact
+        float sweptWidth = 0.16f;       //Floor covered, centered on the wheel axle
+        float leftGain = 1.0f;          //Motor strengths, see MotorModel::gain
+        float rightGain = 0.95f;
+        float battery = 1.0f;           //Fraction of the full battery voltage
+        uint32_t step_us = 200;         //Plant step
+        SonarParams sonar;
+        Sensor::TriggerParams trigger;  //How core1 pings the distance sensor
+        bool wallFusion = false;        //Strategies get the fused wall distance, like P2_WALL_FUSION
+    };
+
+    /// @brief A closed rectangular cell with a 1 cm grid of the floor the robot has swept
+    struct Cell {
+        float length, width;
+        std::vector<uint8_t> swept;
+        long cells, covered;
+
+        static constexpr float cell = 0.01f;
+
+        Cell(float length, float width);
+
+        void Sweep(float x, float y, float heading, float sweptWidth);
+        float Cast(float x, float y, float heading, const SonarParams& sonar);
+
+        float Area() { return covered * cell * cell; }
+        float Fraction() { return (float)covered / cells; }
+    };
+
+    /// @brief The plant: the motors, the true pose, the sonar and the energy used. Each Step moves the virtual
+    /// @brief clock on by one plant step, with the echo edges put on the pin at their own times inside it
+    class World {
+        public:
+            World(const WorldParams& params, uint32_t seed);
+
+            void Step();
+
+            /// @brief The ideal sonar reading from the true pose, without noise or dropouts
+            float TrueDistance() { return cell.Cast(x, y, heading, params.sonar); }
+
+            WorldParams params;
+            Cell cell;
+            MotorModel left, right;
+            float x, y, heading;        //True pose
+            bool contact;               //Pressed against a wall
+            long collisions;            //Times it ran into a wall
+            double joules;              //Motors and electronics
+            long echoes, missed;        //Echo pulses played, and of those no echo
+            long silenced;              //Pings the sensor ignored, see SonarParams::silentEvery
+
+        protected:
+            World() = delete;
+
+            void Trigger(uint64_t now_us);
+
+            std::mt19937 random;
+            bool pinged;
+            uint64_t lastTrigger_us;
+            uint64_t echoRise_us, echoFall_us;
+            bool echoPending, echoHigh;
+    };
+    #pragma endregion
+
+    #pragma region Episodes
+    /// @brief The core1 objects of p2.cpp on the simulated pins
+    struct Core1 {
+        Drivetrain::DualMotor drive;
+        Sensor::Distance distance;
+        Sensor::MotorEncoder leftEncoder, rightEncoder;
+        Control::VelocityDrive<Drivetrain::DualMotor> wheels;
+        Navigation::Odometry odometry;
+        Navigation::WallEstimator wall;
+        Power::Ledger ledger;
+
+        Core1(Sensor::TriggerParams trigger = Sensor::TriggerParams());
+    };
+
+    /// @brief The result of one episode
+    struct EpisodeResult {
+        float seconds;      //Until done, or the time limit
+        float area;         //Square meters swept
+        float fraction;     //Of the cell
+        float joules;       //Motors and electronics
+        long collisions;    //Times it ran into a wall
+        long wallTicks;     //Control ticks spent pressed against a wall
+        long echoes, missed;
+        float forward;      //Meters the true pose moved forward, and backward
+        float backward;
+        float clearance;    //Closest the robot's edge came to a wall in meters, 0 on contact
+        float ledgerJoules; //What Power::Ledger works out the firmware drew, from its duties and encoders
+        float meters;       //Driven by the encoders, the Ledger's distance
+    };
+
+    /// @brief Runs once per 10 ms control tick like control_task, with the distance reading of that tick, or the
+    /// @brief fused estimate with wallFusion, and the time since the start. Returns true once done
+    typedef std::function<bool(Core1& core1, float distance, float time)> Strategy;
+
+    EpisodeResult Run(const WorldParams& params, uint32_t seed, float limit_s, const Strategy& strategy,
+        const std::function<void(const EpisodeResult&)>& sample = nullptr);
+    EpisodeResult RunBouncer(const WorldParams& params, uint32_t seed, Control::BounceParams bounce, bool velocityControl, float limit_s = 60);
+    EpisodeResult RunGovernor(const WorldParams& params, uint32_t seed, Control::GovernorParams governor, bool velocityControl, float limit_s = 60);
+    #pragma endregion
+} // namespace Sim
+
+#endif
@@ -0,0 +1,41 @@
+//What the two cores say to each other. Core0 owns the button, the mode and the battery clock and sends
+//Commands, core1 owns the motors and sensors and sends Telemetry back. See Buffer::Channel.
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Message
+{
+    enum class CommandType : uint8_t {
+        SetMode,        //value is the mode count, even for PAUSE and odd for WORK
+        SetWorkTime,    //value is the accumulated WORK mode seconds
+        SetSpeedLimit,  //value is the highest duty the drivetrain may use, 0 to 1
+        DumpTrace,      //Stop the motors and send the trace rings, value is unused
+    };
+
+    /// @brief Core0 to core1
+    struct Command {
+        CommandType type;
+        float value;
+    };
+
+    /// @brief Core1 to core0. The first one core1 sends means it finished booting
+    struct Telemetry {
+        uint32_t sequence;
+        uint64_t timestamp_us;
+        float distance;         //Meters, -1 when out of range
+        float leftVelocity;     //Wheel linear velocity in m/s
+        float rightVelocity;
+        float leftDuty;         //Motor duty, 0 to 1
+        float rightDuty;
+        int32_t mode;           //The mode core1 is acting on
+    };
+
+    /// @brief Channel capacities, powers of two
+    inline constexpr size_t commandCapacity = 16;
+    inline constexpr size_t telemetryCapacity = 16;
+} // namespace Message
+
+#endif
@@ -0,0 +1,87 @@
+#include "Odometry.h"
+#include <cmath>
+
+#pragma region Odometry
+
+/// @brief Starts at the origin facing along x
+/// @param params The drive geometry, metersPerCount usually Sensor::MotorEncoder::metersPerCount
+Navigation::Odometry::Odometry(OdometryParams params)
+: params(params), haveCounts(false), lastLeft(0), lastRight(0)
+{
+    Reset();
+}
+
+/// @brief Moves the pose along by the counts since the last call. The first call only takes the counts as a start
+/// @param leftCounts The left encoder's total count, counting up going forward
+/// @param rightCounts The right encoder's total count, counting up going forward
+/// @param timestamp_us When the counts were read
+void Navigation::Odometry::Update(int32_t leftCounts, int32_t rightCounts, uint64_t timestamp_us) {
+    if (!haveCounts) {
+        haveCounts = true;
+        lastLeft = leftCounts;
+        lastRight = rightCounts;
+    }
+    float left = (leftCounts - lastLeft) * params.metersPerCount;
+    float right = (rightCounts - lastRight) * params.metersPerCount;
+    lastLeft = leftCounts;
+    lastRight = rightCounts;
+
+    float b = params.trackWidth;
+    float ds = (right + left) / 2;
+    float dh = (right - left) / b;
+    float mid = pose.heading + dh / 2;
+    float c = std::cos(mid);
+    float s = std::sin(mid);
+
+    //Covariance, P = Fp P Fp' + Fu Q Fu', with Q the per wheel slip variance
+    float P[3][3] = {
+        {pose.covariance[0], pose.covariance[1], pose.covariance[2]},
+        {pose.covariance[1], pose.covariance[3], pose.covariance[4]},
+        {pose.covariance[2], pose.covariance[4], pose.covariance[5]},
+    };
+    float Fp[3][3] = {
+        {1, 0, -ds * s},
+        {0, 1, ds * c},
+        {0, 0, 1},
+    };
+    float Fu[3][2] = {
+        {c / 2 - ds / (2 * b) * s, c / 2 + ds / (2 * b) * s},
+        {s / 2 + ds / (2 * b) * c, s / 2 - ds / (2 * b) * c},
+        {1 / b, -1 / b},
+    };
+    float Q[2] = {params.slip * std::fabs(right), params.slip * std::fabs(left)};
+
+    float FP[3][3] = {};
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            for (int k = 0; k < 3; k++) FP[i][j] += Fp[i][k] * P[k][j];
+    float next[3][3] = {};
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            for (int k = 0; k < 3; k++) next[i][j] += FP[i][k] * Fp[j][k];
+            next[i][j] += Fu[i][0] * Q[0] * Fu[j][0] + Fu[i][1] * Q[1] * Fu[j][1];
+        }
+    }
+
+    pose.x += ds * c;
+    pose.y += ds * s;
+    pose.heading = std::remainder(pose.heading + dh, 2 * (float)M_PI);
+    pose.covariance[0] = next[0][0];
+    pose.covariance[1] = next[0][1];
+    pose.covariance[2] = next[0][2];
+    pose.covariance[3] = next[1][1];
+    pose.covariance[4] = next[1][2];
+    pose.covariance[5] = next[2][2];
+    pose.distance += std::fabs(ds);
+    pose.timestamp_us = timestamp_us;
+    pose.sequence++;
+    published.Write(pose);
+}
+
+/// @brief Sets the pose and clears its uncertainty, the encoder counts carry on from where they are
+void Navigation::Odometry::Reset(float x, float y, float heading) {
+    pose = {x, y, heading, {0, 0, 0, 0, 0, 0}, 0, time_us_64(), 0};
+    published.Write(pose);
+}
+
+#pragma endregion
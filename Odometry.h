@@ -0,0 +1,54 @@
+#ifndef ODOMETRY_H
+#define ODOMETRY_H
+
+#include "HAL.h"
+#include "Snapshot.h"
+
+namespace Navigation
+{
+    /// @brief Where the robot is, relative to where odometry started or was last reset
+    struct Pose {
+        float x;                //Meters forward of the start
+        float y;                //Meters left of the start
+        float heading;          //Radians, counter clockwise, wrapped to -pi to pi
+        float covariance[6];    //Upper triangle of the x, y, heading covariance: xx, xy, xh, yy, yh, hh
+        float distance;         //Meters travelled by the center, always growing
+        uint64_t timestamp_us;  //Time of the counts the pose was worked out from
+        uint32_t sequence;      //Updates so far
+    };
+
+    /// @brief Geometry and error model of the differential drive
+    struct OdometryParams {
+        float metersPerCount;   //Wheel travel per encoder count
+        float trackWidth = 0.15f;   //Meters between the wheel contact points
+        float slip = 0.0001f;       //Wheel travel variance in m^2 per meter travelled by that wheel, 1 cm sigma per meter
+    };
+
+    /// @brief Dead reckoning from the two wheel encoder counts. Works on whole counts, not the quantized
+    /// @brief velocities, so no motion is lost between updates however late one runs. Each step integrates
+    /// @brief at the midpoint heading and grows the covariance with the usual wheel slip model, where
+    /// @brief each wheel's variance grows with the distance it travelled.
+    /// @brief One writer calls Update, any core reads the pose through Snapshot.
+    class Odometry {
+        public:
+            Odometry(OdometryParams params);
+
+            void Update(int32_t leftCounts, int32_t rightCounts, uint64_t timestamp_us);
+            void Reset(float x = 0, float y = 0, float heading = 0);
+
+            /// @brief The pose of the last Update, tear-free from either core
+            Pose Snapshot() { return published.Read(); }
+
+        protected:
+            Odometry() = delete;
+
+            OdometryParams params;
+            Pose pose;
+            bool haveCounts;
+            int32_t lastLeft;
+            int32_t lastRight;
+            Buffer::Seqlock<Pose> published;
+    };
+} // namespace Navigation
+
+#endif
@@ -3,7 +3,7 @@
 #pragma region LED
 /// @brief Creates a PWMLED using a non-default constructr for PWMPIN
 /// @param pin the GPIO Pin to use for PWMLED
-PWM::LED::LED(uint pin) : PWM::PIN(pin, 1000, 65535) {
+PWM::LED::LED(uint pin) : PWM::PIN(pin, frequency, wrapCounter) {
 
 }
 
@@ -16,7 +16,7 @@ PWM::LED::LED(uint pin) : PWM::PIN(pin, 1000, 65535) {
 /// @param pin1 the pin that will be GPIO Pin1, this is the pin that will be OFF for forwards
 /// @param pin2  The pin that will be GPIO Pin2, this is the pin that will be on for forwards
 PWM::MOTOR::MOTOR(uint pwmPin, uint pin1, uint pin2) 
-: PWM::PIN(pwmPin, 1000, 65535), 
+: PWM::PIN(pwmPin, frequency, wrapCounter), 
 Pin1(pin1, true),
 Pin2(pin2, true)
 {
@@ -68,14 +68,22 @@ PWM::PIN::PIN(uint pin, int frequency, int wrapCounter)
     SLICE = pwm_gpio_to_slice_num(pinID);
     CHANNEL = pwm_gpio_to_channel(pinID);
     pwm_init(SLICE, &config, true);
-    pwm_set_enabled(pinID, true);
+    pwm_set_enabled(SLICE, true);
+}
+
+/// @param frequency The wanted frequency in Hz, as given to PWM::PIN
+/// @param wrapCounter The counts per period, as given to PWM::PIN
+float PWM::Tick_us(int frequency, int wrapCounter) {
+    //The same integer division PWM::PIN does, so the tick it really gets and not the one it asked for
+    uint32_t divider = clock_get_hz(clk_sys) / (frequency * wrapCounter);
+    return divider * 1e6f / clock_get_hz(clk_sys);
 }
 
     /// @brief Sets the duty of the to the exact given value.
     /// @param duty The duty value, this is capped by WRAPCOUNTER stored in the pin
 void PWM::PIN::SetDuty(uint duty) 
 {
-    pwm_set_gpio_level(pinID, (duty < WRAPCOUNTER ? duty : WRAPCOUNTER));
+    pwm_set_chan_level(SLICE, CHANNEL, (duty < WRAPCOUNTER ? duty : WRAPCOUNTER));
     currentDuty = (duty < WRAPCOUNTER ? duty : WRAPCOUNTER) / WRAPCOUNTER;
 }
     /// @brief Sets the duty to the float percentage
@@ -83,7 +91,7 @@ void PWM::PIN::SetDuty(uint duty)
 void PWM::PIN::SetDuty(float duty) 
 {
     assert( 0 <= duty && duty <= 1 && "Duty must be float between 0 and 1");
-    pwm_set_gpio_level(pinID, duty * WRAPCOUNTER);
+    pwm_set_chan_level(SLICE, CHANNEL, duty * WRAPCOUNTER);
     currentDuty = duty;
 }
 
@@ -124,7 +132,8 @@ void PWM::PIN::FadeDown(int msecs, float peak, volatile std::atomic<int>& diffVa
     /// @brief Sets duty to 0
 void PWM::PIN::Stop() 
 {
-    pwm_set_gpio_level(pinID, 0);
+    pwm_set_chan_level(SLICE, CHANNEL, 0);
+    currentDuty = 0;
 }
 
 /// @brief Toggles the duty between 0 and 1
@@ -157,6 +166,15 @@ bool PWM::PIN::GetState() {
     return currentDuty == 0 ? 0 : 1; 
 }
 
+/// @brief Moves the counter so the current period ends, and the next starts with its high time, the given time from now.
+/// @brief Safe from an ISR, it is one register write
+/// @param us Time to the next period, 0 starts it now
+void PWM::PIN::WrapIn(uint32_t us) {
+    uint32_t ticks = (uint32_t)((uint64_t)us * FREQUENCY * WRAPCOUNTER / 1000000);
+    if (ticks >= (uint32_t)WRAPCOUNTER) return;
+    pwm_set_counter(SLICE, ticks == 0 ? 0 : WRAPCOUNTER - ticks);
+}
+
 /// @brief Gets the current float range from 0 to 1 of the duty
 /// @return 0 to 1, duty percentage
 float PWM::PIN::GetDuty() {
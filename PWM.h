@@ -6,6 +6,9 @@
 
 namespace PWM
 {
+    /// @brief The counter tick PWM::PIN and Static::PwmPin set up, with their whole number divider
+    /// @return microseconds per count
+    float Tick_us(int frequency, int wrapCounter);
 
     class PIN : GPIO::PIN{
 
@@ -24,6 +27,8 @@ namespace PWM
             virtual void SetState(bool IsOn);
             virtual bool GetState();
             virtual float GetDuty();
+
+            void WrapIn(uint32_t us);
             
             using GPIO::PIN::GetPin;
             using GPIO::PIN::ToggleEvery;
@@ -44,6 +49,9 @@ namespace PWM
         public:
             LED(uint pin);
 
+            static constexpr int frequency = 1000;
+            static constexpr int wrapCounter = 65535;
+
             using PIN::Toggle;
             using PIN::SetState;
             using PIN::FadeDown;
@@ -63,6 +71,9 @@ namespace PWM
         public:
             MOTOR(uint pwmPin, uint pin1, uint pin2);
 
+            static constexpr int frequency = 1000;
+            static constexpr int wrapCounter = 65535;
+
             using PIN::GetDuty;
             using PIN::Stop;
 
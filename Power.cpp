@@ -0,0 +1,126 @@
+#include "Power.h"
+#include <cmath>
+
+#pragma region Ledger
+
+//Open circuit voltage of one Li-ion cell at 0%, 10% ... 100% charge
+static constexpr float cellVoltage[11] = {3.00f, 3.45f, 3.60f, 3.68f, 3.74f, 3.79f, 3.85f, 3.92f, 4.00f, 4.08f, 4.20f};
+
+/// @brief Starts on a full pack with nothing drawn
+/// @param battery The pack, the fixed loads and the run budget
+/// @param motor The gearmotor model both motors share
+Power::Ledger::Ledger(BatteryParams battery, MotorParams motor)
+: battery(battery), motor(motor)
+{
+    Reset();
+}
+
+/// @brief Forgets everything drawn, as on a freshly charged pack
+void Power::Ledger::Reset() {
+    for (int i = 0; i < (int)Channel::Count; i++) {
+        dutySeconds[i] = 0;
+        coulombs[i] = 0;
+        joules[i] = 0;
+        current[i] = 0;
+    }
+    meters = 0;
+}
+
+/// @brief Accounts one motor over a tick. The winding current is what the averaged PWM voltage leaves over the
+/// @brief back EMF of the turning wheel, and the pack supplies it only for the on part of each period
+/// @param duty The PWM duty, 0 to 1 in either direction
+/// @param wheelAngularVelocity The wheel's rad/s from the encoder
+/// @param seconds The tick length
+void Power::Ledger::Motor(Channel channel, float duty, float wheelAngularVelocity, float seconds) {
+    duty = std::fabs(duty);
+    float winding = (duty * Voltage() - motor.backEmf * std::fabs(wheelAngularVelocity)) / motor.resistance;
+    Draw(channel, duty, winding > 0 ? duty * winding : 0, seconds);
+}
+
+/// @brief Accounts an LED or the logic over a tick, drawing its full current times the duty
+/// @param duty The PWM duty or brightness, 0 to 1, 1 for the logic
+/// @param seconds The tick length
+void Power::Ledger::Load(Channel channel, float duty, float seconds) {
+    float full = channel == Channel::Logic ? battery.logicCurrent : battery.ledCurrent;
+    Draw(channel, duty, duty * full, seconds);
+}
+
+/// @brief Adds driven distance, for JoulesPerMeter
+void Power::Ledger::Travel(float meters) {
+    this->meters = this->meters + std::fabs(meters);
+}
+
+void Power::Ledger::Draw(Channel channel, float duty, float amps, float seconds) {
+    int i = (int)channel;
+    current[i] = amps;
+    dutySeconds[i] = dutySeconds[i] + duty * seconds;
+    coulombs[i] = coulombs[i] + amps * seconds;
+    joules[i] = joules[i] + Voltage() * amps * seconds;
+}
+
+/// @brief What one channel has drawn so far. The fields are read one by one, so a sample landing between two
+/// @brief reads may show in some of them only
+Power::ChannelTotals Power::Ledger::Totals(Channel channel) {
+    int i = (int)channel;
+    return {dutySeconds[i], coulombs[i], joules[i], current[i]};
+}
+
+/// @brief The pack voltage at no load, from the charge left
+float Power::Ledger::OpenCircuitVoltage() {
+    float used = 0;
+    for (int i = 0; i < (int)Channel::Count; i++) used += coulombs[i];
+    float charge = 1 - used / (battery.capacity * 3600);
+    charge = charge < 0 ? 0 : charge > 1 ? 1 : charge;
+    int step = (int)(charge * 10);
+    step = step < 9 ? step : 9;
+    float fraction = charge * 10 - step;
+    return battery.cells * (cellVoltage[step] + fraction * (cellVoltage[step + 1] - cellVoltage[step]));
+}
+
+/// @brief The pack voltage under the last sampled currents, lower than the open circuit by the internal resistance
+float Power::Ledger::Voltage() {
+    float amps = 0;
+    for (int i = 0; i < (int)Channel::Count; i++) amps += current[i];
+    return OpenCircuitVoltage() - amps * battery.internalResistance;
+}
+
+/// @brief The fraction of the run budget left, or of the pack's charge without a budget, 0 to 1
+float Power::Ledger::Remaining() {
+    float left;
+    if (battery.budget > 0) {
+        left = 1 - Joules() / battery.budget;
+    } else {
+        float used = 0;
+        for (int i = 0; i < (int)Channel::Count; i++) used += coulombs[i];
+        left = 1 - used / (battery.capacity * 3600);
+    }
+    return left > 0 ? left : 0;
+}
+
+/// @brief The stage of the run from the energy left
+Power::Level Power::Ledger::GetLevel() {
+    float left = Remaining();
+    if (left <= 0) return Level::Empty;
+    if (left <= battery.critical) return Level::Critical;
+    if (left <= battery.low) return Level::Low;
+    return Level::Normal;
+}
+
+/// @brief The energy used as seconds of a run of the given length, for the workTime thresholds
+float Power::Ledger::UsedTime(float runSeconds) {
+    return (1 - Remaining()) * runSeconds;
+}
+
+/// @brief Joules drawn from the pack by every channel
+float Power::Ledger::Joules() {
+    float total = 0;
+    for (int i = 0; i < (int)Channel::Count; i++) total += joules[i];
+    return total;
+}
+
+/// @brief Joules drawn per meter driven, the cost of a motion strategy. 0 before the wheels have turned
+float Power::Ledger::JoulesPerMeter() {
+    return meters > 0 ? Joules() / meters : 0;
+}
+
+#pragma endregion
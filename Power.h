@@ -0,0 +1,94 @@
+//Energy accounting of the robot: what each PWM channel drew from the two 18650 cells and what is left.
+//Each channel has one writer, the motors core1's control task and the LEDs and logic core0's LED task, so both
+//cores feed one Ledger without a lock. The totals are read per channel and may be a tick apart from each other.
+#ifndef POWER_H
+#define POWER_H
+
+#include <cstdint>
+
+namespace Power
+{
+    /// @brief What draws from the battery, one accumulator each
+    enum class Channel : uint8_t {
+        LeftMotor,
+        RightMotor,
+        RedLed,
+        BlueLed,
+        GreenLed,
+        Logic,      //Pico, distance sensor and the TB6612 logic, drawn all the time
+        Count,
+    };
+
+    /// @brief A DC gearmotor on the TB6612, referred to the wheel
+    struct MotorParams {
+        float resistance = 3.75f;       //Ohm, a 1.6 A stall at 6 V
+        float backEmf = 0.5f;           //V per wheel rad/s, 0.4 m/s free running on a full pack
+    };
+
+    /// @brief Two 18650 cells in series and the fixed loads on them
+    struct BatteryParams {
+        int cells = 2;
+        float capacity = 2.5f;          //Ah
+        float internalResistance = 0.08f;   //Ohm for the pack
+        float logicCurrent = 0.05f;     //A, Channel::Logic
+        float ledCurrent = 0.012f;      //A per LED at full duty
+        float budget = 130;             //Joules the run may use, about 60 s of bouncing, 0 for the whole pack
+        float low = 0.25f;              //Fraction of the budget left at Level::Low, the old 45 of 60 s
+        float critical = 0.0833f;       //And at Level::Critical, the old 55 of 60 s
+    };
+
+    /// @brief The 45/55/60 s stages of the run, from the energy left
+    enum class Level : uint8_t {
+        Normal,
+        Low,        //The bouncer halves its speed and the LED turns blue
+        Critical,   //The red LED blinks
+        Empty,      //The run ends
+    };
+
+    /// @brief What one channel has drawn so far
+    struct ChannelTotals {
+        float dutySeconds;      //Duty integrated over time
+        float coulombs;
+        float joules;
+        float current;          //A at the last sample
+    };
+
+    /// @brief Integrates the duty of every channel over time into the charge and energy drawn, against a
+    /// @brief Li-ion pack whose voltage falls with the charge used and sags with the current
+    class Ledger {
+        public:
+            Ledger(BatteryParams battery = BatteryParams(), MotorParams motor = MotorParams());
+
+            void Motor(Channel channel, float duty, float wheelAngularVelocity, float seconds);
+            void Load(Channel channel, float duty, float seconds);
+            void Travel(float meters);
+            void Reset();
+
+            float OpenCircuitVoltage();
+            float Voltage();
+            float Remaining();
+            Level GetLevel();
+            float UsedTime(float runSeconds);
+            float Joules();
+            float JoulesPerMeter();
+
+            ChannelTotals Totals(Channel channel);
+
+            /// @brief Meters the wheels have driven, forwards or backwards
+            float Meters() { return meters; }
+
+        protected:
+            void Draw(Channel channel, float duty, float current, float seconds);
+
+            BatteryParams battery;
+            MotorParams motor;
+            //One writer per channel, see the top of the file
+            volatile float dutySeconds[(int)Channel::Count];
+            volatile float coulombs[(int)Channel::Count];
+            volatile float joules[(int)Channel::Count];
+            volatile float current[(int)Channel::Count];
+            volatile float meters;
+    };
+} // namespace Power
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef QUADRATURE_H
+#define QUADRATURE_H
+
+#include <cstdint>
+
+namespace Sensor {
+
+    /// @brief Table driven quadrature decoder. Feed it every sampled AB pair (A in bit 1, B in bit 0)
+    /// @brief Forward is A leading B: 00 -> 10 -> 11 -> 01 -> 00
+    class QuadratureDecoder {
+        public:
+            QuadratureDecoder(uint8_t ab = 0) : state(ab & 3u), errors(0) {}
+
+            /// @brief Decodes the move from the last AB pair to this one
+            /// @param ab The newly sampled pins, A in bit 1 and B in bit 0
+            /// @return +1 or -1 for a step, 0 for no change or an illegal transition
+            int Update(uint8_t ab) {
+                int8_t step = transitionTable[(state << 2) | (ab & 3u)];
+                state = ab & 3u;
+                if (step == illegal) {
+                    errors = errors + 1;
+                    return 0;
+                }
+                return step;
+            }
+
+            /// @brief Sets the last AB pair without counting, used when the pins are first read
+            void Reset(uint8_t ab) { state = ab & 3u; }
+
+            /// @brief Transitions where both pins changed at once, meaning an edge was missed
+            uint32_t ErrorCounts() { return errors; }
+
+        protected:
+            static constexpr int8_t illegal = 2;
+
+            /// @brief Indexed by the previous AB pair in the high two bits and the new pair in the low two bits
+            static constexpr int8_t transitionTable[16] = {
+                 0, -1, +1, illegal,  //From 00
+                +1,  0, illegal, -1,  //From 01
+                -1, illegal,  0, +1,  //From 10
+                illegal, +1, -1,  0,  //From 11
+            };
+
+            volatile uint8_t state;
+            volatile uint32_t errors;
+    };
+}
+
+#endif
@@ -0,0 +1,68 @@
+#include "Recorder.h"
+#include "Telemetry.h"
+#include <cstring>
+
+Replay::Recorder Replay::recorder;
+
+#pragma region Recorder
+
+/// @brief Sends the waiting inputs as Input frames, core0's ring first. The consumer side of both rings
+/// @param sink Gets each frame
+/// @param sequence The frame counter of the stream the frames go into
+/// @param maxFrames The most frames to send this call, so a burst can not flood the stream
+/// @return the frames sent
+size_t Replay::Recorder::Drain(Sink sink, void* context, uint16_t& sequence, size_t maxFrames) {
+    uint8_t frame[Telemetry::maxFrame];
+    Input inputs[inputsPerFrame];
+    size_t frames = 0;
+    for (auto& ring : rings) {
+        while (frames < maxFrames && !ring.Empty()) {
+            size_t count = 0;
+            while (count < inputsPerFrame && ring.Pop(inputs[count])) count++;
+            sink(frame, EncodeInputs(inputs, count, sequence++, frame), context);
+            frames++;
+        }
+    }
+    return frames;
+}
+
+#pragma endregion
+
+#pragma region Frames
+
+/// @brief Packs up to inputsPerFrame inputs into an Input frame
+/// @return the frame length in bytes
+size_t Replay::EncodeInputs(const Input* inputs, size_t count, uint16_t sequence, uint8_t* frame) {
+    uint8_t payload[1 + inputsPerFrame * inputSize];
+    count = count < inputsPerFrame ? count : inputsPerFrame;
+    payload[0] = (uint8_t)count;
+    uint8_t* out = payload + 1;
+    for (size_t i = 0; i < count; i++) {
+        std::memcpy(out, &inputs[i].timestamp_us, 4);
+        std::memcpy(out + 4, &inputs[i].value, 4);
+        out[8] = inputs[i].pin;
+        out[9] = (uint8_t)inputs[i].kind;
+        out += inputSize;
+    }
+    return Telemetry::EncodeFrame(Telemetry::FrameType::Input, sequence, payload, out - payload, frame);
+}
+
+/// @brief Unpacks an Input frame payload
+/// @param inputs Room for inputsPerFrame inputs
+/// @return false when the payload is malformed
+bool Replay::DecodeInputs(const uint8_t* payload, size_t length, Input* inputs, size_t& count) {
+    if (length < 1) return false;
+    count = payload[0];
+    if (count > inputsPerFrame || length < 1 + count * inputSize) return false;
+    const uint8_t* in = payload + 1;
+    for (size_t i = 0; i < count; i++) {
+        std::memcpy(&inputs[i].timestamp_us, in, 4);
+        std::memcpy(&inputs[i].value, in + 4, 4);
+        inputs[i].pin = in[8];
+        inputs[i].kind = (InputKind)in[9];
+        in += inputSize;
+    }
+    return true;
+}
+
+#pragma endregion
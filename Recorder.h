@@ -0,0 +1,76 @@
+//Raw input recording. Build with -DP2_RECORD=ON to capture every GPIO edge (echo pulses, button, interrupt
+//backend encoder edges) and the PIO encoder counts of every velocity tick, with timestamps, into the telemetry
+//stream as Input frames. On Linux, Replay::Session feeds a capture back through the sensor classes and the
+//core1 decision logic under the virtual clock, see Replay.h and p2_replay.
+//
+//  RECORD_EDGE(pin, events);   //From the GPIO IRQ dispatch
+//  RECORD_COUNTS(pin, counts); //From the encoder velocity tick, pin is the encoder's pin A
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "HAL.h"
+#include "RingBuffer.h"
+
+namespace Replay
+{
+    enum class InputKind : uint8_t {
+        Edge,       //value is the GPIO edge events, GPIO_IRQ_EDGE_RISE and or GPIO_IRQ_EDGE_FALL
+        Counts,     //value is the encoder count
+    };
+
+    /// @brief One raw input
+    struct Input {
+        uint32_t timestamp_us;  //time_us_32
+        int32_t value;
+        uint8_t pin;
+        InputKind kind;
+    };
+
+    /// @brief Receives the Input frames, one complete frame per call
+    typedef void (*Sink)(const uint8_t* data, size_t length, void* context);
+
+    /// @brief Collects inputs from the ISRs of both cores, one single producer ring per core. All of the
+    /// @brief recording IRQs run at the SDK's default priority, so on one core they never interrupt each other.
+    /// @brief One core drains both rings into the stream.
+    class Recorder {
+        public:
+            void Edge(uint pin, uint32_t events) {
+                rings[get_core_num()].Push({time_us_32(), (int32_t)(events & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL)), (uint8_t)pin, InputKind::Edge});
+            }
+            void Counts(uint pin, int32_t counts) {
+                rings[get_core_num()].Push({time_us_32(), counts, (uint8_t)pin, InputKind::Counts});
+            }
+
+            size_t Drain(Sink sink, void* context, uint16_t& sequence, size_t maxFrames);
+
+            /// @brief Inputs lost because the stream fell behind. A replay of a capture with drops is not faithful
+            uint32_t Dropped() { return rings[0].Dropped() + rings[1].Dropped(); }
+
+            /// @brief Inputs per core, a power of two. About a second of echoes and PIO encoder ticks
+            static constexpr size_t capacity = 256;
+
+        protected:
+            Buffer::Ring<Input, capacity> rings[2];
+    };
+
+    extern Recorder recorder;
+
+    #pragma region Frames
+    /// @brief Inputs in one Input frame, the payload is the count and the inputs
+    inline constexpr size_t inputSize = 10;
+    inline constexpr size_t inputsPerFrame = 25;
+
+    size_t EncodeInputs(const Input* inputs, size_t count, uint16_t sequence, uint8_t* frame);
+    bool DecodeInputs(const uint8_t* payload, size_t length, Input* inputs, size_t& count);
+    #pragma endregion
+} // namespace Replay
+
+#ifdef P2_RECORD
+#define RECORD_EDGE(pin, events) Replay::recorder.Edge(pin, events)
+#define RECORD_COUNTS(pin, counts) Replay::recorder.Counts(pin, counts)
+#else
+#define RECORD_EDGE(pin, events) ((void)0)
+#define RECORD_COUNTS(pin, counts) ((void)0)
+#endif
+
+#endif
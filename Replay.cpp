@@ -0,0 +1,222 @@
+#include "Replay.h"
+#include <stdio.h>
+#include <algorithm>
+#include <cstring>
+#include "Board.h"
+#include "DriveTrain.h"
+#include "Sensor.h"
+#include "Velocity.h"
+#include "Telemetry.h"
+
+using Board::Role;
+using Board::PinOf;
+
+#pragma region Captures
+
+/// @brief Reads the Input frames out of a telemetry capture file, skipping every other frame type
+/// @param lostFrames Set to the frames the decoder found missing or damaged, any of them may have held inputs
+std::vector<Replay::Input> Replay::ReadCapture(const char* path, uint32_t* lostFrames) {
+    std::vector<uint8_t> data;
+    FILE* file = fopen(path, "rb");
+    if (!file) return {};
+    uint8_t block[4096];
+    size_t got;
+    while ((got = fread(block, 1, sizeof(block), file)) > 0) data.insert(data.end(), block, block + got);
+    fclose(file);
+    return ReadCapture(data.data(), data.size(), lostFrames);
+}
+
+/// @brief Reads the Input frames out of a telemetry capture in memory
+std::vector<Replay::Input> Replay::ReadCapture(const uint8_t* data, size_t length, uint32_t* lostFrames) {
+    std::vector<Input> inputs;
+    Telemetry::Decoder decoder;
+    Telemetry::Frame frame;
+    Input decoded[inputsPerFrame];
+    for (size_t i = 0; i < length; i++) {
+        decoder.Push(data[i]);
+        while (decoder.Next(frame)) {
+            size_t count;
+            if (frame.type == Telemetry::FrameType::Input && DecodeInputs(frame.payload, frame.length, decoded, count)) {
+                inputs.insert(inputs.end(), decoded, decoded + count);
+            }
+        }
+    }
+    if (lostFrames) *lostFrames = decoder.Lost() + decoder.CrcErrors();
+    return inputs;
+}
+
+/// @brief FNV-1a over the decisions and poses of a replay, equal digests mean identical behaviour
+uint64_t Replay::Digest(const std::vector<Tick>& ticks) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash ^= ((const uint8_t*)data)[i];
+            hash *= 0x100000001b3ull;
+        }
+    };
+    for (const Tick& tick : ticks) {
+        mix(&tick.timestamp_us, sizeof(tick.timestamp_us));
+        mix(&tick.distance, sizeof(tick.distance));
+        mix(&tick.mode, sizeof(tick.mode));
+        mix(&tick.leftDuty, sizeof(tick.leftDuty));
+        mix(&tick.rightDuty, sizeof(tick.rightDuty));
+        mix(&tick.pose.x, sizeof(tick.pose.x));
+        mix(&tick.pose.y, sizeof(tick.pose.y));
+        mix(&tick.pose.heading, sizeof(tick.pose.heading));
+    }
+    return hash;
+}
+
+/// @brief The first tick two replays decided differently on, the mode or a motor duty
+/// @return the tick index, or -1 when they agree all the way
+long Replay::FirstDifference(const std::vector<Tick>& a, const std::vector<Tick>& b) {
+    size_t common = a.size() < b.size() ? a.size() : b.size();
+    for (size_t i = 0; i < common; i++) {
+        if (a[i].mode != b[i].mode || a[i].leftDuty != b[i].leftDuty || a[i].rightDuty != b[i].rightDuty) return (long)i;
+    }
+    return a.size() == b.size() ? -1 : (long)common;
+}
+
+#pragma endregion
+
+#pragma region Session
+
+/// @brief Turns the inputs into pin changes on the virtual clock, starting at the first input
+/// @param inputs In stream order, which is time order per core
+/// @param params The bounce tuning to replay with, the variant under test
+Replay::Session::Session(const std::vector<Input>& inputs, Control::BounceParams params)
+: params(params), duration_us(0)
+{
+    //Unwrap time_us_32 with signed steps, core0's and core1's inputs are interleaved a frame at a time
+    std::vector<std::pair<int64_t, Input>> timed;
+    int64_t time = 0;
+    uint32_t last = inputs.empty() ? 0 : inputs.front().timestamp_us;
+    int64_t origin = 0;
+    for (const Input& input : inputs) {
+        time += (int32_t)(input.timestamp_us - last);
+        last = input.timestamp_us;
+        origin = std::min(origin, time);
+        timed.push_back({time, input});
+    }
+    std::stable_sort(timed.begin(), timed.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    //One legal Gray step per count, forward is 00, 10, 11, 01 with A first
+    static const uint8_t gray[4] = {0b00, 0b10, 0b11, 0b01};
+    struct EncoderTrack {
+        uint pinA, pinB;
+        bool started;
+        int32_t first;
+        int32_t count;
+        uint64_t timestamp_us;
+    };
+    EncoderTrack encoders[2] = {
+        {PinOf(Role::LeftEncoderA), PinOf(Role::LeftEncoderB), false, 0, 0, 0},
+        {PinOf(Role::RightEncoderA), PinOf(Role::RightEncoderB), false, 0, 0, 0},
+    };
+
+    for (const auto& [at, input] : timed) {
+        uint64_t timestamp_us = (uint64_t)(at - origin);
+        if (input.kind == InputKind::Edge) {
+            //Both edges in one IRQ was a pulse shorter than the IRQ latency, it ended high
+            stimuli.push_back({timestamp_us, 1u << input.pin, input.value & GPIO_IRQ_EDGE_RISE ? 1u << input.pin : 0u});
+        } else {
+            for (EncoderTrack& encoder : encoders) {
+                if (encoder.pinA != input.pin) continue;
+                if (!encoder.started) {
+                    //The replayed encoder counts from 0, odometry only uses differences
+                    encoder.started = true;
+                    encoder.first = input.value;
+                    encoder.count = input.value;
+                    encoder.timestamp_us = timestamp_us;
+                    break;
+                }
+                int32_t steps = input.value - encoder.count;
+                int32_t direction = steps > 0 ? 1 : -1;
+                uint64_t span = timestamp_us - encoder.timestamp_us;
+                for (int32_t k = 1; k <= steps * direction; k++) {
+                    int32_t position = encoder.count - encoder.first + k * direction;
+                    uint8_t ab = gray[((position % 4) + 4) % 4];
+                    uint32_t mask = (1u << encoder.pinA) | (1u << encoder.pinB);
+                    uint32_t levels = ((uint32_t)(ab >> 1) << encoder.pinA) | ((uint32_t)(ab & 1u) << encoder.pinB);
+                    stimuli.push_back({encoder.timestamp_us + span * k / (steps * direction), mask, levels});
+                }
+                encoder.count = input.value;
+                encoder.timestamp_us = timestamp_us;
+            }
+        }
+    }
+    std::stable_sort(stimuli.begin(), stimuli.end(), [](const Stimulus& a, const Stimulus& b) { return a.timestamp_us < b.timestamp_us; });
+    duration_us = stimuli.empty() ? 0 : stimuli.back().timestamp_us;
+}
+
+/// @brief Replays the whole recording, or until workTime reaches 60 s like the robot's run
+/// @return one Tick per control task run
+std::vector<Replay::Tick> Replay::Session::Run() {
+    HostHAL::Reset();
+    HostHAL::SetInputs(0xffffffffu, 0);
+
+    Drivetrain::DualMotor drive(PinOf(Role::MotorStandby),
+        PinOf(Role::LeftMotorPWM), PinOf(Role::LeftMotorIn1), PinOf(Role::LeftMotorIn2),
+        PinOf(Role::RightMotorPWM), PinOf(Role::RightMotorIn1), PinOf(Role::RightMotorIn2));
+    Sensor::Distance distanceSensor(PinOf(Role::DistanceTrigger), PinOf(Role::DistanceEcho));
+    Sensor::MotorEncoder leftEncoder(PinOf(Role::LeftEncoderA), PinOf(Role::LeftEncoderB));
+    Sensor::MotorEncoder rightEncoder(PinOf(Role::RightEncoderA), PinOf(Role::RightEncoderB));
+    Control::VelocityDrive<Drivetrain::DualMotor> wheels(drive, leftEncoder, rightEncoder);
+    Control::Bouncer<Control::VelocityDrive<Drivetrain::DualMotor>> bouncer(wheels, params);
+    Navigation::Odometry odometry({Sensor::MotorEncoder::metersPerCount});
+
+    //Signed duty from the TB6612 direction pins, forward is IN2 high
+    auto signedDuty = [](Role pwm, Role in1, Role in2) {
+        float duty = HostHAL::GetPwmDuty(PinOf(pwm));
+        return HostHAL::GetOutput(PinOf(in1)) && !HostHAL::GetOutput(PinOf(in2)) ? -duty : duty;
+    };
+
+    const uint buttonPin = PinOf(Role::MainButton);
+    const uint64_t controlPeriod_us = 10000, ledPeriod_us = 20000;
+    int32_t mode = 0;
+    float workTime = 0;
+    bool buttonLevel = false;
+    std::vector<Tick> ticks;
+    ticks.reserve(duration_us / controlPeriod_us + 1);
+
+    size_t next = 0;
+    for (uint64_t tick_us = controlPeriod_us; tick_us <= duration_us + controlPeriod_us && workTime < 60; tick_us += controlPeriod_us) {
+        //Every input up to this tick, at its own time
+        while (next < stimuli.size() && stimuli[next].timestamp_us <= tick_us) {
+            const Stimulus& stimulus = stimuli[next++];
+            HostHAL::AdvanceTo(stimulus.timestamp_us);
+            HostHAL::SetInputs(stimulus.mask, stimulus.levels);
+            //core0's mainButton_callback, a release counts the mode on
+            if (stimulus.mask & (1u << buttonPin)) {
+                bool level = stimulus.levels & (1u << buttonPin);
+                if (buttonLevel && !level) mode++;
+                buttonLevel = level;
+            }
+        }
+        HostHAL::AdvanceTo(tick_us);
+
+        //core0's led_task, WORK mode time and PAUSE mode after 55 s count towards the battery
+        if (tick_us % ledPeriod_us == 0 && (mode % 2 == 1 || workTime >= 55)) workTime += 0.02f;
+
+        //core1's control_task
+        Sensor::EncoderState left = leftEncoder.Snapshot();
+        Sensor::EncoderState right = rightEncoder.Snapshot();
+        odometry.Update(left.counts, right.counts, left.timestamp_us > right.timestamp_us ? left.timestamp_us : right.timestamp_us);
+        float distance = distanceSensor.GetDistance();
+        if (mode % 2 == 0) {
+            bouncer.Pause();
+        } else {
+            bouncer.Step(distance, workTime);
+        }
+        wheels.Update();
+
+        ticks.push_back({tick_us, distance, mode, workTime,
+            signedDuty(Role::LeftMotorPWM, Role::LeftMotorIn1, Role::LeftMotorIn2),
+            signedDuty(Role::RightMotorPWM, Role::RightMotorIn1, Role::RightMotorIn2),
+            odometry.Snapshot()});
+    }
+    HostHAL::Reset();
+    return ticks;
+}
+
+#pragma endregion
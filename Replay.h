@@ -0,0 +1,55 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <vector>
+#include "Recorder.h"
+#include "Control.h"
+#include "Odometry.h"
+
+namespace Replay
+{
+    /// @brief What the core1 control task decided on one tick
+    struct Tick {
+        uint64_t timestamp_us;  //Virtual time since the first input
+        float distance;
+        int32_t mode;
+        float workTime;
+        float leftDuty;         //Signed, negative is backward
+        float rightDuty;
+        Navigation::Pose pose;
+    };
+
+    std::vector<Input> ReadCapture(const char* path, uint32_t* lostFrames = nullptr);
+    std::vector<Input> ReadCapture(const uint8_t* data, size_t length, uint32_t* lostFrames = nullptr);
+    uint64_t Digest(const std::vector<Tick>& ticks);
+    long FirstDifference(const std::vector<Tick>& a, const std::vector<Tick>& b);
+
+    /// @brief Plays a recording back on the host. Every edge goes back on its pin at its time through HostHAL,
+    /// @brief so Sensor::Distance, the Interrupt backend Sensor::MotorEncoder and the button see what the robot saw.
+    /// @brief PIO encoder counts become quadrature steps spread evenly over each tick. The control task runs every
+    /// @brief 10 ms like control_task in p2.cpp: odometry, distance, then Control::Bouncer or pause, then the wheel
+    /// @brief velocity loop. The mode and workTime follow the button like core0 does. The motors are not simulated,
+    /// @brief the robot moved the way the encoders say, so only the decisions on those inputs can change.
+    class Session {
+        public:
+            Session(const std::vector<Input>& inputs, Control::BounceParams params = Control::BounceParams());
+
+            std::vector<Tick> Run();
+
+        protected:
+            Session() = delete;
+
+            /// @brief Pin levels to drive at one instant
+            struct Stimulus {
+                uint64_t timestamp_us;
+                uint32_t mask;
+                uint32_t levels;
+            };
+
+            std::vector<Stimulus> stimuli;
+            Control::BounceParams params;
+            uint64_t duration_us;
+    };
+} // namespace Replay
+
+#endif
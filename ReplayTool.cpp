@@ -0,0 +1,110 @@
+//Replays the raw inputs of a robot capture on Linux, built with -DP2_HOST=ON. The robot records with -DP2_RECORD=ON
+//Usage: p2_replay capture.bin                          replays with the firmware's tuning, prints a digest of the decisions
+//       p2_replay capture.bin ticks.csv                also writes every control tick
+//       p2_replay capture.bin wallDistance=0.4 ...     replays a variant too, and reports where it first decides differently
+//Tuning names are the Control::BounceParams fields: baseSpeed, wallDistance, backupTicks, turnTicks, lowBatteryTime.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include "Replay.h"
+
+#pragma region Helpers
+
+static double WallSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// @brief Sets one BounceParams field from a name=value argument
+/// @return false for an unknown name
+static bool SetParam(Control::BounceParams& params, const char* argument) {
+    const char* equals = strchr(argument, '=');
+    std::string name(argument, equals - argument);
+    double value = atof(equals + 1);
+    if (name == "baseSpeed") params.baseSpeed = (float)value;
+    else if (name == "wallDistance") params.wallDistance = (float)value;
+    else if (name == "backupTicks") params.backupTicks = (int)value;
+    else if (name == "turnTicks") params.turnTicks = (int)value;
+    else if (name == "lowBatteryTime") params.lowBatteryTime = (float)value;
+    else return false;
+    return true;
+}
+
+static void WriteCsv(FILE* out, const std::vector<Replay::Tick>& ticks) {
+    fprintf(out, "timestamp_us,distance,mode,workTime,leftDuty,rightDuty,x,y,heading\n");
+    for (const Replay::Tick& tick : ticks) {
+        fprintf(out, "%llu,%.4f,%ld,%.2f,%.4f,%.4f,%.4f,%.4f,%.4f\n", (unsigned long long)tick.timestamp_us, tick.distance,
+            (long)tick.mode, tick.workTime, tick.leftDuty, tick.rightDuty, tick.pose.x, tick.pose.y, tick.pose.heading);
+    }
+}
+
+/// @brief Replays and prints the timing and the digest
+static std::vector<Replay::Tick> Play(const char* label, const std::vector<Replay::Input>& inputs, Control::BounceParams params) {
+    double start = WallSeconds();
+    Replay::Session session(inputs, params);
+    std::vector<Replay::Tick> ticks = session.Run();
+    double elapsed = WallSeconds() - start;
+    double recorded = ticks.empty() ? 0 : ticks.back().timestamp_us / 1e6;
+    printf("%-8s %zu ticks, %.1f s replayed in %.3f s (%.0fx real time), digest %016llx\n",
+        label, ticks.size(), recorded, elapsed, elapsed > 0 ? recorded / elapsed : 0, (unsigned long long)Replay::Digest(ticks));
+    return ticks;
+}
+
+#pragma endregion
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: p2_replay capture.bin [ticks.csv] [name=value ...]\n");
+        return 1;
+    }
+    uint32_t lost = 0;
+    std::vector<Replay::Input> inputs = Replay::ReadCapture(argv[1], &lost);
+    if (inputs.empty()) {
+        fprintf(stderr, "No Input frames in %s, record with -DP2_RECORD=ON\n", argv[1]);
+        return 1;
+    }
+    printf("%zu inputs", inputs.size());
+    if (lost > 0) printf(", %lu frames lost or damaged so the replay may differ from the robot", (unsigned long)lost);
+    printf("\n");
+
+    const char* csv = nullptr;
+    Control::BounceParams variant;
+    bool haveVariant = false;
+    for (int i = 2; i < argc; i++) {
+        if (!strchr(argv[i], '=')) {
+            csv = argv[i];
+        } else if (SetParam(variant, argv[i])) {
+            haveVariant = true;
+        } else {
+            fprintf(stderr, "Unknown tuning %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::vector<Replay::Tick> baseline = Play("firmware", inputs, Control::BounceParams());
+    std::vector<Replay::Tick> result = baseline;
+    if (haveVariant) {
+        result = Play("variant", inputs, variant);
+        long first = Replay::FirstDifference(baseline, result);
+        if (first < 0) {
+            printf("The variant decides the same on every tick\n");
+        } else {
+            const Replay::Tick& a = baseline[first];
+            const Replay::Tick& b = result[first];
+            printf("First difference at %.2f s, distance %.3f m: firmware duties %+.2f %+.2f, variant %+.2f %+.2f\n",
+                a.timestamp_us / 1e6, a.distance, a.leftDuty, a.rightDuty, b.leftDuty, b.rightDuty);
+        }
+    }
+
+    if (csv) {
+        FILE* out = fopen(csv, "w");
+        if (!out) {
+            fprintf(stderr, "Can not create %s\n", csv);
+            return 1;
+        }
+        WriteCsv(out, result);
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Buffer {
+
+    /// @brief Lock-free single producer, single consumer ring buffer. Safe between an ISR and a loop, or across the two cores
+    /// @tparam T The element type, copied in and out
+    /// @tparam N Capacity, must be a power of two
+    template <class T, size_t N>
+    class Ring {
+        static_assert(N >= 2 && (N & (N - 1)) == 0, "Ring capacity must be a power of two");
+
+        public:
+            Ring() : head(0), tail(0), dropped(0) {}
+
+            /// @brief Producer side. Adds an element, if full the element is dropped and counted
+            /// @return false when the buffer was full
+            bool Push(const T& value) {
+                uint32_t h = head.load(std::memory_order_relaxed);
+                if (h - tail.load(std::memory_order_acquire) >= N) {
+                    dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    return false;
+                }
+                items[h & (N - 1)] = value;
+                head.store(h + 1, std::memory_order_release);
+                return true;
+            }
+
+            /// @brief Consumer side. Takes the oldest element
+            /// @return false when the buffer was empty
+            bool Pop(T& value) {
+                uint32_t t = tail.load(std::memory_order_relaxed);
+                if (t == head.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                value = items[t & (N - 1)];
+                tail.store(t + 1, std::memory_order_release);
+                return true;
+            }
+
+            /// @brief Elements waiting, exact only from the consumer side
+            size_t Size() { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+
+            bool Empty() { return Size() == 0; }
+
+            /// @brief Elements lost because the consumer fell behind
+            uint32_t Dropped() { return dropped.load(std::memory_order_relaxed); }
+
+            static constexpr size_t Capacity() { return N; }
+
+        protected:
+            T items[N];
+            std::atomic<uint32_t> head; //Written by the producer only
+            std::atomic<uint32_t> tail; //Written by the consumer only
+            std::atomic<uint32_t> dropped;
+    };
+}
+
+#endif
@@ -0,0 +1,128 @@
+#include "Scheduler.h"
+#include "Trace.h"
+#include <stdio.h>
+
+#pragma region Scheduler
+
+Tasks::Scheduler::Scheduler()
+: taskCount(0), running(false), idle(&SleepIdle), idleContext(nullptr)
+{
+
+}
+
+/// @brief Adds a periodic task. Call before Start
+/// @param name Shown by PrintStats
+/// @param function Called once per period with the context
+/// @param context Handed back to the function
+/// @param period_us The period in microseconds
+/// @param priority Lower runs first when several tasks are due at once
+/// @param budget_us The time a run should fit in, longer runs are counted. 0 for no budget
+/// @return the task id, or -1 when the scheduler is full
+int Tasks::Scheduler::Add(const char* name, TaskFunction function, void* context, uint32_t period_us, uint8_t priority, uint32_t budget_us) {
+    if (taskCount >= maxTasks) return -1;
+    tasks[taskCount] = {name, function, context, period_us, priority, budget_us, 0, {0, 0, 0, 0, 0}};
+    TRACE_NAME_TASK(taskCount, name);
+    return taskCount++;
+}
+
+/// @brief Releases every task now, and sets its deadlines from here
+void Tasks::Scheduler::Start() {
+    uint64_t now = time_us_64();
+    for (int i = 0; i < taskCount; i++) {
+        tasks[i].deadline_us = now;
+    }
+    running = true;
+}
+
+/// @brief Runs the highest priority task that is due, if any
+/// @return true if a task ran
+bool Tasks::Scheduler::RunOnce() {
+    uint64_t now = time_us_64();
+    Task* next = nullptr;
+    for (int i = 0; i < taskCount; i++) {
+        if (tasks[i].deadline_us <= now && (next == nullptr || tasks[i].priority < next->priority)) {
+            next = &tasks[i];
+        }
+    }
+    if (next == nullptr) return false;
+
+    uint32_t lateness = (uint32_t)(now - next->deadline_us);
+    if (lateness > next->stats.maxLateness_us) next->stats.maxLateness_us = lateness;
+
+    [[maybe_unused]] int id = (int)(next - tasks);  //Only the trace macros read it
+    TRACE_BEGIN(Task, id);
+    next->function(next->context);
+    TRACE_END(Task, id);
+
+    uint64_t end = time_us_64();
+    uint32_t runTime = (uint32_t)(end - now);
+    next->stats.runs++;
+    if (runTime > next->stats.maxRun_us) next->stats.maxRun_us = runTime;
+    if (next->budget_us != 0 && runTime > next->budget_us) next->stats.budgetExceeded++;
+
+    //Next release is one period after the last deadline, not after now, so there is no drift.
+    //If whole periods were missed, skip them rather than running the task back to back
+    next->deadline_us += next->period_us;
+    if (next->deadline_us <= end) {
+        uint64_t missed = (end - next->deadline_us) / next->period_us + 1;
+        next->stats.overruns += missed;
+        TRACE_INSTANT(Overrun, id);
+        next->deadline_us += missed * next->period_us;
+    }
+    return true;
+}
+
+/// @brief The earliest deadline of all tasks
+uint64_t Tasks::Scheduler::NextDeadline() {
+    uint64_t next = UINT64_MAX;
+    for (int i = 0; i < taskCount; i++) {
+        if (tasks[i].deadline_us < next) next = tasks[i].deadline_us;
+    }
+    return next;
+}
+
+/// @brief Runs tasks until Stop is called, idling between deadlines
+void Tasks::Scheduler::Run() {
+    RunUntil(UINT64_MAX);
+}
+
+/// @brief Runs tasks until the given absolute time or until Stop is called
+/// @param time_us The time to return at
+void Tasks::Scheduler::RunUntil(uint64_t time_us) {
+    if (!running) Start();
+    while (running && time_us_64() < time_us) {
+        if (RunOnce()) continue;
+        uint64_t wake = NextDeadline();
+        TRACE_BEGIN(Idle, 0);
+        idle(idleContext, wake < time_us ? wake : time_us);
+        TRACE_END(Idle, 0);
+    }
+}
+
+/// @brief Makes Run return after the current task, safe to call from a task
+void Tasks::Scheduler::Stop() {
+    running = false;
+}
+
+/// @brief Replaces how the scheduler waits between deadlines, the default sleeps
+void Tasks::Scheduler::SetIdle(IdleFunction function, void* context) {
+    idle = function;
+    idleContext = context;
+}
+
+/// @brief Prints one line of timing counters per task
+void Tasks::Scheduler::PrintStats() {
+    for (int i = 0; i < taskCount; i++) {
+        const Task& t = tasks[i];
+        printf("%-10s %6lu us  runs %8lu  overruns %5lu  over budget %5lu  max run %6lu us  max late %6lu us\n",
+            t.name, (unsigned long)t.period_us, (unsigned long)t.stats.runs, (unsigned long)t.stats.overruns,
+            (unsigned long)t.stats.budgetExceeded, (unsigned long)t.stats.maxRun_us, (unsigned long)t.stats.maxLateness_us);
+    }
+}
+
+void Tasks::Scheduler::SleepIdle(void* context, uint64_t until_us) {
+    uint64_t now = time_us_64();
+    if (until_us > now) sleep_us(until_us - now);
+}
+
+#pragma endregion
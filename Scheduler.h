@@ -0,0 +1,68 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "HAL.h"
+
+namespace Tasks
+{
+    typedef void (*TaskFunction)(void* context);
+
+    /// @brief Timing counters of one task
+    struct TaskStats {
+        uint32_t runs;
+        uint32_t overruns;          //Periods skipped because the task started a whole period late
+        uint32_t budgetExceeded;    //Runs that took longer than the budget
+        uint32_t maxRun_us;         //Longest single run
+        uint32_t maxLateness_us;    //Longest time from a deadline to the task actually starting
+    };
+
+    struct Task {
+        const char* name;
+        TaskFunction function;
+        void* context;
+        uint32_t period_us;
+        uint8_t priority;           //Lower runs first when several tasks are due
+        uint32_t budget_us;         //0 for no budget
+        uint64_t deadline_us;       //Absolute time of the next release
+        TaskStats stats;
+    };
+
+    /// @brief Cooperative fixed-rate scheduler, one per core. Tasks are released at absolute deadlines,
+    /// @brief start + n * period, so loop body time never stretches the period and nothing drifts.
+    /// @brief Uses the HAL clock, so on the host it runs against the virtual clock.
+    class Scheduler {
+        public:
+            /// @brief Waits until the given absolute time, or less if there is a reason to wake early
+            typedef void (*IdleFunction)(void* context, uint64_t until_us);
+
+            Scheduler();
+
+            int Add(const char* name, TaskFunction function, void* context, uint32_t period_us, uint8_t priority = 0, uint32_t budget_us = 0);
+
+            void Start();
+            bool RunOnce();
+            void Run();
+            void RunUntil(uint64_t time_us);
+            void Stop();
+
+            void SetIdle(IdleFunction function, void* context);
+
+            uint64_t NextDeadline();
+            int TaskCount() { return taskCount; }
+            const Task& GetTask(int id) { return tasks[id]; }
+            void PrintStats();
+
+            static constexpr int maxTasks = 8;
+
+        protected:
+            Task tasks[maxTasks];
+            int taskCount;
+            volatile bool running;
+            IdleFunction idle;
+            void* idleContext;
+
+            static void SleepIdle(void* context, uint64_t until_us);
+    };
+} // namespace Tasks
+
+#endif
@@ -0,0 +1,265 @@
+#include "SelfTest.h"
+#include "Static.h"
+
+#pragma region Status
+
+const char* SelfTest::Name(Check check) {
+    switch (check) {
+        case Check::Echo: return "echo";
+        case Check::Button: return "button";
+        case Check::LeftEncoder: return "left encoder";
+        case Check::RightEncoder: return "right encoder";
+        case Check::MotorPwm: return "motor PWM";
+        case Check::LedPwm: return "LED PWM";
+        default: return "?";
+    }
+}
+
+const char* SelfTest::Name(Result result) {
+    switch (result) {
+        case Result::Pending: return "pending";
+        case Result::Pass: return "pass";
+        case Result::Fail: return "fail";
+        case Result::Timeout: return "timeout";
+        default: return "?";
+    }
+}
+
+#pragma endregion
+#pragma region Runner
+
+/// @param status The word both cores put their results into, all Pending (0) before the first Runner starts
+SelfTest::Runner::Runner(std::atomic<Status>& status)
+: status(status), count(0), start_us(0), started(false), results(0), passed(0)
+{
+
+}
+
+/// @brief Adds a check, before the first Poll
+/// @param deadline_us From the first Poll, a check still pending then times out
+/// @return false when every slot is taken
+bool SelfTest::Runner::Add(Check check, CheckFunction poll, void* context, uint32_t deadline_us) {
+    if (count >= maxChecks) return false;
+    entries[count++] = {check, poll, context, deadline_us, false};
+    return true;
+}
+
+/// @brief Polls every check without a result once, in the order added
+/// @return true once every check has a result
+bool SelfTest::Runner::Poll(uint64_t now_us) {
+    if (!started) {
+        started = true;
+        start_us = now_us;
+    }
+    bool finished = true;
+    for (int i = 0; i < count; i++) {
+        Entry& entry = entries[i];
+        if (entry.done) continue;
+        Result result = entry.poll(entry.context, now_us);
+        if (result == Result::Pending && now_us - start_us >= entry.deadline_us) result = Result::Timeout;
+        if (result == Result::Pending) {
+            finished = false;
+            continue;
+        }
+        entry.done = true;
+        if (result == Result::Pass || Advisory(entry.check)) passed++;
+        results |= Encode(entry.check, result);
+        status.fetch_or(Encode(entry.check, result));
+    }
+    return finished;
+}
+
+/// @brief Polls until every check has a result, sleeping between polls so the timers and IRQs keep running
+/// @param period_us Between polls
+/// @return When the last check got its result
+uint64_t SelfTest::Runner::Run(uint32_t period_us) {
+    uint64_t now_us = time_us_64();
+    while (!Poll(now_us)) {
+        sleep_us(period_us);
+        now_us = time_us_64();
+    }
+    return now_us;
+}
+
+#pragma endregion
+#pragma region Checks
+
+SelfTest::Result SelfTest::EchoCheck::Poll(void* context, uint64_t now_us) {
+    EchoCheck* check = (EchoCheck*)context;
+    Sensor::DistanceReading reading = check->DistanceSensor.GetReading();
+    return reading.sequence > 0 && reading.distance > 0 ? Result::Pass : Result::Pending;
+}
+
+SelfTest::Result SelfTest::LevelCheck::Poll(void* context, uint64_t now_us) {
+    LevelCheck* check = (LevelCheck*)context;
+    if (gpio_get(check->PIN) != check->EXPECTED) return Result::Fail;
+    if (!check->seen) {
+        check->seen = true;
+        check->since_us = now_us;
+    }
+    return now_us - check->since_us >= check->HOLD_US ? Result::Pass : Result::Pending;
+}
+
+/// @param slice The PWM slice to check
+/// @param frequency The frequency the slice was set up with
+/// @param wrapCounter The wrap the slice was set up with
+/// @param pairedSlice A slice that has to count in step with it, -1 for none
+/// @param window_us Between the two reads, at most a period
+SelfTest::PwmCheck::PwmCheck(uint slice, int frequency, int wrapCounter, int pairedSlice, uint32_t window_us)
+: SLICE(slice), WRAPCOUNTER(wrapCounter), TICK_US(PWM::Tick_us(frequency, wrapCounter)), PAIREDSLICE(pairedSlice),
+WINDOW_US(window_us), first(0), first_us(0), sampled(false)
+{
+
+}
+
+/// @brief Reads the counters and the time together, an IRQ in between would skew them
+void SelfTest::PwmCheck::Sample(uint16_t& counter, uint16_t& paired, uint64_t& time_us) {
+    uint32_t interrupts = save_and_disable_interrupts();
+    counter = pwm_get_counter(SLICE);
+    paired = PAIREDSLICE >= 0 ? pwm_get_counter(PAIREDSLICE) : counter;
+    time_us = time_us_64();
+    restore_interrupts(interrupts);
+}
+
+/// @brief Counts from one counter value forward to another, across the wrap
+int SelfTest::PwmCheck::CountsBetween(int from, int to) {
+    return ((to - from) % WRAPCOUNTER + WRAPCOUNTER) % WRAPCOUNTER;
+}
+
+SelfTest::Result SelfTest::PwmCheck::Poll(void* context, uint64_t now_us) {
+    PwmCheck* check = (PwmCheck*)context;
+    uint16_t counter, paired;
+    uint64_t time_us;
+    check->Sample(counter, paired, time_us);
+    if (counter >= check->WRAPCOUNTER) return Result::Fail;
+    int skew = check->CountsBetween(counter, paired);
+    if (skew > phaseTolerance && check->WRAPCOUNTER - skew > phaseTolerance) return Result::Fail;
+    if (!check->sampled) {
+        check->sampled = true;
+        check->first = counter;
+        check->first_us = time_us;
+        return Result::Pending;
+    }
+    if (time_us - check->first_us < check->WINDOW_US) return Result::Pending;
+
+    //Both ways round the wrap, the expected count can sit just either side of it
+    int expected = (int)((time_us - check->first_us) / check->TICK_US + 0.5f) % check->WRAPCOUNTER;
+    int error = check->CountsBetween(expected, check->CountsBetween(check->first, counter));
+    if (check->WRAPCOUNTER - error < error) error = check->WRAPCOUNTER - error;
+    return error <= timeTolerance_us / check->TICK_US ? Result::Pass : Result::Fail;
+}
+
+/// @param drive The drivetrain, in standby or not, the pulse leaves it in standby
+/// @param left The left wheel encoder, counting up going forward
+/// @param right The right wheel encoder, counting up going forward
+/// @param duty Of the pulse, enough to get past the friction
+/// @param pulse_us The longest the wheels are driven
+/// @param minCounts Counts a wheel has to move to be decided
+/// @param settle_us Still encoders for this long after the brake are stopped wheels, more than the PIO backend's count tick
+template <Drivetrain::DriveLike DriveT>
+SelfTest::MotorPulse<DriveT>::MotorPulse(DriveT& drive, Sensor::MotorEncoder& left, Sensor::MotorEncoder& right, float duty, uint32_t pulse_us, int minCounts, uint32_t settle_us)
+: Drive(drive), LeftEncoder(left), RightEncoder(right), DUTY(duty), PULSE_US(pulse_us), MINCOUNTS(minCounts), SETTLE_US(settle_us),
+leftStart(0), rightStart(0), lastLeft(0), lastRight(0), left(Result::Pending), right(Result::Pending), start_us(0), still_us(0),
+started(false), running(false), settled(false)
+{
+
+}
+
+template <Drivetrain::DriveLike DriveT>
+SelfTest::Result SelfTest::MotorPulse<DriveT>::Judge(int counts) {
+    if (counts >= MINCOUNTS) return Result::Pass;
+    if (counts <= -MINCOUNTS) return Result::Fail;
+    return Result::Pending;
+}
+
+/// @brief Starts the pulse on the first call, judges both wheels, brakes once both are decided or the pulse is
+/// @brief over and puts the driver in standby once the encoders have been still for settle_us
+template <Drivetrain::DriveLike DriveT>
+void SelfTest::MotorPulse<DriveT>::Update(uint64_t now_us) {
+    if (settled) return;
+    int leftCounts = LeftEncoder.Counts(), rightCounts = RightEncoder.Counts();
+    if (!started) {
+        started = true;
+        running = true;
+        start_us = now_us;
+        leftStart = leftCounts;
+        rightStart = rightCounts;
+        Drive.SetState(1);
+        Drive.Forward(DUTY);
+    }
+    if (left == Result::Pending) left = Judge(leftCounts - leftStart);
+    if (right == Result::Pending) right = Judge(rightCounts - rightStart);
+    if (running && ((left != Result::Pending && right != Result::Pending) || now_us - start_us >= PULSE_US)) {
+        //Braked and not in standby, which would let the wheels coast on
+        running = false;
+        Drive.Stop();
+        still_us = now_us;
+    }
+    if (running) return;
+    if (leftCounts != lastLeft || rightCounts != lastRight) still_us = now_us;
+    lastLeft = leftCounts;
+    lastRight = rightCounts;
+    if (now_us - still_us < SETTLE_US) return;
+    settled = true;
+    Drive.SetState(0);
+    //Nothing more will move a wheel that has not been decided yet
+    if (left == Result::Pending) left = Result::Timeout;
+    if (right == Result::Pending) right = Result::Timeout;
+}
+
+template <Drivetrain::DriveLike DriveT>
+SelfTest::Result SelfTest::MotorPulse<DriveT>::Left(void* context, uint64_t now_us) {
+    MotorPulse* pulse = (MotorPulse*)context;
+    pulse->Update(now_us);
+    return pulse->settled ? pulse->left : Result::Pending;
+}
+
+template <Drivetrain::DriveLike DriveT>
+SelfTest::Result SelfTest::MotorPulse<DriveT>::Right(void* context, uint64_t now_us) {
+    MotorPulse* pulse = (MotorPulse*)context;
+    pulse->Update(now_us);
+    return pulse->settled ? pulse->right : Result::Pending;
+}
+
+template class SelfTest::MotorPulse<Drivetrain::DualMotor>;
+template class SelfTest::MotorPulse<Static::BoardDualMotor>;
+
+#pragma endregion
+#pragma region Blink
+
+/// @brief Starts toggling, the LEDs go on with the first tick
+/// @param period_ms Between toggles
+/// @param toggles How many, the LEDs end off either way
+/// @param set Turns the LEDs on or off, from the timer IRQ
+void SelfTest::Blink::Start(uint32_t period_ms, int toggles, SetFunction set, void* context) {
+    Cancel();
+    this->set = set;
+    this->context = context;
+    this->on = false;
+    this->toggles = toggles;
+    add_repeating_timer_ms(period_ms, &Tick, this, &timer);
+}
+
+/// @brief Stops toggling and turns the LEDs off
+void SelfTest::Blink::Cancel() {
+    if (toggles <= 0) return;
+    cancel_repeating_timer(&timer);
+    toggles = 0;
+    on = false;
+    set(false, context);
+}
+
+bool SelfTest::Blink::Tick(repeating_timer* timer) {
+    Blink* blink = (Blink*)timer->user_data;
+    blink->on = !blink->on;
+    blink->set(blink->on, blink->context);
+    blink->toggles = blink->toggles - 1;
+    if (blink->toggles > 0) return true;
+    if (blink->on) {
+        blink->on = false;
+        blink->set(false, blink->context);
+    }
+    return false;
+}
+
+#pragma endregion
@@ -0,0 +1,249 @@
+//Boot self-test. Each core runs its own checks at once, each with its own deadline, and ORs the results into one
+//shared status word, 2 bits a check. Core1 checks what it owns, the distance sensor, the motors with their encoders
+//and the motor PWM, core0 the button and the LED PWM. The boot blink runs off a timer alongside.
+//
+//  SelfTest::Runner runner(status);
+//  runner.Add(SelfTest::Check::Echo, &SelfTest::EchoCheck::Poll, &echo, 300000);
+//  runner.Run();
+#ifndef SELFTEST_H
+#define SELFTEST_H
+
+#include <atomic>
+#include <cstdint>
+#include "HAL.h"
+#include "DriveTrain.h"
+#include "Sensor.h"
+
+namespace SelfTest
+{
+    /// @brief What is checked, the position of its 2 bits in the status word
+    enum class Check : uint8_t {
+        Echo,           //The distance sensor answered with a wall in range
+        Button,         //The button reads released and stays so
+        LeftEncoder,    //The left encoder counted forward on a short forward pulse
+        RightEncoder,
+        MotorPwm,       //Both motor slices count at the configured rate and in phase
+        LedPwm,         //The blue and green LED slice counts at the configured rate
+        Count,
+    };
+
+    /// @brief How a check ended, Pending is 0 so a fresh status word has every check pending
+    enum class Result : uint8_t {
+        Pending,
+        Pass,
+        Fail,       //The check saw something wrong
+        Timeout,    //The check saw nothing conclusive before its deadline
+    };
+
+    /// @brief 2 bits a Check, the Check's Result
+    typedef uint32_t Status;
+
+    constexpr int bitsPerCheck = 2;
+
+    constexpr Status Encode(Check check, Result result) { return (Status)result << ((int)check * bitsPerCheck); }
+
+    constexpr Result Decode(Status status, Check check) { return (Result)((status >> ((int)check * bitsPerCheck)) & 3u); }
+
+    /// @brief The status of every check passing
+    constexpr Status allPassed = [] {
+        Status status = 0;
+        for (int i = 0; i < (int)Check::Count; i++) status |= Encode((Check)i, Result::Pass);
+        return status;
+    }();
+
+    /// @brief Both bits of a check
+    constexpr Status Mask(Check check) { return Encode(check, Result::Timeout); }
+
+    /// @brief Checks that are run and reported but do not stop the boot. The encoder pins and which way they count
+    /// @brief are not confirmed on the robot yet, see Board::pins, and a wrong guess must not keep it rebooting
+    constexpr Status advisory = Mask(Check::LeftEncoder) | Mask(Check::RightEncoder);
+
+    constexpr bool Advisory(Check check) { return (Mask(check) & advisory) != 0; }
+
+    /// @brief True when every check that is not advisory passed
+    constexpr bool Passed(Status status) { return (status & ~advisory) == (allPassed & ~advisory); }
+
+    /// @brief True once no check is pending any more
+    constexpr bool Finished(Status status) {
+        for (int i = 0; i < (int)Check::Count; i++) {
+            if (Decode(status, (Check)i) == Result::Pending) return false;
+        }
+        return true;
+    }
+
+    const char* Name(Check check);
+    const char* Name(Result result);
+
+    /// @brief Polled until it returns something other than Pending, it must never block
+    /// @param context What the check works on
+    /// @param now_us The time of this poll
+    typedef Result (*CheckFunction)(void* context, uint64_t now_us);
+
+    /// @brief Polls the checks of one core until each has a result or is past its deadline. The results go into
+    /// @brief the status word shared with the other core as they come, so either core can watch the other's
+    class Runner {
+        public:
+            Runner(std::atomic<Status>& status);
+
+            bool Add(Check check, CheckFunction poll, void* context, uint32_t deadline_us);
+            bool Poll(uint64_t now_us);
+            uint64_t Run(uint32_t period_us = 1000);
+
+            /// @brief The results of this runner's checks only
+            Status Results() { return results; }
+
+            /// @brief True once every check of this runner passed, an advisory one only has to have a result
+            bool Passed() { return passed == count; }
+
+            static constexpr int maxChecks = (int)Check::Count;
+
+        protected:
+            Runner() = delete;
+
+            struct Entry {
+                Check check;
+                CheckFunction poll;
+                void* context;
+                uint32_t deadline_us;   //From the first Poll
+                bool done;
+            };
+
+            std::atomic<Status>& status;
+            Entry entries[maxChecks];
+            int count;
+            uint64_t start_us;
+            bool started;
+            Status results;
+            int passed;             //Advisory checks with any result included
+    };
+
+    #pragma region Checks
+    /// @brief Passes on the first echo that finds a wall in range. Poll from the core that reads the sensor
+    class EchoCheck {
+        public:
+            EchoCheck(Sensor::Distance& sensor) : DistanceSensor(sensor) {}
+
+            static Result Poll(void* context, uint64_t now_us);
+
+        protected:
+            EchoCheck() = delete;
+
+            Sensor::Distance& DistanceSensor;
+    };
+
+    /// @brief Passes once a pin has held its expected level for a while, fails on the first other level
+    class LevelCheck {
+        public:
+            LevelCheck(uint pin, bool expected, uint32_t hold_us = 20000)
+            : PIN(pin), EXPECTED(expected), HOLD_US(hold_us), since_us(0), seen(false) {}
+
+            static Result Poll(void* context, uint64_t now_us);
+
+        protected:
+            LevelCheck() = delete;
+
+            const uint PIN;
+            const bool EXPECTED;
+            const uint32_t HOLD_US;
+            uint64_t since_us;
+            bool seen;
+    };
+
+    /// @brief Reads a PWM slice's counter twice a window apart. It passes if the counter moved by the window over the
+    /// @brief tick, which only holds with the slice running at its divider and wrap. With a second slice it also
+    /// @brief has to read the same count, the motor slices are started together so their wraps line up
+    class PwmCheck {
+        public:
+            PwmCheck(uint slice, int frequency, int wrapCounter, int pairedSlice = -1, uint32_t window_us = 500);
+
+            static Result Poll(void* context, uint64_t now_us);
+
+            static constexpr int phaseTolerance = 8;    //Counts, for the two slices not being read at the same instant
+            static constexpr float timeTolerance_us = 2;    //The microsecond clock against the counter
+
+        protected:
+            PwmCheck() = delete;
+
+            void Sample(uint16_t& counter, uint16_t& paired, uint64_t& time_us);
+            int CountsBetween(int from, int to);
+
+            const uint SLICE;
+            const int WRAPCOUNTER;
+            const float TICK_US;
+            const int PAIREDSLICE;
+            const uint32_t WINDOW_US;
+            uint16_t first;
+            uint64_t first_us;
+            bool sampled;
+    };
+
+    /// @brief Drives both wheels forward for a short pulse and watches the encoders. A wheel passes on minCounts
+    /// @brief forward and fails on minCounts backward, a swapped motor or encoder. The pulse ends as soon as both
+    /// @brief wheels are decided, or after pulse_us, with the wheels braked. The results come once the wheels are
+    /// @brief still and the driver is back in standby, a wheel that never moved times out then.
+    /// @brief Poll Left and Right from the same core, the first poll starts the pulse
+    template <Drivetrain::DriveLike DriveT>
+    class MotorPulse {
+        public:
+            MotorPulse(DriveT& drive, Sensor::MotorEncoder& left, Sensor::MotorEncoder& right, float duty = 0.4f, uint32_t pulse_us = 100000, int minCounts = 4, uint32_t settle_us = 30000);
+
+            static Result Left(void* context, uint64_t now_us);
+            static Result Right(void* context, uint64_t now_us);
+
+            /// @brief True while the wheels are driven
+            bool Running() { return running; }
+
+        protected:
+            MotorPulse() = delete;
+
+            void Update(uint64_t now_us);
+            Result Judge(int counts);
+
+            DriveT& Drive;
+            Sensor::MotorEncoder& LeftEncoder;
+            Sensor::MotorEncoder& RightEncoder;
+            const float DUTY;
+            const uint32_t PULSE_US;
+            const int MINCOUNTS;
+            const uint32_t SETTLE_US;
+            int leftStart;
+            int rightStart;
+            int lastLeft;
+            int lastRight;
+            Result left;
+            Result right;
+            uint64_t start_us;
+            uint64_t still_us;          //Since the encoders last counted, after the brake
+            bool started;
+            bool running;
+            bool settled;
+    };
+    #pragma endregion
+
+    /// @brief Toggles some LEDs off a repeating timer a number of times, then leaves them off. The toggling is
+    /// @brief done by the timer IRQ, so the core is free to run its checks meanwhile
+    class Blink {
+        public:
+            /// @brief Sets the LEDs on or off
+            typedef void (*SetFunction)(bool on, void* context);
+
+            Blink() : set(nullptr), context(nullptr), toggles(0), on(false) {}
+
+            void Start(uint32_t period_ms, int toggles, SetFunction set, void* context);
+            void Cancel();
+
+            /// @brief True until the last toggle
+            bool Running() { return toggles > 0; }
+
+        protected:
+            static bool Tick(repeating_timer* timer);
+
+            SetFunction set;
+            void* context;
+            volatile int toggles;
+            bool on;
+            repeating_timer timer;
+    };
+} // namespace SelfTest
+
+#endif
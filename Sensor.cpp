@@ -1,134 +1,249 @@
 #include "Sensor.h"
+#include "Trace.h"
+#include "Recorder.h"
 #include <cmath>
+#ifndef P2_HOST
+#include "hardware/pio.h"
+#include "QuadratureEncoder.pio.h"
+#endif
 
 #pragma region Distance
 
 /// @brief Constructor for a distance Sensor
 /// @param TriggerPin This is the pin that will be used for starting the cycle. Is PWM
 /// @param EchoPin This is the pin that will be used to return the time it took. Is GPIO
-Sensor::Distance::Distance(uint TriggerPin, uint EchoPin)
+/// @param trigger Fixed rate pinging, or re-armed by each echo, see TriggerMode
+Sensor::Distance::Distance(uint TriggerPin, uint EchoPin, TriggerParams trigger)
 :
-TriggerPin(TriggerPin, 12, 49999), EchoPin(EchoPin, false)
+TriggerPin(TriggerPin, triggerFrequency, triggerWrap), EchoPin(EchoPin, false), trigger(trigger)
 {
     this->TriggerPin.SetDuty((uint)(6));
     this->EchoPin.SetPulls(false, true);
 
-    this->EchoPin.SetIRQ( GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, std::bind(&Distance::echoHandler, this, std::placeholders::_1 ));
+    this->EchoPin.SetIRQ<Distance, &Distance::echoHandler>(GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, this);
 
-    this->distance = std::nullopt;
+    this->reading = {-1.0f, 0, 0, 0};
+    this->published.Write(reading);
+    this->stats = {0, 0, 0, 0};
+    this->meanInterval_us = 0;
+    this->lastEcho_us = 0;
     this->startTime = 0;
+    this->fallbackPings = 0;
+    this->fallback_us = time_us_32() + SilenceTimeout_us();
+    //One alarm for the life of the sensor, the echo ISR only moves its deadline on
+    if (trigger.mode == TriggerMode::Rearm) {
+        add_alarm_in_us(SilenceTimeout_us(), &Fallback_Callback, this, true);
+    }
 }
 
-/// @brief Method used by the echoHandler_Callback method to handle the measuring calculating the distance
+/// @brief The echo ISR. Times the echo pulse and pushes it into the ring buffer, the filtering happens on the reading side
 /// @param events Internal Stuff
 void Sensor::Distance::echoHandler(uint32_t events) {
     if (this->EchoPin.GetState() ) {
         this->startTime = time_us_64();
         //printf("StartTime: %llu -> ", startTime); //Debug Print
+        //The ping was heard, the pulse ends by the sensor's timeout and the falling edge re-arms
+        this->fallback_us = (uint32_t)startTime + echoTimeout_us + trigger.minGap_us;
     } else {
-            uint64_t dT = time_us_64() - this->startTime;
-            //printf(" dT: %llu \n", dT); //Debug Print
-            if (dT < 100) {
-                this->distance = 0;
-            } else if (dT > 100 && dT < 38000) {
-                this->distance = dT / 58.0f / 100.0f;
-            } else {
-                this->distance = std::nullopt;
+            uint64_t now = time_us_64();
+            //printf(" dT: %llu \n", now - startTime); //Debug Print
+            echoes.Push({now, (uint32_t)(now - this->startTime)});
+            TRACE_INSTANT(Echo, now - this->startTime);
+            //The sensor is free again, ping as soon as the echoes of this one have died away
+            if (trigger.mode == TriggerMode::Rearm) {
+                TriggerPin.WrapIn(trigger.minGap_us);
+                this->fallback_us = (uint32_t)now + trigger.minGap_us + SilenceTimeout_us();
             }
-            
     }
 }
 
-/// @brief Returns the non-thread Safe Distance read by the sensor
-/// @return this will return the distance in meters as a float, if a -1.0 then that is out of range
-float Sensor::Distance::GetDistance() {
-    if (this->distance != std::nullopt) {
-            return *this->distance; 
+/// @brief From a ping to giving up on its echo: the round trip from maxRange, then the quiet time
+uint32_t Sensor::Distance::SilenceTimeout_us() {
+    return (uint32_t)(trigger.maxRange * 5800) + trigger.minGap_us;
+}
+
+/// @brief The Rearm fallback. Without it a ping the sensor never answers, a trigger it missed or that came while
+/// @brief it was busy, waits out the whole PWM period. Runs from the default alarm pool, on core0, and sleeps until
+/// @brief the deadline the echo ISR keeps moving. A ping raced with an echo is ignored by the busy sensor
+int64_t Sensor::Distance::Fallback_Callback(alarm_id_t id, void* user_data) {
+    Distance* self = (Distance*)user_data;
+    int32_t left = (int32_t)(self->fallback_us - time_us_32());
+    if (left > 0) return left;
+    self->TriggerPin.WrapIn(0);
+    self->fallbackPings = self->fallbackPings + 1;
+    uint32_t timeout = self->SilenceTimeout_us();
+    self->fallback_us = time_us_32() + timeout;
+    return timeout;
+}
+
+/// @brief Converts an echo pulse width to a distance
+/// @param pulse_us the echo pulse width in microseconds
+/// @return the distance in meters, maxRange when there was no echo
+float Sensor::Distance::PulseToDistance(uint32_t pulse_us) {
+    if (pulse_us <= 100) {
+        return 0;
+    } else if (pulse_us < 38000) {
+        return pulse_us / 58.0f / 100.0f;
     } else {
-            return -1.0f;
+        return maxRange;
     }
+}
 
+/// @brief Runs every new echo through the filter and returns the result. Call from one place only, it is the ring's consumer
+/// @return the filtered distance, its age and confidence
+Sensor::DistanceReading Sensor::Distance::GetReading() {
+    EchoSample sample;
+    bool any = false;
+    while (echoes.Pop(sample)) {
+        stats.echoes++;
+        if (sample.pulse_us > trigger.maxRange * 5800) stats.timeouts++;
+        if (lastEcho_us != 0) {
+            float interval = (float)(sample.timestamp_us - lastEcho_us);
+            meanInterval_us = meanInterval_us == 0 ? interval : meanInterval_us + (interval - meanInterval_us) * 0.125f;
+            stats.rate = 1e6f / meanInterval_us;
+        }
+        lastEcho_us = sample.timestamp_us;
+        float filtered = filter.Update(PulseToDistance(sample.pulse_us));
+        reading.distance = filtered >= maxRange ? -1.0f : filtered;
+        reading.sequence++;
+        any = true;
+    }
+    if (any) {
+        reading.confidence = filter.Confidence();
+    }
+    if (reading.sequence > 0) {
+        reading.age_us = time_us_64() - lastEcho_us;
+    }
+    stats.fallbacks = fallbackPings;
+    published.Write(reading);
+    return reading;
+}
+
+/// @brief Returns the filtered distance read by the sensor, see GetReading
+/// @return this will return the distance in meters as a float, if a -1.0 then that is out of range
+float Sensor::Distance::GetDistance() {
+    return GetReading().distance;
 }
 
 #pragma endregion
 #pragma region MotorEncoder
 
-Sensor::MotorEncoder::MotorEncoder(uint pinA, uint pinB)
-: EncodPinA(pinA, false), EncodPinB(pinB, false)
+/// @brief Creates a quadrature encoder on two pins and starts measuring velocity at timerFrequency
+/// @param pinA Channel A of the encoder, forward is A leading B
+/// @param pinB Channel B of the encoder, must be pinA + 1 for the PIO backend
+/// @param backend Where the counting happens, see EncoderBackend
+/// @param method How the velocity is measured, see VelocityMethod. Hybrid needs the edge IRQs of the Interrupt backend
+Sensor::MotorEncoder::MotorEncoder(uint pinA, uint pinB, EncoderBackend backend, VelocityMethod method)
+: EncodPinA(pinA, false), EncodPinB(pinB, false), backend(backend), method(method), pioOffset(0), pioIndex(0), pioSM(0)
 {
+    assert((method == VelocityMethod::Counts || backend == EncoderBackend::Interrupt) && "Hybrid velocity needs the edge times of the Interrupt backend");
 
     EncodPinA.SetPulls(false, false);
     EncodPinB.SetPulls(false, false);
 
-    this->pinAVal = EncodPinA.GetState();
-    this->pinBVal = EncodPinB.GetState();
-
-    this->encoderCounts = 0.0f;
-    this->previousCounts = 0.0f;
+    this->encoderCounts = 0;
+    this->previousCounts = 0;
 
     this->wheelAngVelocity = 0;
     this->wheelLinVelocity = 0;
 
-    this->EncodPinB.SetIRQ(GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, std::bind(&MotorEncoder::PinAHandler, this, std::placeholders::_1));
-    this->EncodPinA.SetIRQ(GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, std::bind(&MotorEncoder::PinBHandler, this, std::placeholders::_1));
-    
+    if (backend == EncoderBackend::Pio) {
+        StartPio();
+    } else {
+        decoder.Reset(ReadAB());
+        this->EncodPinA.SetIRQ<MotorEncoder, &MotorEncoder::EdgeHandler>(GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, this);
+        this->EncodPinB.SetIRQ<MotorEncoder, &MotorEncoder::EdgeHandler>(GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, this);
+    }
 
     //Make the timer negative, so the time is ALWAYS accurate regardless of callback execution time
     add_repeating_timer_ms(-1 * (1000 / timerFrequency), MeasureVelocity_Callback, this, &timer);
     
 }
 
-void Sensor::MotorEncoder::PinAHandler(uint32_t events) {
-    this->pinAVal = EncodPinA.GetState();
-    //This will subtract when pinA and pinB are equal, otherwise will add
-    /*
-    a = 0, b = 0 subtract
-    a = 1, b = 0 add
-    a = 0, b = 1 add
-    a = 1, b = 1 subtract    
-    */
-
-    if (pinAVal != pinBVal) {
-        encoderCounts += 1;
-    } else {
-        encoderCounts -= 1;
+/// @brief Sets the current position as count 0
+void Sensor::MotorEncoder::ResetEncoderCount() {
+    if (backend == EncoderBackend::Pio) {
+        pioOffset = ReadPio();
     }
+    this->encoderCounts = 0;
+    this->previousCounts = 0;
+}
 
-    //printf("PinA\n"); //debug line
+/// @brief The current count. The PIO backend only updates this at timerFrequency
+/// @return the count in encoder steps, 4 per CPR cycle
+int Sensor::MotorEncoder::Counts() {
+    return this->encoderCounts;
+}
 
+/// @brief Samples both encoder pins in one read, so the pair is never mixed from two moments
+/// @return A in bit 1, B in bit 0
+uint8_t Sensor::MotorEncoder::ReadAB() {
+    uint32_t all = gpio_get_all();
+    return (uint8_t)((((all >> EncodPinA.GetPin()) & 1u) << 1) | ((all >> EncodPinB.GetPin()) & 1u));
 }
-void Sensor::MotorEncoder::PinBHandler(uint32_t events){
-    this->pinBVal = EncodPinB.GetState();
-    //This will add when pinA and pinB are equal, otherwise will subtract
-    /*
-    a = 0, b = 0 add
-    a = 1, b = 0 subtract
-    a = 0, b = 1 subtract
-    a = 1, b = 1 add
-    */
 
-    if (pinAVal != pinBVal) {
-        encoderCounts -= 1;
-    } else {
-        encoderCounts += 1;
-    }
+/// @brief The IRQ handler for edges on both pins, decodes the fresh AB pair through the transition table
+void Sensor::MotorEncoder::EdgeHandler(uint32_t events) {
+    uint8_t ab = ReadAB();
+    TRACE_INSTANT(EncoderEdge, EncodPinA.GetPin() << 8 | ab);
+    int step = decoder.Update(ab);
+    encoderCounts = encoderCounts + step;
+    if (method == VelocityMethod::Hybrid) edges.Edge(step, time_us_64());
+}
 
-    //printf("PinB\n" ); //debug line
+/// @brief Loads the quadrature program into a free PIO state machine and starts counting
+void Sensor::MotorEncoder::StartPio() {
+    assert(EncodPinB.GetPin() == EncodPinA.GetPin() + 1 && "PIO backend needs pin B to be pin A + 1");
+#ifdef P2_HOST
+    //HostHAL runs the program's jump table on the simulated pins
+    pioSM = HostHAL::ClaimQuadrature(EncodPinA.GetPin());
+    pioOffset = ReadPio();
+#else
+    PIO pio;
+    uint offset;
+    bool claimed = pio_claim_free_sm_and_add_program_for_gpio_range(&quadrature_encoder_program, &pio, &pioSM, &offset, EncodPinA.GetPin(), 2, true);
+    hard_assert(claimed);
+    pioIndex = PIO_NUM(pio);
+    //0 max step rate runs the state machine at full speed
+    quadrature_encoder_program_init(pio, pioSM, offset, EncodPinA.GetPin(), 0);
+    pioOffset = ReadPio();
+#endif
+}
+
+/// @brief Asks the state machine for its count
+/// @return the raw count, with the sign matching the Interrupt backend
+int Sensor::MotorEncoder::ReadPio() {
+    //The PIO table counts B leading A as up, so flip it to match QuadratureDecoder
+#ifdef P2_HOST
+    return -HostHAL::QuadratureCount(pioSM);
+#else
+    return -quadrature_encoder_get_count(PIO_INSTANCE(pioIndex), pioSM);
+#endif
 }
 
 void Sensor::MotorEncoder::MeasureVelocity(){
     
+    if (backend == EncoderBackend::Pio) {
+        this->encoderCounts = ReadPio() - pioOffset;
+        //The Interrupt backend's edges are recorded by the IRQ dispatch already
+        RECORD_COUNTS(EncodPinA.GetPin(), this->encoderCounts);
+    }
     
-    int deltaCounts = this->encoderCounts - this->previousCounts;
+    //Read the count once, so an edge between two reads can not go missing from the delta
+    int counts = this->encoderCounts;
+    int deltaCounts = counts - this->previousCounts;
     
-    this->previousCounts = this->encoderCounts; //Update previous counts
+    this->previousCounts = counts; //Update previous counts
 
-    float countsPerSecond = deltaCounts * timerFrequency;
+    uint64_t now_us = time_us_64();
+    float countsPerSecond = method == VelocityMethod::Hybrid ? edges.Update(now_us) : deltaCounts * timerFrequency;
     float motorRPS = countsPerSecond / encoderCPR;
     float motorAngVelocity = motorRPS * 2 * M_PI;
 
     this->wheelAngVelocity = motorAngVelocity / gearRatio;
     this->wheelLinVelocity = this->wheelAngVelocity * wheelRadius;
+
+    published.Write({counts, decoder.ErrorCounts(), this->wheelAngVelocity, this->wheelLinVelocity, now_us});
     
 
 }
@@ -136,7 +251,9 @@ void Sensor::MotorEncoder::MeasureVelocity(){
 bool Sensor::MotorEncoder::MeasureVelocity_Callback(struct repeating_timer *t){
     //Take the void pointer, cast it to an uint pointer, then dereference it, getting us a uint number
     MotorEncoder* self = (MotorEncoder*)t->user_data;
+    TRACE_BEGIN(EncoderTimer, self->EncodPinA.GetPin());
     self->MeasureVelocity();
+    TRACE_END(EncoderTimer, self->EncodPinA.GetPin());
     return true;
 
 }
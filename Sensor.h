@@ -4,15 +4,71 @@
 
 #include "GPIO.h"
 #include "PWM.h"
+#include "Quadrature.h"
+#include "EdgeVelocity.h"
+#include "RingBuffer.h"
+#include "Filter.h"
+#include "Snapshot.h"
 #include <unordered_map>
-#include <optional>
 
 namespace Sensor {
 
+    /// @brief One echo as captured by the echo ISR
+    struct EchoSample {
+        uint64_t timestamp_us;  //Time the echo ended
+        uint32_t pulse_us;      //Width of the echo pulse
+    };
+
+    /// @brief The filtered distance as seen by the control loop
+    struct DistanceReading {
+        float distance;     //Filtered distance in meters, -1 when out of range or before the first echo
+        uint64_t age_us;    //Time since the newest echo ended
+        float confidence;   //0 to 1, the fraction of recent echoes that agreed with their neighbours
+        uint32_t sequence;  //Echoes seen so far, a new value means a new echo
+    };
+
+    /// @brief How the distance sensor is pinged
+    enum class TriggerMode {
+        Fixed,      //The trigger PWM pings at triggerFrequency
+        Rearm,      //Each echo that lands pings again minGap_us later. A ping no echo answers is sent again once
+                    //an echo from maxRange would have landed, the PWM period is left as the last timeout
+    };
+
+    struct TriggerParams {
+        TriggerMode mode = TriggerMode::Fixed;
+        uint32_t minGap_us = 10000;     //Quiet time after an echo lands, so late reflections of one ping are not taken for the next
+        float maxRange = 4.0f;          //Echoes from further than this count as timeouts, beyond the sensor's rated range
+    };
+
+    /// @brief How the sensor has been pinging, kept by the reading side
+    struct TriggerStats {
+        uint32_t echoes;    //Echo pulses that landed
+        uint32_t timeouts;  //Of those, no echo within maxRange
+        uint32_t fallbacks; //Pings sent again because no echo started, Rearm only
+        float rate;         //Echoes per second, smoothed over the last few
+    };
+
     class Distance {
         public:
-            Distance(uint TriggerPin, uint EchoPin);
+            Distance(uint TriggerPin, uint EchoPin, TriggerParams trigger = TriggerParams());
             float GetDistance();
+            DistanceReading GetReading();
+            /// @brief Updated by GetReading, read it from the same core
+            TriggerStats GetTriggerStats() { return stats; }
+            /// @brief The reading last published by GetReading, safe to call from the other core
+            DistanceReading Snapshot() { return published.Read(); }
+
+            static float PulseToDistance(uint32_t pulse_us);
+
+            /// @brief The trigger PWM, 12 Hz with a 10 us high pulse
+            static constexpr int triggerFrequency = 12;
+            static constexpr int triggerWrap = 49999;
+
+            /// @brief The longest echo pulse, the sensor's timeout when nothing comes back
+            static constexpr uint32_t echoTimeout_us = 38000;
+
+            /// @brief Distance the filter uses for a missing echo, the sensor's 38 ms timeout
+            static constexpr float maxRange = echoTimeout_us / 58.0f / 100.0f;
 
         protected:
             /// @brief The PWM signal generator to allow the distance sensor to function.
@@ -23,44 +79,95 @@ namespace Sensor {
             Distance() = delete;
 
             void echoHandler(uint32_t events);
-
-            std::optional<float> distance; //Distance to wall in meters
-            uint64_t startTime;
+            static int64_t Fallback_Callback(alarm_id_t id, void* user_data);
+            uint32_t SilenceTimeout_us();
+
+            /// @brief Echoes pushed by the ISR, drained by GetReading on the consumer side
+            Buffer::Ring<EchoSample, 16> echoes;
+            /// @brief Rejects single bad echoes
+            Filter::Hampel<5> filter;
+            DistanceReading reading;
+            Buffer::Seqlock<DistanceReading> published;
+            TriggerParams trigger;
+            TriggerStats stats;
+            float meanInterval_us;
+            uint64_t lastEcho_us;
+            volatile uint64_t startTime;
+            /// @brief When the Rearm fallback pings again, moved on by every echo edge. 32 bits so the echo ISR
+            /// @brief and the alarm, on different cores, never see half of it
+            volatile uint32_t fallback_us;
+            /// @brief Pings sent by the fallback, written by the alarm only
+            volatile uint32_t fallbackPings;
 
 
 
     };
     #pragma region MotorEncoder
+    /// @brief A consistent set of encoder values, published together every velocity tick
+    struct EncoderState {
+        int32_t counts;             //Encoder steps at the tick
+        uint32_t errors;            //Illegal transitions so far
+        float angularVelocity;      //Wheel rad/s
+        float linearVelocity;       //Wheel m/s
+        uint64_t timestamp_us;      //Time of the tick
+    };
+
+    /// @brief Where the quadrature counting happens
+    enum class EncoderBackend {
+        Interrupt,  //GPIO IRQ on every edge of both pins, decoded through QuadratureDecoder
+        Pio,        //A PIO state machine counts, the CPU only reads the count. Pin B must be pin A + 1
+    };
+
+    /// @brief How the velocity tick turns the encoder into a velocity
+    enum class VelocityMethod {
+        Counts,     //The count difference over the tick
+        Hybrid,     //EdgeVelocity, edge periods at low speed blended into counts at high speed. Interrupt backend only
+    };
+
     class MotorEncoder {
         public:
 
             
-            MotorEncoder(uint pinA, uint pinB);
+            MotorEncoder(uint pinA, uint pinB, EncoderBackend backend = EncoderBackend::Interrupt, VelocityMethod method = VelocityMethod::Counts);
             #pragma region Public Methods
 
             float LinearVelocity() {return wheelLinVelocity;}
             float AngularVelocity(){ return wheelAngVelocity;}
-            void ResetEncoderCount() {this->encoderCounts = 0;}
+            void ResetEncoderCount();
+            int Counts();
+            /// @brief Illegal transitions seen by the Interrupt backend, the PIO backend ignores them
+            uint32_t ErrorCounts() { return decoder.ErrorCounts(); }
+            /// @brief The state published on the last velocity tick, tear-free from either core
+            EncoderState Snapshot() { return published.Read(); }
 
             volatile int encoderCounts;
             volatile int previousCounts;
 
             #pragma endregion
-        protected:
-            MotorEncoder() = delete;
             #pragma region Constants & Statics
                 static constexpr float wheelRadius = 0.025;
                 static constexpr float gearRatio = 98.5;
                 static constexpr float encoderCPR = 28; //Pulse Counts per revolution
                 static constexpr float timerFrequency = 100;
+                /// @brief Wheel travel per encoder count
+                static constexpr float metersPerCount = 2 * (float)M_PI * wheelRadius / (encoderCPR * gearRatio);
 
             #pragma endregion
+        protected:
+            MotorEncoder() = delete;
             #pragma region Fields
                 GPIO::PIN EncodPinA;
                 GPIO::PIN EncodPinB;
 
-                volatile bool pinAVal;
-                volatile bool pinBVal;
+                const EncoderBackend backend;
+                const VelocityMethod method;
+                QuadratureDecoder decoder;
+                /// @brief Fed every step with its time by the edge IRQ, with VelocityMethod::Hybrid
+                EdgeVelocity edges;
+                /// @brief The raw PIO count that counts as zero, since the state machine can not be reset
+                int pioOffset;
+                uint pioIndex;
+                uint pioSM;
 
 
                 /// @brief Angular Velocity of the wheel
@@ -68,12 +175,18 @@ namespace Sensor {
                 /// @brief Linear Velocity
                 volatile float wheelLinVelocity;
 
+                Buffer::Seqlock<EncoderState> published;
+
                 struct repeating_timer timer;
             #pragma endregion
             #pragma region Protected Methods
 
-            void PinAHandler(uint32_t events);
-            void PinBHandler(uint32_t events);
+            uint8_t ReadAB();
+
+            void EdgeHandler(uint32_t events);
+
+            void StartPio();
+            int ReadPio();
 
             void MeasureVelocity();
 
@@ -0,0 +1,86 @@
+//Runs the firmware's wall bouncer in the simulated cell on Linux, built with -DP2_HOST=ON
+//Usage: p2_sim [episodes] [velocity] [rearm] [fusion] [governor] [name=value ...]     one 60 s episode per seed from 1, a line each and a summary
+//The bouncer drives the duty directly unless velocity is given, like P2_VELOCITY_CONTROL. rearm pings the distance
+//sensor again as soon as each echo lands, like P2_ECHO_REARM. fusion decides on the fused wall distance, like P2_WALL_FUSION.
+//governor runs Control::Governor instead of the bouncer, like P2_TTC_GOVERNOR, at the same baseSpeed.
+//Tuning names are the Control::BounceParams fields: baseSpeed, wallDistance, backupTicks, turnTicks, lowBatteryTime,
+//and for the cell: length, width, battery, noise, dropout, seconds, and minGap for rearm in microseconds.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include "HostSim.h"
+
+#pragma region Helpers
+
+static double WallSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// @brief Sets one tuning or cell field from a name=value argument
+/// @return false for an unknown name
+static bool SetParam(Control::BounceParams& bounce, Sim::WorldParams& world, float& seconds, const char* argument) {
+    const char* equals = strchr(argument, '=');
+    std::string name(argument, equals - argument);
+    double value = atof(equals + 1);
+    if (name == "baseSpeed") bounce.baseSpeed = (float)value;
+    else if (name == "wallDistance") bounce.wallDistance = (float)value;
+    else if (name == "backupTicks") bounce.backupTicks = (int)value;
+    else if (name == "turnTicks") bounce.turnTicks = (int)value;
+    else if (name == "lowBatteryTime") bounce.lowBatteryTime = (float)value;
+    else if (name == "length") world.length = (float)value;
+    else if (name == "width") world.width = (float)value;
+    else if (name == "battery") world.battery = (float)value;
+    else if (name == "noise") world.sonar.noise = (float)value;
+    else if (name == "dropout") world.sonar.dropout = (float)value;
+    else if (name == "seconds") seconds = (float)value;
+    else if (name == "minGap") world.trigger.minGap_us = (uint32_t)value;
+    else return false;
+    return true;
+}
+
+#pragma endregion
+
+int main(int argc, char** argv) {
+    long episodes = 10;
+    bool velocityControl = false;
+    bool governor = false;
+    float seconds = 60;
+    Control::BounceParams bounce;
+    Sim::WorldParams world;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "velocity") == 0) {
+            velocityControl = true;
+        } else if (strcmp(argv[i], "rearm") == 0) {
+            world.trigger.mode = Sensor::TriggerMode::Rearm;
+        } else if (strcmp(argv[i], "governor") == 0) {
+            governor = true;
+        } else if (strcmp(argv[i], "fusion") == 0) {
+            world.wallFusion = true;
+        } else if (!strchr(argv[i], '=')) {
+            episodes = atol(argv[i]);
+        } else if (!SetParam(bounce, world, seconds, argv[i])) {
+            fprintf(stderr, "Unknown parameter %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    printf("seed,collisions,wallTicks,covered,joules,echoes,missed\n");
+    double collisions = 0, fraction = 0, joules = 0;
+    double start = WallSeconds();
+    for (long seed = 1; seed <= episodes; seed++) {
+        Control::GovernorParams governorParams;
+        governorParams.baseSpeed = bounce.baseSpeed;
+        Sim::EpisodeResult r = governor ? Sim::RunGovernor(world, (uint32_t)seed, governorParams, velocityControl, seconds)
+            : Sim::RunBouncer(world, (uint32_t)seed, bounce, velocityControl, seconds);
+        printf("%ld,%ld,%ld,%.4f,%.1f,%ld,%ld\n", seed, r.collisions, r.wallTicks, r.fraction, r.joules, r.echoes, r.missed);
+        collisions += r.collisions;
+        fraction += r.fraction;
+        joules += r.joules;
+    }
+    double elapsed = WallSeconds() - start;
+    fprintf(stderr, "%ld episodes of %.0f s in %.2f s (%.0f episodes/min), mean %.2f collisions, %.1f%% covered, %.0f J\n",
+        episodes, seconds, elapsed, episodes / elapsed * 60, collisions / episodes, fraction / episodes * 100, joules / episodes);
+    return 0;
+}
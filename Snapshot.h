@@ -0,0 +1,75 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace Buffer {
+
+    /// @brief Seqlock. One writer publishes a whole struct, any number of readers on either core get a tear-free copy
+    /// @brief without disabling interrupts. The writer never waits. A reader retries while a write is in progress,
+    /// @brief so never read from an ISR that can preempt the writer on the same core
+    /// @tparam T A trivially copyable state struct
+    template <class T>
+    class Seqlock {
+        static_assert(std::is_trivially_copyable<T>::value, "Seqlock needs a trivially copyable type");
+
+        public:
+            Seqlock() : sequence(0) {
+                for (auto& word : words) word.store(0, std::memory_order_relaxed);
+            }
+
+            /// @brief Writer side. Publishes a new value
+            void Write(const T& value) {
+                uint32_t buffer[wordCount] = {};
+                std::memcpy(buffer, &value, sizeof(T));
+
+                uint32_t s = sequence.load(std::memory_order_relaxed);
+                //Odd sequence marks a write in progress
+                sequence.store(s + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                for (size_t i = 0; i < wordCount; i++) {
+                    words[i].store(buffer[i], std::memory_order_relaxed);
+                }
+                sequence.store(s + 2, std::memory_order_release);
+            }
+
+            /// @brief Reader side. Copies the value once
+            /// @return false if a write was in progress or happened during the copy, the copy is torn
+            bool TryRead(T& out) {
+                uint32_t before = sequence.load(std::memory_order_acquire);
+                if (before & 1u) return false;
+
+                uint32_t buffer[wordCount];
+                for (size_t i = 0; i < wordCount; i++) {
+                    buffer[i] = words[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) != before) return false;
+
+                std::memcpy(&out, buffer, sizeof(T));
+                return true;
+            }
+
+            /// @brief Reader side. Retries until it gets a consistent copy
+            T Read() {
+                T value;
+                while (!TryRead(value)) {
+                }
+                return value;
+            }
+
+            /// @brief Number of writes so far
+            uint32_t Version() { return sequence.load(std::memory_order_acquire) / 2; }
+
+        protected:
+            static constexpr size_t wordCount = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+            std::atomic<uint32_t> sequence;
+            std::atomic<uint32_t> words[wordCount];
+    };
+}
+
+#endif
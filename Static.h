@@ -0,0 +1,273 @@
+//Static polymorphism version of the GPIO, PWM and Drivetrain classes, for the hot control path.
+//Same API, but every pin is a Board role known at compile time and nothing is virtual, so a call like
+//Forward(speed) inlines down to the SIO and PWM register writes, through a CommandLatch of its own.
+//Select it with P2_STATIC_DISPATCH.
+#ifndef STATIC_H
+#define STATIC_H
+
+#include "Board.h"
+#include "DriveTrain.h"
+#include <cassert>
+
+namespace Static
+{
+    #pragma region PinBase
+    /// @brief CRTP base with the behaviour GPIO::PIN shares through virtual calls, ToggleEvery calls the derived Toggle
+    /// @tparam Derived The pin class deriving from this
+    template <class Derived>
+    class PinBase {
+        public:
+            /// @brief Swaps between on and off, with the given delay as the MINIMUM, see GPIO::PIN::ToggleEvery
+            /// @param seconds the intended minimum delay between toggles
+            void ToggleEvery(float seconds) {
+                uint64_t now = time_us_64();
+                timePassed += (float)(now - timeAtLastCall_us) / 1000000.0f;
+                timeAtLastCall_us = now;
+                if (timePassed >= seconds) {
+                    static_cast<Derived*>(this)->Toggle();
+                    timePassed = 0;
+                }
+            }
+
+        protected:
+            uint64_t timeAtLastCall_us = 0;
+            float timePassed = 0;
+    };
+    #pragma endregion
+
+    #pragma region Pin
+    /// @brief A plain GPIO, like GPIO::PIN
+    /// @tparam R The board role of the pin
+    template <Board::Role R>
+    class Pin : public PinBase<Pin<R>> {
+        public:
+            using Handle = Board::Pin<R>;
+
+            Pin(bool output = true) {
+                gpio_init(Handle::id);
+                gpio_set_dir(Handle::id, output);
+            }
+
+            void Toggle() { Handle::Put(!Handle::Get()); }
+            void SetState(bool state) { Handle::Put(state); }
+            bool GetState() { return Handle::Get(); }
+            static constexpr uint GetPin() { return Handle::id; }
+    };
+    #pragma endregion
+
+    #pragma region PwmPin
+    /// @brief A PWM output, like PWM::PIN. The frequency and wrap come from the board map
+    /// @tparam R The board role of the pin, must be a PWM role
+    template <Board::Role R>
+    class PwmPin : public PinBase<PwmPin<R>> {
+        public:
+            using Handle = Board::Pin<R>;
+            static constexpr int frequency = Board::Find(R)->frequency;
+            static constexpr int wrapCounter = Handle::wrap;
+
+            PwmPin() : currentDuty(0) {
+                gpio_set_function(Handle::id, GPIO_FUNC_PWM);
+                pwm_config config = pwm_get_default_config();
+                float divider = clock_get_hz(clk_sys) / (frequency * wrapCounter);
+                pwm_config_set_clkdiv(&config, divider);
+                //Subtract one since the counter starts from  0
+                pwm_config_set_wrap(&config, wrapCounter - 1);
+                pwm_init(Handle::slice, &config, true);
+            }
+
+            void SetDuty(uint duty) {
+                uint level = duty < (uint)wrapCounter ? duty : (uint)wrapCounter;
+                Handle::SetLevel(level);
+                currentDuty = (float)level / wrapCounter;
+            }
+
+            void SetDuty(float duty) {
+                assert( 0 <= duty && duty <= 1 && "Duty must be float between 0 and 1");
+                Handle::SetDuty(duty);
+                currentDuty = duty;
+            }
+
+            void Stop() { Handle::SetLevel(0); currentDuty = 0; }
+            void Toggle() { SetDuty(currentDuty == 0 ? 1.0f : 0.0f); }
+            void SetState(bool IsOn) { SetDuty(IsOn ? 1.0f : 0.0f); }
+            bool GetState() { return currentDuty != 0; }
+            float GetDuty() { return currentDuty; }
+            static constexpr uint GetPin() { return Handle::id; }
+
+        protected:
+            float currentDuty;
+    };
+    #pragma endregion
+
+    #pragma region Motor
+    /// @brief A TB6612 channel, like PWM::MOTOR
+    /// @tparam PwmRole The speed pin
+    /// @tparam In1Role Pin 1, off for forwards
+    /// @tparam In2Role Pin 2, on for forwards
+    template <Board::Role PwmRole, Board::Role In1Role, Board::Role In2Role>
+    class Motor {
+        public:
+            void Forward(float speed) {
+                assert(speed <= 1 && speed >= 0); //Make sure speed is between 0 and 1
+                Pin1.SetState(false);
+                Pin2.SetState(true);
+                Speed.SetDuty(speed);
+            }
+
+            void Backward(float speed) {
+                assert(speed <= 1 && speed >= 0); //Make sure speed is set between 0 and 1
+                Pin1.SetState(true);
+                Pin2.SetState(false);
+                Speed.SetDuty(speed);
+            }
+
+            /// @brief Signed duty, negative runs backward
+            void Drive(float speed) {
+                if (speed >= 0) Forward(speed); else Backward(-speed);
+            }
+
+            void Stop() { Speed.Stop(); }
+            float GetDuty() { return Speed.GetDuty(); }
+
+        protected:
+            PwmPin<PwmRole> Speed;
+            Pin<In1Role> Pin1;
+            Pin<In2Role> Pin2;
+    };
+    #pragma endregion
+
+    #pragma region CommandLatch
+    /// @brief Drivetrain::CommandLatch on board roles. The slices, channels and pin masks are constants, so Apply inlines
+    /// @brief down to the counter read, the two level writes and, when a direction changes, the wrap interrupt enable.
+    /// @brief The one call out of line is the wait when a command comes within guardTicks of the wrap. There is one latch
+    /// @brief in the firmware, this one or Drivetrain::CommandLatch, it owns the PWM wrap interrupt until it is destroyed
+    /// @tparam LeftPwm The left speed pin, its slice's wrap interrupt does the latching
+    template <Board::Role LeftPwm, Board::Role LeftIn1, Board::Role LeftIn2,
+        Board::Role RightPwm, Board::Role RightIn1, Board::Role RightIn2>
+    class CommandLatch {
+        public:
+            using DriveCommand = Drivetrain::DriveCommand;
+            static constexpr int frequency = PwmPin<LeftPwm>::frequency;
+            static constexpr int wrapCounter = PwmPin<LeftPwm>::wrapCounter;
+            static constexpr uint32_t guardTicks = Drivetrain::CommandLatch::guardTicks;
+
+            static_assert(PwmPin<RightPwm>::frequency == frequency && PwmPin<RightPwm>::wrapCounter == wrapCounter,
+                "Both motor slices must count alike to wrap together");
+
+            /// @brief Puts the two motor slices in phase and takes the PWM wrap interrupt, see Drivetrain::CommandLatch
+            CommandLatch()
+            : TICKUS(PWM::Tick_us(frequency, wrapCounter)), current(), drivenPins(gpio_get_all() & directionMask),
+            pendingPins(drivenPins), pending(false) {
+                hard_assert(owner == nullptr);
+                owner = this;
+                Drivetrain::StartLatch(leftSlice, rightSlice, WrapHandler);
+            }
+
+            ~CommandLatch() {
+                pwm_set_irq_enabled(leftSlice, false);
+                pwm_clear_irq(leftSlice);
+                owner = nullptr;
+            }
+
+            /// @brief Sends both wheels to the command together, see Drivetrain::CommandLatch::Apply
+            void Apply(const DriveCommand& command) {
+                uint16_t leftLevel = Drivetrain::LevelOf(command.left, wrapCounter), rightLevel = Drivetrain::LevelOf(command.right, wrapCounter);
+                uint32_t pins = Drivetrain::PinsOf(command, leftIn1, leftIn2, rightIn1, rightIn2);
+
+                uint32_t status = save_and_disable_interrupts();
+                //The slices count together, the left counter tells when both wrap
+                uint32_t counter = pwm_get_counter(leftSlice);
+                if (counter + guardTicks >= (uint32_t)wrapCounter) busy_wait_us((uint64_t)((wrapCounter - counter) * TICKUS) + 1);
+                if (pending && (pwm_get_irq_status_mask() & (1u << leftSlice))) Latch();
+
+                pwm_set_chan_level(leftSlice, leftChannel, leftLevel);
+                pwm_set_chan_level(rightSlice, rightChannel, rightLevel);
+                if (pending || pins != drivenPins) {
+                    pendingPins = pins;
+                    if (!pending) {
+                        pending = true;
+                        pwm_clear_irq(leftSlice);
+                        pwm_set_irq_enabled(leftSlice, true);
+                    }
+                }
+                restore_interrupts(status);
+                current = command;
+            }
+
+            /// @brief The last command applied, its levels may wait for the next wrap
+            const DriveCommand& Current() { return current; }
+
+        protected:
+            static constexpr uint leftSlice = Board::Pin<LeftPwm>::slice, leftChannel = Board::Pin<LeftPwm>::channel;
+            static constexpr uint rightSlice = Board::Pin<RightPwm>::slice, rightChannel = Board::Pin<RightPwm>::channel;
+            static constexpr uint32_t leftIn1 = 1u << Board::Pin<LeftIn1>::id, leftIn2 = 1u << Board::Pin<LeftIn2>::id;
+            static constexpr uint32_t rightIn1 = 1u << Board::Pin<RightIn1>::id, rightIn2 = 1u << Board::Pin<RightIn2>::id;
+            static constexpr uint32_t directionMask = leftIn1 | leftIn2 | rightIn1 | rightIn2;
+
+            /// @brief Puts the waiting direction pins out in one SIO write and stands the wrap interrupt down
+            void Latch() {
+                gpio_put_masked(directionMask, pendingPins);
+                drivenPins = pendingPins;
+                pending = false;
+                pwm_set_irq_enabled(leftSlice, false);
+                pwm_clear_irq(leftSlice);
+            }
+
+            static void P2_IRQ_FUNC(WrapHandler)() {
+                if (owner) owner->Latch();
+            }
+
+            const float TICKUS;         //Microseconds per PWM counter tick, at the divider the slices really run at
+            DriveCommand current;
+            uint32_t drivenPins;
+            volatile uint32_t pendingPins;
+            volatile bool pending;
+
+#ifdef P2_HOST
+            static inline thread_local CommandLatch* owner = nullptr;
+#else
+            static inline CommandLatch* owner = nullptr;
+#endif
+    };
+    #pragma endregion
+
+    #pragma region DualMotor
+    /// @brief Two motor drive with a standby pin, same API as Drivetrain::DualMotor. The commands go through a
+    /// @brief Static::CommandLatch, so both wheels change together on one PWM wrap
+    template <Board::Role StandbyRole,
+        Board::Role LeftPwm, Board::Role LeftIn1, Board::Role LeftIn2,
+        Board::Role RightPwm, Board::Role RightIn1, Board::Role RightIn2>
+    class DualMotor {
+        public:
+            using WheelMode = Drivetrain::WheelMode;
+            using WheelCommand = Drivetrain::WheelCommand;
+
+            void Forward(float speed) { Apply({{WheelMode::Forward, speed}, {WheelMode::Forward, speed}}); }
+            void Backward(float speed) { Apply({{WheelMode::Backward, speed}, {WheelMode::Backward, speed}}); }
+            void SpinLeft(float speed) { Apply({{WheelMode::Backward, speed}, {WheelMode::Forward, speed}}); }
+            void SpinRight(float speed) { Apply({{WheelMode::Forward, speed}, {WheelMode::Backward, speed}}); }
+            void SetDuties(float left, float right) { Apply({WheelCommand::Signed(left), WheelCommand::Signed(right)}); }
+            void SetState(bool state) { StandbyPin.SetState(state); }
+            void Stop() { Brake(); }
+            void Brake() { Apply({{WheelMode::Brake, 0}, {WheelMode::Brake, 0}}); }
+            void Coast() { Apply({{WheelMode::Coast, 0}, {WheelMode::Coast, 0}}); }
+            void Apply(const Drivetrain::DriveCommand& command) { Latch.Apply(command); }
+            float GetLeftDuty() { return Drivetrain::DutyOf(Latch.Current().left); }
+            float GetRightDuty() { return Drivetrain::DutyOf(Latch.Current().right); }
+
+        protected:
+            Pin<StandbyRole> StandbyPin;
+            Motor<LeftPwm, LeftIn1, LeftIn2> LeftMotor;
+            Motor<RightPwm, RightIn1, RightIn2> RightMotor;
+            CommandLatch<LeftPwm, LeftIn1, LeftIn2, RightPwm, RightIn1, RightIn2> Latch;
+    };
+
+    /// @brief The robot's drivetrain as wired in Board::pins
+    using BoardDualMotor = DualMotor<Board::Role::MotorStandby,
+        Board::Role::LeftMotorPWM, Board::Role::LeftMotorIn1, Board::Role::LeftMotorIn2,
+        Board::Role::RightMotorPWM, Board::Role::RightMotorIn1, Board::Role::RightMotorIn2>;
+    #pragma endregion
+
+} // namespace Static
+
+#endif
@@ -0,0 +1,138 @@
+#include "Sweep.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+
+#pragma region Pool
+
+Sim::StealingPool::StealingPool(unsigned threads)
+: queues(threads > 0 ? threads : 1), stolen(0)
+{
+}
+
+/// @brief The next job for a thread, its own newest first, then the oldest of the first other thread with any
+/// @return false once every deque is empty
+bool Sim::StealingPool::Take(unsigned self, size_t& job) {
+    {
+        std::lock_guard<std::mutex> guard(queues[self].lock);
+        if (!queues[self].jobs.empty()) {
+            job = queues[self].jobs.back();
+            queues[self].jobs.pop_back();
+            return true;
+        }
+    }
+    for (unsigned k = 1; k < queues.size(); k++) {
+        Queue& victim = queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.jobs.empty()) {
+            job = victim.jobs.front();
+            victim.jobs.pop_front();
+            stolen++;
+            return true;
+        }
+    }
+    //Nothing is added while running, so empty everywhere is done
+    return false;
+}
+
+/// @brief Runs every job once and returns when all have finished. The calling thread is one of the workers
+/// @param job Called with the job index, from any thread, so it must only touch state of its own job
+void Sim::StealingPool::Run(size_t count, const std::function<void(size_t job)>& job) {
+    unsigned threads = (unsigned)queues.size();
+    stolen = 0;
+    for (unsigned t = 0; t < threads; t++) {
+        queues[t].jobs.clear();
+        for (size_t j = count * t / threads; j < count * (t + 1) / threads; j++) queues[t].jobs.push_back(j);
+    }
+    auto worker = [&](unsigned self) {
+        size_t next;
+        while (Take(self, next)) job(next);
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++) workers.emplace_back(worker, t);
+    worker(0);
+    for (std::thread& w : workers) w.join();
+}
+
+#pragma endregion
+
+#pragma region Sweep
+
+/// @brief Every combination of the spec's values. Combinations that turn before the backup ends are left out
+std::vector<Sim::Candidate> Sim::Grid(const GridSpec& spec) {
+    std::vector<Candidate> candidates;
+    for (float baseSpeed : spec.baseSpeed)
+    for (float wallDistance : spec.wallDistance)
+    for (int backupTicks : spec.backupTicks)
+    for (int turnTicks : spec.turnTicks)
+    for (float lowBatteryTime : spec.lowBatteryTime)
+    for (float seconds : spec.seconds) {
+        if (turnTicks <= backupTicks) continue;
+        Candidate c;
+        c.bounce = {baseSpeed, wallDistance, backupTicks, turnTicks, lowBatteryTime};
+        c.seconds = seconds;
+        candidates.push_back(c);
+    }
+    return candidates;
+}
+
+/// @brief Random search, count candidates drawn from the ranges with their own seed
+std::vector<Sim::Candidate> Sim::Random(const RandomSpec& spec, size_t count, uint32_t seed) {
+    std::mt19937 random(seed);
+    auto uniform = [&random](float low, float high) { return std::uniform_real_distribution<float>(low, high)(random); };
+    auto integer = [&random](int low, int high) { return std::uniform_int_distribution<int>(low, high)(random); };
+    std::vector<Candidate> candidates;
+    for (size_t i = 0; i < count; i++) {
+        Candidate c;
+        c.bounce.baseSpeed = uniform(spec.baseSpeed[0], spec.baseSpeed[1]);
+        c.bounce.wallDistance = uniform(spec.wallDistance[0], spec.wallDistance[1]);
+        c.bounce.backupTicks = integer(spec.backupTicks[0], spec.backupTicks[1]);
+        c.bounce.turnTicks = integer(std::max(spec.turnTicks[0], c.bounce.backupTicks + 1), std::max(spec.turnTicks[1], c.bounce.backupTicks + 1));
+        c.bounce.lowBatteryTime = uniform(spec.lowBatteryTime[0], spec.lowBatteryTime[1]);
+        c.seconds = spec.seconds;
+        candidates.push_back(c);
+    }
+    return candidates;
+}
+
+/// @brief Runs every candidate on the same seeds over a StealingPool and ranks them. Each episode writes only its
+/// @brief own slot and the means are taken in seed order afterwards, so the result is the same for any thread count
+/// @param threads Workers, the calling thread included
+Sim::SweepResult Sim::Sweep(const std::vector<Candidate>& candidates, const SweepParams& params, unsigned threads) {
+    auto start = std::chrono::steady_clock::now();
+    size_t episodes = candidates.size() * params.episodes;
+    std::vector<EpisodeResult> results(episodes);
+    StealingPool pool(threads);
+    pool.Run(episodes, [&](size_t job) {
+        const Candidate& c = candidates[job / params.episodes];
+        uint32_t seed = params.firstSeed + (uint32_t)(job % params.episodes);
+        results[job] = RunBouncer(params.world, seed, c.bounce, params.velocityControl, c.seconds);
+    });
+
+    SweepResult sweep;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        CandidateResult r = {candidates[i], 0, 0, 0, 0, 0};
+        for (int e = 0; e < params.episodes; e++) {
+            const EpisodeResult& episode = results[i * params.episodes + e];
+            r.collisions += episode.collisions;
+            r.wallTicks += episode.wallTicks;
+            r.coverage += episode.fraction * 100;
+            r.joules += episode.joules;
+        }
+        r.collisions /= params.episodes;
+        r.wallTicks /= params.episodes;
+        r.coverage /= params.episodes;
+        r.joules /= params.episodes;
+        r.score = r.coverage - params.collisionPenalty * r.collisions - params.energyPenalty * r.joules;
+        sweep.ranked.push_back(r);
+    }
+    //Stable, so equal scores keep the candidate order
+    std::stable_sort(sweep.ranked.begin(), sweep.ranked.end(), [](const CandidateResult& a, const CandidateResult& b) { return a.score > b.score; });
+    sweep.episodes = episodes;
+    sweep.stolen = pool.Stolen();
+    sweep.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return sweep;
+}
+
+#pragma endregion
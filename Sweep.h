@@ -0,0 +1,109 @@
+//Parameter sweeps of the wall bouncer over simulated episodes, for the Linux host build (P2_HOST).
+//Every candidate tuning runs the same seeds, the episodes are farmed out over a work-stealing thread pool and the
+//candidates are ranked on collisions, coverage and energy. Results depend only on the seeds, not on the threads.
+//
+//  Sim::SweepResult result = Sim::Sweep(Sim::Grid({...}), {}, threads);
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "HostSim.h"
+
+namespace Sim
+{
+    #pragma region Pool
+    /// @brief Runs jobs 0 to count-1 on a set of threads. Each thread takes its share as a contiguous block into
+    /// @brief its own deque and works from the back, an idle thread steals from the front of another's
+    class StealingPool {
+        public:
+            StealingPool(unsigned threads);
+
+            void Run(size_t count, const std::function<void(size_t job)>& job);
+
+            /// @brief Jobs taken from another thread's deque during the last Run
+            size_t Stolen() { return stolen; }
+            unsigned Threads() { return (unsigned)queues.size(); }
+
+        protected:
+            StealingPool() = delete;
+
+            struct Queue {
+                std::mutex lock;
+                std::deque<size_t> jobs;
+            };
+
+            bool Take(unsigned self, size_t& job);
+
+            std::vector<Queue> queues;
+            std::atomic<size_t> stolen;
+    };
+    #pragma endregion
+
+    #pragma region Sweep
+    /// @brief One set of the tunings core1_main hard codes. The 55 s battery warning only changes the LEDs, so it
+    /// @brief is not swept, the 60 s end of the run is the episode length
+    struct Candidate {
+        Control::BounceParams bounce;
+        float seconds = 60;
+    };
+
+    /// @brief The values to try for each tuning, every combination is a candidate
+    struct GridSpec {
+        std::vector<float> baseSpeed = {0.6f};
+        std::vector<float> wallDistance = {0.55f};
+        std::vector<int> backupTicks = {60};
+        std::vector<int> turnTicks = {100};
+        std::vector<float> lowBatteryTime = {45};
+        std::vector<float> seconds = {60};
+    };
+
+    /// @brief Ranges to draw candidates from uniformly
+    struct RandomSpec {
+        float baseSpeed[2] = {0.3f, 1.0f};
+        float wallDistance[2] = {0.25f, 0.8f};
+        int backupTicks[2] = {20, 100};
+        int turnTicks[2] = {40, 200};     //Counted from the start of the backup, kept past backupTicks
+        float lowBatteryTime[2] = {45, 45};
+        float seconds = 60;
+    };
+
+    std::vector<Candidate> Grid(const GridSpec& spec);
+    std::vector<Candidate> Random(const RandomSpec& spec, size_t count, uint32_t seed);
+
+    /// @brief How the candidates are run and ranked
+    struct SweepParams {
+        int episodes = 8;               //Seeds per candidate, the same for every candidate
+        uint32_t firstSeed = 1;
+        bool velocityControl = false;   //Like P2_VELOCITY_CONTROL
+        float collisionPenalty = 5;     //Percent of the cell covered that one collision per episode costs
+        float energyPenalty = 0;        //Percent of the cell covered that one joule per episode costs
+        WorldParams world;
+    };
+
+    /// @brief The means over a candidate's episodes, and its score
+    struct CandidateResult {
+        Candidate candidate;
+        float collisions;
+        float wallTicks;
+        float coverage;                 //Percent of the cell
+        float joules;
+        float score;                    //coverage - collisionPenalty * collisions - energyPenalty * joules
+    };
+
+    /// @brief Best first
+    struct SweepResult {
+        std::vector<CandidateResult> ranked;
+        size_t episodes;
+        size_t stolen;
+        double seconds;                 //Wall clock
+    };
+
+    SweepResult Sweep(const std::vector<Candidate>& candidates, const SweepParams& params, unsigned threads);
+    #pragma endregion
+} // namespace Sim
+
+#endif
@@ -0,0 +1,71 @@
+//Sweeps the wall bouncer's tuning over simulated episodes on Linux, built with -DP2_HOST=ON
+//Usage: p2_sweep [threads]                         a grid around the firmware's tuning, one worker per core by default
+//       p2_sweep [threads] random 200 [seed]       random search over 200 candidates
+//Options: velocity, like P2_VELOCITY_CONTROL, and name=value for episodes, collisionPenalty, energyPenalty.
+//Prints every candidate best first as CSV, and the timing on stderr.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include "Sweep.h"
+
+int main(int argc, char** argv) {
+    unsigned threads = std::thread::hardware_concurrency();
+    bool random = false;
+    size_t count = 200;
+    uint32_t seed = 1;
+    Sim::SweepParams params;
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        const char* equals = strchr(argv[i], '=');
+        if (strcmp(argv[i], "velocity") == 0) {
+            params.velocityControl = true;
+        } else if (strcmp(argv[i], "random") == 0) {
+            random = true;
+        } else if (equals) {
+            std::string name(argv[i], equals - argv[i]);
+            double value = atof(equals + 1);
+            if (name == "episodes") params.episodes = (int)value;
+            else if (name == "collisionPenalty") params.collisionPenalty = (float)value;
+            else if (name == "energyPenalty") params.energyPenalty = (float)value;
+            else {
+                fprintf(stderr, "Unknown option %s\n", argv[i]);
+                return 1;
+            }
+        } else if (!random && positional == 0) {
+            threads = (unsigned)atoi(argv[i]);
+            positional++;
+        } else if (random && positional <= 1) {
+            count = (size_t)atol(argv[i]);
+            positional = 2;
+        } else {
+            seed = (uint32_t)atol(argv[i]);
+        }
+    }
+    threads = threads > 0 ? threads : 1;
+
+    std::vector<Sim::Candidate> candidates;
+    if (random) {
+        candidates = Sim::Random({}, count, seed);
+    } else {
+        Sim::GridSpec grid;
+        grid.baseSpeed = {0.4f, 0.5f, 0.6f, 0.7f, 0.8f};
+        grid.wallDistance = {0.35f, 0.45f, 0.55f, 0.65f};
+        grid.backupTicks = {30, 60, 90};
+        grid.turnTicks = {80, 100, 140};
+        candidates = Sim::Grid(grid);
+    }
+
+    Sim::SweepResult result = Sim::Sweep(candidates, params, threads);
+    printf("rank,baseSpeed,wallDistance,backupTicks,turnTicks,lowBatteryTime,seconds,collisions,wallTicks,coverage,joules,score\n");
+    for (size_t i = 0; i < result.ranked.size(); i++) {
+        const Sim::CandidateResult& r = result.ranked[i];
+        const Control::BounceParams& b = r.candidate.bounce;
+        printf("%zu,%.3f,%.3f,%d,%d,%.1f,%.0f,%.3f,%.1f,%.2f,%.1f,%.2f\n", i + 1, b.baseSpeed, b.wallDistance, b.backupTicks,
+            b.turnTicks, b.lowBatteryTime, r.candidate.seconds, r.collisions, r.wallTicks, r.coverage, r.joules, r.score);
+    }
+    fprintf(stderr, "%zu candidates x %d seeds = %zu episodes on %u threads in %.2f s (%.0f episodes/min), %zu stolen\n",
+        candidates.size(), params.episodes, result.episodes, threads, result.seconds, result.episodes / result.seconds * 60, result.stolen);
+    return 0;
+}
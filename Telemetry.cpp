@@ -0,0 +1,193 @@
+#include "Telemetry.h"
+#include <cstring>
+
+#pragma region Encoding
+
+namespace {
+    template <class T>
+    uint8_t* Put(uint8_t* out, T value) {
+        std::memcpy(out, &value, sizeof(T));
+        return out + sizeof(T);
+    }
+
+    template <class T>
+    const uint8_t* Get(const uint8_t* in, T& value) {
+        std::memcpy(&value, in, sizeof(T));
+        return in + sizeof(T);
+    }
+
+    struct CrcTable {
+        uint16_t entries[256];
+    };
+
+    /// @brief The CRC of every byte value, worked out at compile time so it sits in flash
+    constexpr CrcTable MakeCrcTable() {
+        CrcTable table = {};
+        for (int value = 0; value < 256; value++) {
+            uint16_t crc = (uint16_t)(value << 8);
+            for (int bit = 0; bit < 8; bit++) {
+                crc = crc & 0x8000 ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+            }
+            table.entries[value] = crc;
+        }
+        return table;
+    }
+
+    constexpr CrcTable crcTable = MakeCrcTable();
+}
+
+/// @brief CRC-16/CCITT-FALSE, polynomial 0x1021, one table lookup per byte
+/// @param crc The running value, to continue a CRC over several blocks
+uint16_t Telemetry::Crc16(const uint8_t* data, size_t length, uint16_t crc) {
+    for (size_t i = 0; i < length; i++) {
+        crc = (uint16_t)((crc << 8) ^ crcTable.entries[((crc >> 8) ^ data[i]) & 0xff]);
+    }
+    return crc;
+}
+
+/// @brief Wraps an already packed payload into a complete frame
+/// @param payload At most maxPayload bytes
+/// @param frame Output, at least headerSize + length + crcSize bytes
+/// @return the frame length in bytes
+size_t Telemetry::EncodeFrame(FrameType type, uint16_t sequence, const uint8_t* payload, size_t length, uint8_t* frame) {
+    uint8_t* out = frame;
+    out = Put<uint8_t>(out, sync0);
+    out = Put<uint8_t>(out, sync1);
+    out = Put<uint8_t>(out, version);
+    out = Put<uint8_t>(out, (uint8_t)type);
+    out = Put<uint16_t>(out, sequence);
+    out = Put<uint8_t>(out, (uint8_t)length);
+    std::memcpy(out, payload, length);
+    out += length;
+    out = Put<uint16_t>(out, Crc16(frame + 2, out - frame - 2));
+    return out - frame;
+}
+
+/// @brief Writes a Record as a complete State frame. Both the RP2350 and the host are little endian,
+/// @brief so the fields are copied as they are
+/// @param record The snapshot to send
+/// @param sequence The frame counter
+/// @param frame Output, at least headerSize + recordSize + crcSize bytes
+/// @return the frame length in bytes
+size_t Telemetry::EncodeRecord(const Record& record, uint16_t sequence, uint8_t* frame) {
+    uint8_t* out = frame;
+    out = Put<uint8_t>(out, sync0);
+    out = Put<uint8_t>(out, sync1);
+    out = Put<uint8_t>(out, version);
+    out = Put<uint8_t>(out, (uint8_t)FrameType::State);
+    out = Put<uint16_t>(out, sequence);
+    out = Put<uint8_t>(out, (uint8_t)recordSize);
+
+    out = Put(out, record.timestamp_us);
+    out = Put(out, record.distance);
+    out = Put(out, record.leftCounts);
+    out = Put(out, record.rightCounts);
+    out = Put(out, record.leftVelocity);
+    out = Put(out, record.rightVelocity);
+    out = Put(out, record.leftDuty);
+    out = Put(out, record.rightDuty);
+    out = Put(out, record.mode);
+    out = Put(out, record.controlMaxRun_us);
+    out = Put(out, record.controlMaxLateness_us);
+    out = Put(out, record.controlOverruns);
+
+    out = Put<uint16_t>(out, Crc16(frame + 2, out - frame - 2));
+    return out - frame;
+}
+
+/// @brief Reads a State payload back into a Record
+/// @return false when the payload is too short for a Record
+bool Telemetry::DecodeRecord(const uint8_t* payload, size_t length, Record& record) {
+    if (length < recordSize) return false;
+    const uint8_t* in = payload;
+    in = Get(in, record.timestamp_us);
+    in = Get(in, record.distance);
+    in = Get(in, record.leftCounts);
+    in = Get(in, record.rightCounts);
+    in = Get(in, record.leftVelocity);
+    in = Get(in, record.rightVelocity);
+    in = Get(in, record.leftDuty);
+    in = Get(in, record.rightDuty);
+    in = Get(in, record.mode);
+    in = Get(in, record.controlMaxRun_us);
+    in = Get(in, record.controlMaxLateness_us);
+    in = Get(in, record.controlOverruns);
+    return true;
+}
+
+#pragma endregion
+
+#pragma region Decoder
+
+Telemetry::Decoder::Decoder()
+: size(0), haveSequence(false), lastSequence(0), frames(0), crcErrors(0), skipped(0), lost(0)
+{
+
+}
+
+/// @brief Adds one byte of the stream, take the frames it completes with Next before the next Push
+void Telemetry::Decoder::Push(uint8_t byte) {
+    if (size == maxFrame) {
+        Shift(1);
+        skipped++;
+    }
+    buffer[size++] = byte;
+}
+
+/// @brief Takes the next good frame out of the bytes pushed so far. After a false sync is rejected
+/// @brief several buffered frames can be ready at once, so call it until it returns false
+/// @param frame Filled in when a frame is returned
+/// @return true when a frame was returned
+bool Telemetry::Decoder::Next(Frame& frame) {
+    while (size > 0) {
+        //Hunt for the sync pair, one byte at a time
+        if (buffer[0] != sync0 || (size > 1 && buffer[1] != sync1)) {
+            Shift(1);
+            skipped++;
+            continue;
+        }
+        if (size < headerSize) return false;
+
+        size_t length = buffer[6];
+        if (buffer[2] != version) {
+            //A frame from a firmware this decoder does not know, or a false sync
+            Shift(1);
+            skipped++;
+            continue;
+        }
+        size_t total = headerSize + length + crcSize;
+        if (size < total) return false;
+
+        uint16_t crc;
+        std::memcpy(&crc, buffer + headerSize + length, sizeof(crc));
+        if (crc != Crc16(buffer + 2, headerSize - 2 + length)) {
+            crcErrors++;
+            Shift(1);
+            skipped++;
+            continue;
+        }
+
+        std::memcpy(this->frame, buffer, total);
+        frame.version = this->frame[2];
+        frame.type = (FrameType)this->frame[3];
+        std::memcpy(&frame.sequence, this->frame + 4, sizeof(frame.sequence));
+        frame.length = (uint8_t)length;
+        frame.payload = this->frame + headerSize;
+        Shift(total);
+
+        if (haveSequence) lost += (uint16_t)(frame.sequence - lastSequence - 1);
+        haveSequence = true;
+        lastSequence = frame.sequence;
+        frames++;
+        return true;
+    }
+    return false;
+}
+
+/// @brief Drops bytes from the front of the buffer
+void Telemetry::Decoder::Shift(size_t count) {
+    std::memmove(buffer, buffer + count, size - count);
+    size -= count;
+}
+
+#pragma endregion
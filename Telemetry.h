@@ -0,0 +1,104 @@
+//Binary telemetry frames. The robot encodes a Record into a frame and streams it out of the UART,
+//the host decodes the byte stream back into Records, see UartStream.h and TelemetryDecode.cpp.
+//
+//Frame, little endian:
+//  0     sync 0xA5
+//  1     sync 0x5A
+//  2     version
+//  3     type
+//  4-5   sequence, counts up by one per frame
+//  6     payload length
+//  7     payload
+//  7+n   CRC-16/CCITT-FALSE of bytes 2 to 6+n
+//
+//Bump the version whenever the payload layout of a type changes, the decoder rejects versions it does not know.
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Telemetry
+{
+    inline constexpr uint8_t sync0 = 0xA5;
+    inline constexpr uint8_t sync1 = 0x5A;
+    inline constexpr uint8_t version = 1;
+    inline constexpr size_t headerSize = 7;
+    inline constexpr size_t crcSize = 2;
+    inline constexpr size_t maxPayload = 255;
+    inline constexpr size_t maxFrame = headerSize + maxPayload + crcSize;
+
+    enum class FrameType : uint8_t {
+        State = 1,      //A Record
+        Trace = 2,      //Trace entries of one core, see Trace.h
+        TraceName = 3,  //The name of a scheduler task of one core
+        Input = 4,      //Raw inputs for replay, see Recorder.h
+    };
+
+    /// @brief One snapshot of the robot, sent as a State frame
+    struct Record {
+        uint64_t timestamp_us;
+        float distance;                 //Meters, -1 when out of range
+        int32_t leftCounts;             //Encoder counts
+        int32_t rightCounts;
+        float leftVelocity;             //Wheel linear velocity in m/s
+        float rightVelocity;
+        float leftDuty;                 //Motor duty, 0 to 1
+        float rightDuty;
+        int32_t mode;                   //Even for PAUSE, odd for WORK
+        uint32_t controlMaxRun_us;      //Longest control task run so far
+        uint32_t controlMaxLateness_us; //Longest control task start delay so far
+        uint32_t controlOverruns;       //Control periods skipped so far
+    };
+
+    /// @brief Bytes of a Record in a version 1 payload, packed field by field
+    inline constexpr size_t recordSize = 8 + 4 * 11;
+
+    uint16_t Crc16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF);
+
+    size_t EncodeFrame(FrameType type, uint16_t sequence, const uint8_t* payload, size_t length, uint8_t* frame);
+    size_t EncodeRecord(const Record& record, uint16_t sequence, uint8_t* frame);
+    bool DecodeRecord(const uint8_t* payload, size_t length, Record& record);
+
+    /// @brief A frame the Decoder accepted
+    struct Frame {
+        uint8_t version;
+        FrameType type;
+        uint16_t sequence;
+        uint8_t length;
+        const uint8_t* payload; //Valid until the next call to Next
+    };
+
+    /// @brief Streaming frame decoder. Bytes go in one at a time from any capture, a bad CRC or
+    /// @brief garbage between frames costs only the damaged frame, the decoder resynchronizes on the next sync
+    class Decoder {
+        public:
+            Decoder();
+
+            void Push(uint8_t byte);
+            bool Next(Frame& frame);
+
+            uint32_t Frames() { return frames; }
+            /// @brief Frames with a good header but a bad CRC
+            uint32_t CrcErrors() { return crcErrors; }
+            /// @brief Bytes thrown away while looking for a sync
+            uint32_t SkippedBytes() { return skipped; }
+            /// @brief Frames missing according to the sequence numbers
+            uint32_t Lost() { return lost; }
+
+        protected:
+            void Shift(size_t count);
+
+            uint8_t buffer[maxFrame];
+            uint8_t frame[maxFrame];
+            size_t size;
+            bool haveSequence;
+            uint16_t lastSequence;
+            uint32_t frames;
+            uint32_t crcErrors;
+            uint32_t skipped;
+            uint32_t lost;
+    };
+} // namespace Telemetry
+
+#endif
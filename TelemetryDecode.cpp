@@ -0,0 +1,159 @@
+//Decodes a capture of the robot's binary telemetry, built with -DP2_HOST=ON
+//Usage: p2_decode capture.bin              CSV on stdout
+//       p2_decode capture.bin run1         run1.csv and the columnar run1.columns/ directory
+//Capture with the robot's UART on a serial adapter, e.g. stty -F /dev/ttyUSB0 115200 raw && cat /dev/ttyUSB0 > capture.bin
+//Every column file is a raw little endian array, numpy.fromfile("run1.columns/distance.bin", "<f4") reads one back.
+#include <stdio.h>
+#include <string.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "Telemetry.h"
+
+#pragma region Columns
+
+/// @brief One field of Telemetry::Record as a column
+struct Column {
+    const char* name;
+    const char* type;   //numpy dtype of the column file
+    size_t offset;
+    char kind;          //u unsigned, i signed, f float
+    size_t size;
+};
+
+#define COLUMN(field, type, kind) {#field, type, offsetof(Telemetry::Record, field), kind, sizeof(Telemetry::Record::field)}
+
+static const Column columns[] = {
+    COLUMN(timestamp_us, "<u8", 'u'),
+    COLUMN(distance, "<f4", 'f'),
+    COLUMN(leftCounts, "<i4", 'i'),
+    COLUMN(rightCounts, "<i4", 'i'),
+    COLUMN(leftVelocity, "<f4", 'f'),
+    COLUMN(rightVelocity, "<f4", 'f'),
+    COLUMN(leftDuty, "<f4", 'f'),
+    COLUMN(rightDuty, "<f4", 'f'),
+    COLUMN(mode, "<i4", 'i'),
+    COLUMN(controlMaxRun_us, "<u4", 'u'),
+    COLUMN(controlMaxLateness_us, "<u4", 'u'),
+    COLUMN(controlOverruns, "<u4", 'u'),
+};
+
+/// @brief Prints one field of a record as CSV text
+static void PrintField(FILE* out, const Telemetry::Record& record, const Column& column) {
+    const uint8_t* field = (const uint8_t*)&record + column.offset;
+    if (column.kind == 'f') {
+        float value;
+        memcpy(&value, field, sizeof(value));
+        fprintf(out, "%.6g", value);
+    } else if (column.kind == 'i') {
+        int32_t value;
+        memcpy(&value, field, sizeof(value));
+        fprintf(out, "%ld", (long)value);
+    } else if (column.size == 8) {
+        uint64_t value;
+        memcpy(&value, field, sizeof(value));
+        fprintf(out, "%llu", (unsigned long long)value);
+    } else {
+        uint32_t value;
+        memcpy(&value, field, sizeof(value));
+        fprintf(out, "%lu", (unsigned long)value);
+    }
+}
+
+#pragma endregion
+
+#pragma region Writers
+
+static void WriteCsv(FILE* out, const std::vector<Telemetry::Record>& records, const std::vector<uint16_t>& sequences) {
+    fprintf(out, "sequence");
+    for (const Column& column : columns) fprintf(out, ",%s", column.name);
+    fprintf(out, "\n");
+    for (size_t r = 0; r < records.size(); r++) {
+        fprintf(out, "%u", sequences[r]);
+        for (const Column& column : columns) {
+            fprintf(out, ",");
+            PrintField(out, records[r], column);
+        }
+        fprintf(out, "\n");
+    }
+}
+
+/// @brief One file per column plus schema.txt with a "name dtype rows" line per column
+static bool WriteColumns(const std::string& directory, const std::vector<Telemetry::Record>& records) {
+    mkdir(directory.c_str(), 0755);
+    FILE* schema = fopen((directory + "/schema.txt").c_str(), "w");
+    if (!schema) return false;
+
+    for (const Column& column : columns) {
+        FILE* file = fopen((directory + "/" + column.name + ".bin").c_str(), "wb");
+        if (!file) {
+            fclose(schema);
+            return false;
+        }
+        for (const Telemetry::Record& record : records) {
+            fwrite((const uint8_t*)&record + column.offset, column.size, 1, file);
+        }
+        fclose(file);
+        fprintf(schema, "%s %s %zu\n", column.name, column.type, records.size());
+    }
+    fclose(schema);
+    return true;
+}
+
+#pragma endregion
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s capture.bin [output prefix]\n", argv[0]);
+        return 2;
+    }
+    FILE* capture = fopen(argv[1], "rb");
+    if (!capture) {
+        fprintf(stderr, "can not open %s\n", argv[1]);
+        return 1;
+    }
+
+    Telemetry::Decoder decoder;
+    Telemetry::Frame frame;
+    std::vector<Telemetry::Record> records;
+    std::vector<uint16_t> sequences;
+    uint32_t otherFrames = 0;
+
+    uint8_t chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), capture)) > 0) {
+        for (size_t i = 0; i < read; i++) {
+            decoder.Push(chunk[i]);
+            while (decoder.Next(frame)) {
+                Telemetry::Record record;
+                if (frame.type == Telemetry::FrameType::State && Telemetry::DecodeRecord(frame.payload, frame.length, record)) {
+                    records.push_back(record);
+                    sequences.push_back(frame.sequence);
+                } else {
+                    otherFrames++;
+                }
+            }
+        }
+    }
+    fclose(capture);
+
+    if (argc > 2) {
+        std::string prefix = argv[2];
+        FILE* csv = fopen((prefix + ".csv").c_str(), "w");
+        if (!csv || !WriteColumns(prefix + ".columns", records)) {
+            fprintf(stderr, "can not write %s.csv or %s.columns\n", argv[2], argv[2]);
+            if (csv) fclose(csv);
+            return 1;
+        }
+        WriteCsv(csv, records, sequences);
+        fclose(csv);
+    } else {
+        WriteCsv(stdout, records, sequences);
+    }
+
+    fprintf(stderr, "%zu records, %lu other frames, %lu lost, %lu CRC errors, %lu bytes skipped\n",
+        records.size(), (unsigned long)otherFrames, (unsigned long)decoder.Lost(),
+        (unsigned long)decoder.CrcErrors(), (unsigned long)decoder.SkippedBytes());
+    return 0;
+}
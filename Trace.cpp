@@ -0,0 +1,157 @@
+#include "Trace.h"
+#include "Telemetry.h"
+#include <cstring>
+
+Trace::Ring Trace::rings[2];
+std::atomic<bool> Trace::frozen(false);
+
+namespace {
+    const char* taskNames[2][Trace::maxNames] = {};
+
+    const char* const idNames[] = {
+        "gpio irq",
+        "echo",
+        "encoder edge",
+        "encoder timer",
+        "task",
+        "overrun",
+        "idle",
+        "stream pending",
+    };
+    static_assert(sizeof(idNames) / sizeof(idNames[0]) == (size_t)Trace::Id::Count, "Every Trace::Id needs a name");
+}
+
+/// @brief The display name of an event id
+const char* Trace::Name(Id id) {
+    return (size_t)id < (size_t)Id::Count ? idNames[(size_t)id] : "unknown";
+}
+
+#pragma region Ring
+
+Trace::Ring::Ring()
+: head(0)
+{
+
+}
+
+/// @brief Copies out the entries still in the ring, oldest first. Only consistent while the ring is frozen
+/// @param first How many of the kept entries to skip
+/// @param out Room for count entries
+/// @return the entries copied
+size_t Trace::Ring::Read(size_t first, Entry* out, size_t count) {
+    uint32_t recorded = Recorded();
+    uint32_t oldest = recorded > capacity ? recorded - (uint32_t)capacity : 0;
+    size_t kept = recorded - oldest;
+    if (first >= kept) return 0;
+    count = count < kept - first ? count : kept - first;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = entries[(oldest + first + i) & (capacity - 1)];
+    }
+    return count;
+}
+
+#pragma endregion
+
+#pragma region Recording
+
+/// @brief Names a scheduler task of the calling core, the name must outlive the dump
+void Trace::NameTask(int task, const char* name) {
+    if (task >= 0 && task < maxNames) taskNames[get_core_num()][task] = name;
+}
+
+/// @brief Stops both cores recording, so the rings hold still for Dump. A record already under way on
+/// @brief the other core may still land, so freeze a little before dumping, not in the middle of a burst
+void Trace::Freeze() {
+    frozen.store(true, std::memory_order_relaxed);
+}
+
+/// @brief Lets both cores record again
+void Trace::Resume() {
+    frozen.store(false, std::memory_order_relaxed);
+}
+
+/// @brief Sends the task names and both rings as Telemetry frames, core0 first. Freeze first
+/// @param sink Gets each frame, it must take them all, e.g. by waiting for room in the UART stream
+/// @param sequence The frame counter of the stream the frames go into, so the decoder sees no gaps
+void Trace::Dump(Sink sink, void* context, uint16_t& sequence) {
+    uint8_t frame[Telemetry::maxFrame];
+    Entry entries[entriesPerFrame];
+    for (uint8_t core = 0; core < 2; core++) {
+        for (uint8_t task = 0; task < maxNames; task++) {
+            if (taskNames[core][task]) sink(frame, EncodeName(core, task, taskNames[core][task], sequence++, frame), context);
+        }
+        size_t first = 0;
+        size_t count;
+        while ((count = rings[core].Read(first, entries, entriesPerFrame)) > 0) {
+            sink(frame, EncodeEntries(core, entries, count, sequence++, frame), context);
+            first += count;
+        }
+    }
+}
+
+#pragma endregion
+
+#pragma region Frames
+
+/// @brief Packs up to entriesPerFrame entries of one core into a Trace frame
+/// @return the frame length in bytes
+size_t Trace::EncodeEntries(uint8_t core, const Entry* entries, size_t count, uint16_t sequence, uint8_t* frame) {
+    uint8_t payload[2 + entriesPerFrame * entrySize];
+    count = count < entriesPerFrame ? count : entriesPerFrame;
+    payload[0] = core;
+    payload[1] = (uint8_t)count;
+    uint8_t* out = payload + 2;
+    for (size_t i = 0; i < count; i++) {
+        std::memcpy(out, &entries[i].timestamp_us, 4);
+        std::memcpy(out + 4, &entries[i].payload, 4);
+        out[8] = (uint8_t)entries[i].id;
+        out[9] = (uint8_t)entries[i].kind;
+        out += entrySize;
+    }
+    return Telemetry::EncodeFrame(Telemetry::FrameType::Trace, sequence, payload, out - payload, frame);
+}
+
+/// @brief Unpacks a Trace frame payload
+/// @param entries Room for entriesPerFrame entries
+/// @return false when the payload is malformed
+bool Trace::DecodeEntries(const uint8_t* payload, size_t length, uint8_t& core, Entry* entries, size_t& count) {
+    if (length < 2) return false;
+    core = payload[0];
+    count = payload[1];
+    if (core > 1 || count > entriesPerFrame || length < 2 + count * entrySize) return false;
+    const uint8_t* in = payload + 2;
+    for (size_t i = 0; i < count; i++) {
+        std::memcpy(&entries[i].timestamp_us, in, 4);
+        std::memcpy(&entries[i].payload, in + 4, 4);
+        entries[i].id = (Id)in[8];
+        entries[i].kind = (Kind)in[9];
+        entries[i].reserved = 0;
+        in += entrySize;
+    }
+    return true;
+}
+
+/// @brief Packs a task name into a TraceName frame, cut to maxNameLength characters
+/// @return the frame length in bytes
+size_t Trace::EncodeName(uint8_t core, uint8_t task, const char* name, uint16_t sequence, uint8_t* frame) {
+    uint8_t payload[2 + maxNameLength];
+    size_t length = strnlen(name, maxNameLength);
+    payload[0] = core;
+    payload[1] = task;
+    std::memcpy(payload + 2, name, length);
+    return Telemetry::EncodeFrame(Telemetry::FrameType::TraceName, sequence, payload, 2 + length, frame);
+}
+
+/// @brief Unpacks a TraceName frame payload
+/// @param name Room for maxNameLength + 1 characters, comes back terminated
+/// @return false when the payload is malformed
+bool Trace::DecodeName(const uint8_t* payload, size_t length, uint8_t& core, uint8_t& task, char* name) {
+    if (length < 2 || length > 2 + maxNameLength) return false;
+    core = payload[0];
+    task = payload[1];
+    std::memcpy(name, payload + 2, length - 2);
+    name[length - 2] = 0;
+    return core <= 1;
+}
+
+#pragma endregion
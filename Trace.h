@@ -0,0 +1,123 @@
+//Event tracing into RAM, one ring per core. Build with -DP2_TRACE=ON, without it every TRACE_ macro
+//compiles to nothing and the linker drops the rings.
+//
+//  TRACE_BEGIN(Task, id);      //A span on this core's timeline, ends with the matching TRACE_END
+//  TRACE_END(Task, id);
+//  TRACE_INSTANT(Echo, pulse); //A point in time with a payload
+//  TRACE_COUNTER(StreamPending, bytes); //A value to plot
+//
+//Recording is a fetch_add on the ring head plus a 12 byte store, safe from ISRs, timer callbacks and tasks
+//on either core. The oldest entries are overwritten. Dump sends both rings as Telemetry frames, p2_trace
+//turns a capture into Chrome trace JSON for chrome://tracing or ui.perfetto.dev.
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "HAL.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Trace
+{
+    /// @brief What happened. Add new ids at the end, the exporter names them through Name
+    enum class Id : uint8_t {
+        GpioIrq,        //MasterCallback, payload is the pin
+        Echo,           //Echo pulse measured, payload is its width in us
+        EncoderEdge,    //Interrupt backend edge, payload is pin A << 8 | the AB pair
+        EncoderTimer,   //Velocity tick, payload is pin A
+        Task,           //Scheduler task, payload is the task id
+        Overrun,        //A task missed whole periods, payload is the task id
+        Idle,           //Scheduler idle, payload is 0
+        StreamPending,  //Counter, bytes waiting in the telemetry UART stream
+        Count
+    };
+
+    enum class Kind : uint8_t {
+        Instant,
+        Begin,
+        End,
+        Counter,
+    };
+
+    struct Entry {
+        uint32_t timestamp_us;  //time_us_32, wraps after 71 minutes
+        uint32_t payload;
+        Id id;
+        Kind kind;
+        uint16_t reserved;
+    };
+
+    const char* Name(Id id);
+
+    /// @brief A multi-producer ring of one core. Producers on the same core may interrupt each other,
+    /// @brief each gets its own slot from the fetch_add
+    class Ring {
+        public:
+            Ring();
+
+            void Record(Id id, Kind kind, uint32_t payload) {
+                uint32_t index = head.fetch_add(1, std::memory_order_relaxed);
+                entries[index & (capacity - 1)] = {time_us_32(), payload, id, kind, 0};
+            }
+
+            void Clear() { head.store(0, std::memory_order_relaxed); }
+            /// @brief Entries recorded so far, including the overwritten ones
+            uint32_t Recorded() { return head.load(std::memory_order_relaxed); }
+            size_t Read(size_t first, Entry* out, size_t count);
+
+            /// @brief Entries kept, a power of two. 12 KB per core
+            static constexpr size_t capacity = 1024;
+
+        protected:
+            std::atomic<uint32_t> head;
+            Entry entries[capacity];
+    };
+
+    /// @brief Receives the dump, one complete frame per call
+    typedef void (*Sink)(const uint8_t* data, size_t length, void* context);
+
+    /// @brief Task names per core, sent with the dump so the exporter can label the Task spans
+    static constexpr int maxNames = 8;
+    static constexpr size_t maxNameLength = 23;
+
+    extern Ring rings[2];
+    extern std::atomic<bool> frozen;
+
+    /// @brief Records into the calling core's ring, unless the rings are frozen for a dump
+    inline void Record(Id id, Kind kind, uint32_t payload) {
+        if (frozen.load(std::memory_order_relaxed)) return;
+        rings[get_core_num()].Record(id, kind, payload);
+    }
+
+    void NameTask(int task, const char* name);
+    void Freeze();
+    void Resume();
+    void Dump(Sink sink, void* context, uint16_t& sequence);
+
+    #pragma region Frames
+    /// @brief Entries in one Trace frame, the payload is the core, the count and the entries
+    inline constexpr size_t entrySize = 10;
+    inline constexpr size_t entriesPerFrame = 25;
+
+    size_t EncodeEntries(uint8_t core, const Entry* entries, size_t count, uint16_t sequence, uint8_t* frame);
+    bool DecodeEntries(const uint8_t* payload, size_t length, uint8_t& core, Entry* entries, size_t& count);
+    size_t EncodeName(uint8_t core, uint8_t task, const char* name, uint16_t sequence, uint8_t* frame);
+    bool DecodeName(const uint8_t* payload, size_t length, uint8_t& core, uint8_t& task, char* name);
+    #pragma endregion
+} // namespace Trace
+
+#ifdef P2_TRACE
+#define TRACE_INSTANT(id, payload) Trace::Record(Trace::Id::id, Trace::Kind::Instant, (uint32_t)(payload))
+#define TRACE_BEGIN(id, payload) Trace::Record(Trace::Id::id, Trace::Kind::Begin, (uint32_t)(payload))
+#define TRACE_END(id, payload) Trace::Record(Trace::Id::id, Trace::Kind::End, (uint32_t)(payload))
+#define TRACE_COUNTER(id, value) Trace::Record(Trace::Id::id, Trace::Kind::Counter, (uint32_t)(value))
+#define TRACE_NAME_TASK(task, name) Trace::NameTask(task, name)
+#else
+#define TRACE_INSTANT(id, payload) ((void)0)
+#define TRACE_BEGIN(id, payload) ((void)0)
+#define TRACE_END(id, payload) ((void)0)
+#define TRACE_COUNTER(id, value) ((void)0)
+#define TRACE_NAME_TASK(task, name) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,150 @@
+//Turns the trace dump in a capture of the robot's telemetry into Chrome trace JSON, built with -DP2_HOST=ON
+//Usage: p2_trace capture.bin trace.json
+//Open the JSON in ui.perfetto.dev or chrome://tracing, each core is a thread of one process.
+//The robot dumps its trace rings at the end of a run when built with -DP2_TRACE=ON, see Trace.h.
+//A capture with several dumps keeps the last one of each core.
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "Telemetry.h"
+#include "Trace.h"
+
+#pragma region Conversion
+
+/// @brief One core's part of the dump
+struct CoreTrace {
+    std::vector<Trace::Entry> entries;
+    std::string taskNames[Trace::maxNames];
+};
+
+/// @brief The display name of an event, with the payload where it tells spans apart
+static std::string Label(const CoreTrace& core, const Trace::Entry& entry) {
+    char text[64];
+    switch (entry.id) {
+        case Trace::Id::Task:
+        case Trace::Id::Overrun:
+            if (entry.payload < (uint32_t)Trace::maxNames && !core.taskNames[entry.payload].empty()) {
+                return entry.id == Trace::Id::Task ? core.taskNames[entry.payload] : "overrun " + core.taskNames[entry.payload];
+            }
+            snprintf(text, sizeof(text), "%s %lu", Trace::Name(entry.id), (unsigned long)entry.payload);
+            return text;
+        case Trace::Id::GpioIrq:
+        case Trace::Id::EncoderTimer:
+            snprintf(text, sizeof(text), "%s %lu", Trace::Name(entry.id), (unsigned long)entry.payload);
+            return text;
+        case Trace::Id::EncoderEdge:
+            snprintf(text, sizeof(text), "%s %lu", Trace::Name(entry.id), (unsigned long)(entry.payload >> 8));
+            return text;
+        default:
+            return Trace::Name(entry.id);
+    }
+}
+
+/// @brief Writes both cores as one process, two threads. Timestamps are unwrapped per core and start at
+/// @brief the earliest entry. Ends whose begin was overwritten in the ring are left out
+static void WriteJson(FILE* out, const CoreTrace cores[2]) {
+    //Both cores read the same timer, so one origin lines them up
+    bool haveOrigin = false;
+    uint32_t origin = 0;
+    for (int core = 0; core < 2; core++) {
+        if (cores[core].entries.empty()) continue;
+        uint32_t first = cores[core].entries.front().timestamp_us;
+        if (!haveOrigin || (int32_t)(first - origin) < 0) origin = first;
+        haveOrigin = true;
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"p2\"}}");
+    for (int core = 0; core < 2; core++) {
+        fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"core%d\"}}", core, core);
+    }
+
+    for (int core = 0; core < 2; core++) {
+        int64_t time = 0;
+        uint32_t last = origin;
+        int depth = 0;
+        for (const Trace::Entry& entry : cores[core].entries) {
+            //Signed, an ISR between another record's slot and its clock read lands a few us out of order
+            time += (int32_t)(entry.timestamp_us - last);
+            last = entry.timestamp_us;
+            std::string label = Label(cores[core], entry);
+
+            switch (entry.kind) {
+                case Trace::Kind::Begin:
+                    depth++;
+                    fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"B\",\"ts\":%lld,\"pid\":0,\"tid\":%d,\"args\":{\"payload\":%lu}}",
+                        label.c_str(), Trace::Name(entry.id), (long long)time, core, (unsigned long)entry.payload);
+                    break;
+                case Trace::Kind::End:
+                    if (depth == 0) break;
+                    depth--;
+                    fprintf(out, ",\n{\"ph\":\"E\",\"ts\":%lld,\"pid\":0,\"tid\":%d}", (long long)time, core);
+                    break;
+                case Trace::Kind::Instant:
+                    fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,\"pid\":0,\"tid\":%d,\"args\":{\"payload\":%lu}}",
+                        label.c_str(), Trace::Name(entry.id), (long long)time, core, (unsigned long)entry.payload);
+                    break;
+                case Trace::Kind::Counter:
+                    fprintf(out, ",\n{\"name\":\"%s core%d\",\"ph\":\"C\",\"ts\":%lld,\"pid\":0,\"args\":{\"value\":%lu}}",
+                        label.c_str(), core, (long long)time, (unsigned long)entry.payload);
+                    break;
+            }
+        }
+    }
+    fprintf(out, "\n]}\n");
+}
+
+#pragma endregion
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: p2_trace capture.bin trace.json\n");
+        return 1;
+    }
+    FILE* in = fopen(argv[1], "rb");
+    if (!in) {
+        fprintf(stderr, "Can not open %s\n", argv[1]);
+        return 1;
+    }
+
+    CoreTrace cores[2];
+    bool started[2] = {false, false};
+    Telemetry::Decoder decoder;
+    Telemetry::Frame frame;
+    Trace::Entry entries[Trace::entriesPerFrame];
+    char name[Trace::maxNameLength + 1];
+    int byte;
+    while ((byte = fgetc(in)) != EOF) {
+        decoder.Push((uint8_t)byte);
+        while (decoder.Next(frame)) {
+            uint8_t core, task;
+            size_t count;
+            if (frame.type == Telemetry::FrameType::TraceName && Trace::DecodeName(frame.payload, frame.length, core, task, name)) {
+                //Names lead each core's part of a dump, so names after entries start a new dump
+                if (started[core]) {
+                    cores[core] = CoreTrace();
+                    started[core] = false;
+                }
+                if (task < Trace::maxNames) cores[core].taskNames[task] = name;
+            } else if (frame.type == Telemetry::FrameType::Trace && Trace::DecodeEntries(frame.payload, frame.length, core, entries, count)) {
+                started[core] = true;
+                cores[core].entries.insert(cores[core].entries.end(), entries, entries + count);
+            }
+        }
+    }
+    fclose(in);
+
+    FILE* out = fopen(argv[2], "w");
+    if (!out) {
+        fprintf(stderr, "Can not create %s\n", argv[2]);
+        return 1;
+    }
+    WriteJson(out, cores);
+    fclose(out);
+
+    fprintf(stderr, "%zu core0 and %zu core1 entries from %lu frames, %lu CRC errors, %lu lost frames\n",
+        cores[0].entries.size(), cores[1].entries.size(), (unsigned long)decoder.Frames(),
+        (unsigned long)decoder.CrcErrors(), (unsigned long)decoder.Lost());
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include "UartStream.h"
+#include "hardware/dma.h"
+
+#pragma region UartStream
+
+/// @brief Claims a DMA channel paced by the UART's TX DREQ. The UART must already be set up, e.g. by stdio_init_all
+/// @param uart The UART to send on
+Telemetry::UartStream::UartStream(uart_inst_t* uart)
+: UART(uart), head(0), tail(0), inFlight(0), dropped(0)
+{
+    dmaChannel = dma_claim_unused_channel(true);
+
+    dma_channel_config config = dma_channel_get_default_config(dmaChannel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, uart_get_dreq_num(UART, true));
+    dma_channel_configure(dmaChannel, &config, &uart_get_hw(UART)->dr, ring, 0, false);
+}
+
+/// @brief Queues bytes to send. A write that does not fit is dropped whole, so frames are never cut
+/// @return false when the ring was too full
+bool Telemetry::UartStream::Write(const uint8_t* data, size_t length) {
+    if (capacity - (head - tail) < length) {
+        dropped++;
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        ring[(head + i) & (capacity - 1)] = data[i];
+    }
+    head += length;
+    Pump();
+    return true;
+}
+
+/// @brief Retires the block the DMA finished and starts the next one. Call it regularly,
+/// @brief Write calls it too
+void Telemetry::UartStream::Pump() {
+    if (dma_channel_is_busy(dmaChannel)) return;
+    tail += inFlight;
+    inFlight = 0;
+    if (head == tail) return;
+
+    //Only up to the end of the ring, the rest goes on the next Pump
+    uint32_t start = tail & (capacity - 1);
+    uint32_t length = head - tail;
+    if (length > capacity - start) length = capacity - start;
+    inFlight = length;
+    dma_channel_transfer_from_buffer_now(dmaChannel, ring + start, length);
+}
+
+#pragma endregion
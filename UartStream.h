@@ -0,0 +1,41 @@
+#ifndef UARTSTREAM_H
+#define UARTSTREAM_H
+
+#include "HAL.h"
+#include "hardware/uart.h"
+
+namespace Telemetry
+{
+    /// @brief Byte ring drained into a UART by DMA. Write only copies into the ring, and Pump hands the
+    /// @brief next contiguous block to the DMA once the last one went out, so sending costs no CPU time
+    /// @brief per byte and nothing ever waits on the UART. Write and Pump must run on the same core.
+    class UartStream {
+        public:
+            UartStream(uart_inst_t* uart);
+
+            bool Write(const uint8_t* data, size_t length);
+            void Pump();
+
+            /// @brief Bytes waiting, including the block the DMA is sending
+            size_t Pending() { return head - tail; }
+            /// @brief Writes dropped because the ring was full
+            uint32_t Dropped() { return dropped; }
+
+            /// @brief Ring size, a power of two. About a third of a second of a 115200 baud UART
+            static constexpr size_t capacity = 4096;
+
+        protected:
+            UartStream() = delete;
+
+            uart_inst_t* const UART;
+            int dmaChannel;
+
+            uint8_t ring[capacity];
+            uint32_t head;      //Total bytes written
+            uint32_t tail;      //Total bytes the DMA finished
+            uint32_t inFlight;  //Bytes of the block the DMA is on
+            uint32_t dropped;
+    };
+} // namespace Telemetry
+
+#endif
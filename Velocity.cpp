@@ -0,0 +1,117 @@
+#include "Velocity.h"
+#include "Static.h"
+
+#pragma region WheelPI
+
+/// @param params Shared with the VelocityDrive, so both wheels follow a retune
+Control::WheelPI::WheelPI(const VelocityParams& params)
+: params(params), integral(0), stalledFor(0)
+{
+
+}
+
+/// @brief Runs one control tick
+/// @param setpoint The wanted wheel speed in m/s
+/// @param measured The encoder wheel speed in m/s
+/// @param dt Seconds since the last tick
+/// @return the signed duty to drive the wheel with, -1 to 1
+float Control::WheelPI::Update(float setpoint, float measured, float dt) {
+    if (setpoint == 0) {
+        Reset();
+        return 0;
+    }
+
+    float direction = setpoint > 0 ? 1.0f : -1.0f;
+    float feedForward = params.kFeedForward * setpoint + params.kStatic * direction;
+    if (Faulted()) return feedForward < -1 ? -1 : (feedForward > 1 ? 1 : feedForward);
+
+    float error = setpoint - measured;
+    float output = feedForward + params.kp * error + integral;
+
+    //Only integrate when that does not push a saturated output further into saturation
+    bool saturated = (output >= 1 && error > 0) || (output <= -1 && error < 0);
+    if (!saturated) {
+        integral += params.ki * error * dt;
+        integral = integral < -params.integralLimit ? -params.integralLimit : (integral > params.integralLimit ? params.integralLimit : integral);
+    }
+
+    //A wheel pushed hard that does not turn has no encoder, or is blocked
+    if ((output >= params.stallDuty || output <= -params.stallDuty) && measured == 0) {
+        stalledFor += dt;
+    } else {
+        stalledFor = 0;
+    }
+
+    return output < -1 ? -1 : (output > 1 ? 1 : output);
+}
+
+/// @brief Clears the integral, the stall timer keeps running so a fault survives a stop
+void Control::WheelPI::Reset() {
+    integral = 0;
+}
+
+#pragma endregion
+
+#pragma region VelocityDrive
+
+/// @brief Creates the velocity loop on top of a drivetrain and the two wheel encoders
+/// @param drive The drivetrain to write duties to
+/// @param left The left wheel encoder, counting up going forward
+/// @param right The right wheel encoder, counting up going forward
+/// @param params The tuning constants to use
+template <Drivetrain::DriveLike DriveT>
+Control::VelocityDrive<DriveT>::VelocityDrive(DriveT& drive, Sensor::MotorEncoder& left, Sensor::MotorEncoder& right, VelocityParams params)
+: Drive(drive), LeftEncoder(left), RightEncoder(right), params(params), LeftLoop(this->params), RightLoop(this->params),
+mode(Mode::Stopped), leftSetpoint(0), rightSetpoint(0), lastUpdate_us(0)
+{
+
+}
+
+/// @brief Sets the body velocity to hold, takes effect on the next Update
+/// @param linear Forward speed in m/s
+/// @param angular Turn rate in rad/s, positive turns left
+template <Drivetrain::DriveLike DriveT>
+void Control::VelocityDrive<DriveT>::SetVelocity(float linear, float angular) {
+    leftSetpoint = linear - angular * params.trackWidth / 2;
+    rightSetpoint = linear + angular * params.trackWidth / 2;
+    mode = Mode::Velocity;
+}
+
+/// @brief Runs both wheel loops once. Call it at the encoder rate, it uses the velocities of the last encoder tick
+template <Drivetrain::DriveLike DriveT>
+void Control::VelocityDrive<DriveT>::Update() {
+    uint64_t now = time_us_64();
+    float dt = lastUpdate_us == 0 ? 0 : (now - lastUpdate_us) / 1000000.0f;
+    lastUpdate_us = now;
+    if (mode != Mode::Velocity) return;
+
+    float left = LeftLoop.Update(leftSetpoint, LeftEncoder.Snapshot().linearVelocity, dt);
+    float right = RightLoop.Update(rightSetpoint, RightEncoder.Snapshot().linearVelocity, dt);
+    Drive.SetDuties(left, right);
+}
+
+/// @brief Open loop duties, bypassing the controller until the next setpoint
+template <Drivetrain::DriveLike DriveT>
+void Control::VelocityDrive<DriveT>::SetDuties(float left, float right) {
+    mode = Mode::Duty;
+    LeftLoop.Reset();
+    RightLoop.Reset();
+    Drive.SetDuties(left, right);
+}
+
+/// @brief Stops the motors and the loops, the motors stay off until the next setpoint
+template <Drivetrain::DriveLike DriveT>
+void Control::VelocityDrive<DriveT>::Stop() {
+    mode = Mode::Stopped;
+    leftSetpoint = 0;
+    rightSetpoint = 0;
+    LeftLoop.Reset();
+    RightLoop.Reset();
+    Drive.Stop();
+}
+
+//The two drivetrains the firmware can be built with, see P2_STATIC_DISPATCH
+template class Control::VelocityDrive<Drivetrain::DualMotor>;
+template class Control::VelocityDrive<Static::BoardDualMotor>;
+
+#pragma endregion
@@ -0,0 +1,91 @@
+#ifndef VELOCITY_H
+#define VELOCITY_H
+
+#include "DriveTrain.h"
+#include "Sensor.h"
+
+namespace Control
+{
+    /// @brief The tuning constants of the wheel velocity loop. Duties are 0 to 1, speeds are wheel m/s
+    struct VelocityParams {
+        float maxWheelSpeed = 0.4f;     //Wheel speed at full duty on a full battery, Forward(1) asks for this
+        float trackWidth = 0.15f;       //Meters between the wheel contact points
+        float kFeedForward = 2.5f;      //Duty per m/s, about 1 / maxWheelSpeed
+        float kStatic = 0.06f;          //Duty that just overcomes friction, added in the direction of travel
+        float kp = 2.0f;                //Duty per m/s of error
+        float ki = 20.0f;               //Duty per meter of integrated error
+        float integralLimit = 0.5f;     //Most duty the integral may add or take away
+        float stallDuty = 0.5f;         //Duty that must move the wheel, used to spot a missing encoder
+        float stallTime = 0.5f;         //Seconds at stallDuty without motion before the encoder counts as faulted
+    };
+
+    /// @brief PI velocity loop of one wheel with feed-forward. The integral stops growing while the output
+    /// @brief is saturated in the direction it would push (conditional integration), so it never winds up
+    class WheelPI {
+        public:
+            WheelPI(const VelocityParams& params);
+
+            float Update(float setpoint, float measured, float dt);
+            void Reset();
+
+            /// @brief True once the wheel was driven hard without moving, the loop is then feed-forward only
+            bool Faulted() { return stalledFor >= params.stallTime; }
+
+        protected:
+            const VelocityParams& params;
+            float integral;
+            float stalledFor;
+    };
+
+    /// @brief Closed-loop drivetrain. Takes linear and angular velocity setpoints, turns them into wheel speed
+    /// @brief setpoints and runs a WheelPI per wheel on the encoder velocities. It also has the DualMotor API, with
+    /// @brief speed meaning a fraction of maxWheelSpeed, so Bouncer can drive it and get ground speed, not duty.
+    /// @tparam DriveT The drivetrain the duties go to
+    template <Drivetrain::DriveLike DriveT>
+    class VelocityDrive {
+        public:
+            VelocityDrive(DriveT& drive, Sensor::MotorEncoder& left, Sensor::MotorEncoder& right, VelocityParams params = VelocityParams());
+
+            void SetVelocity(float linear, float angular);
+            void Update();
+
+            void Forward(float speed) { SetVelocity(speed * params.maxWheelSpeed, 0); }
+            void Backward(float speed) { SetVelocity(-speed * params.maxWheelSpeed, 0); }
+            void SpinLeft(float speed) { SetVelocity(0, 2 * speed * params.maxWheelSpeed / params.trackWidth); }
+            void SpinRight(float speed) { SetVelocity(0, -2 * speed * params.maxWheelSpeed / params.trackWidth); }
+            void SetDuties(float left, float right);
+            void SetState(bool state) { Drive.SetState(state); }
+            void Stop();
+            float GetLeftDuty() { return Drive.GetLeftDuty(); }
+            float GetRightDuty() { return Drive.GetRightDuty(); }
+
+            /// @brief Wheel speed setpoints in m/s, left and right
+            float LeftSetpoint() { return leftSetpoint; }
+            float RightSetpoint() { return rightSetpoint; }
+            bool Faulted() { return LeftLoop.Faulted() || RightLoop.Faulted(); }
+
+        protected:
+            /// @brief What Update does
+            enum class Mode : uint8_t {
+                Stopped,    //Motors off, Update writes nothing
+                Velocity,   //Closed loop on the setpoints
+                Duty,       //Open loop duties from SetDuties
+            };
+
+            DriveT& Drive;
+            Sensor::MotorEncoder& LeftEncoder;
+            Sensor::MotorEncoder& RightEncoder;
+            VelocityParams params;
+            WheelPI LeftLoop;
+            WheelPI RightLoop;
+            Mode mode;
+            float leftSetpoint;
+            float rightSetpoint;
+            uint64_t lastUpdate_us;
+
+        private:
+            VelocityDrive() = delete;
+    };
+} // namespace Control
+
+#endif
@@ -4,26 +4,145 @@
 #include "hardware/pwm.h"
 #include "pico/multicore.h"
 #include "hardware/watchdog.h"
+#include "hardware/uart.h"
 #include "PWM.h"
 #include "GPIO.h"
 #include "Sensor.h"
 #include "DriveTrain.h"
+#include "Control.h"
+#include "Board.h"
+#include "Static.h"
+#include "Fade.h"
+#include "Scheduler.h"
+#include "Channel.h"
+#include "Messages.h"
+#include "Velocity.h"
+#include "Odometry.h"
+#include "Fusion.h"
+#include "Power.h"
+#include "Coverage.h"
+#include "Trace.h"
+#include "Recorder.h"
+#include "SelfTest.h"
+#ifdef P2_BINARY_TELEMETRY
+#include "Telemetry.h"
+#include "UartStream.h"
+#endif
 #include <atomic>
 
 #pragma region 
-volatile std::atomic<int> mode = 0;
-static std::atomic<float> workTime = 0;
+//Core0 only, the button IRQ counts the mode and the LED task the battery time. Core1 gets both as Commands
+static std::atomic<int> mode = 0;
+static float workTime = 0;
 
-GPIO::BUTTON mainButton(22, false);
+#ifdef P2_BATTERY_MODEL
+//What every PWM channel drew, core1 writes the motors and core0 the LEDs and logic. workTime follows its energy
+static Power::Ledger ledger;
+#endif
 
-GPIO::LED redLed(28);
-PWM::LED blueLed(26);
-PWM::LED greenLed(27);
+//One channel each way, both ring the other core's FIFO so the receiver wakes at once
+Buffer::Channel<Message::Command, Message::commandCapacity> commands(true);
+Buffer::Channel<Message::Telemetry, Message::telemetryCapacity> telemetry(true);
 
+using Board::Role;
+using Board::PinOf;
+
+#ifdef P2_STATIC_DISPATCH
+using BoardDrive = Static::BoardDualMotor;
+#else
+using BoardDrive = Drivetrain::DualMotor;
+#endif
+
+//What the Bouncer drives, wheel velocity or plain duty
+#ifdef P2_VELOCITY_CONTROL
+using BounceDrive = Control::VelocityDrive<BoardDrive>;
+#else
+using BounceDrive = BoardDrive;
+#endif
+
+#if defined(P2_RECORD) && !defined(P2_BINARY_TELEMETRY)
+#error "P2_RECORD sends its Input frames in the binary telemetry stream and needs P2_BINARY_TELEMETRY"
+#endif
+
+#if defined(P2_COVERAGE) && !defined(P2_VELOCITY_CONTROL)
+#error "P2_COVERAGE drives by velocity and needs P2_VELOCITY_CONTROL"
+#endif
+
+#if defined(P2_COVERAGE) && defined(P2_TTC_GOVERNOR)
+#error "P2_COVERAGE and P2_TTC_GOVERNOR both replace the bouncer, pick one"
+#endif
+
+GPIO::BUTTON mainButton(PinOf(Role::MainButton), false);
+
+GPIO::LED redLed(PinOf(Role::RedLed));
+PWM::LED blueLed(PinOf(Role::BlueLed));
+PWM::LED greenLed(PinOf(Role::GreenLed));
+
+//Blue and green share a slice, so one fade engine streams both
+static_assert(Board::Pin<Role::BlueLed>::slice == Board::Pin<Role::GreenLed>::slice, "The fade engine needs the blue and green LED on one slice");
+PWM::FadeEngine ledFades(Board::Pin<Role::GreenLed>::slice, PWM::LED::wrapCounter, PWM::LED::frequency);
+constexpr uint blueChannel = Board::Pin<Role::BlueLed>::channel;
+constexpr uint greenChannel = Board::Pin<Role::GreenLed>::channel;
+
+
+#ifdef P2_BINARY_TELEMETRY
+//Binary State frames out of the stdio UART, decode them with p2_decode. Replaces the printed distance
+Telemetry::UartStream telemetryStream(uart0);
+//Frame counter of the stream, core1 only
+static uint16_t streamSequence = 0;
+#endif
+
+//Both cores' boot self-test results, 2 bits a check, see SelfTest.h
+static std::atomic<SelfTest::Status> selfTest = 0;
+//Blinks the LEDs at boot and the red one on a failed self-test, off a timer. Core0 only
+static SelfTest::Blink bootBlink;
+
+#ifdef P2_TRACE
+//Set by core1 once the trace rings are out of the UART
+static std::atomic<bool> traceDumped = false;
+#endif
+
+/// @brief What the core1 tasks work on, built in core1_main. mode and workTime are core1's copies, set by Commands
+struct Core1Context {
+    BoardDrive& Drive;
+    Sensor::Distance& DistanceSensor;
+    Sensor::MotorEncoder& LeftEncoder;
+    Sensor::MotorEncoder& RightEncoder;
+    BounceDrive& Wheels;
+    Navigation::Odometry& Odometry;
+    Navigation::WallEstimator& Wall;
+    Control::Bouncer<BounceDrive>& Bouncer;
+    Control::Governor<BounceDrive>& Governor;
+    Navigation::ZigZagFollower& Coverage;
+    Tasks::Scheduler& Scheduler;
+    int mode;
+    float workTime;
+    float speedLimit;
+    uint32_t sequence;
+};
+
+/// @brief The newest Telemetry from core1, core0 only
+static Message::Telemetry latest = {};
 
 #pragma region Function Headers
 void mainButton_callback(uint32_t eventMask);
 
+void led_task(void* context);
+void blink_task(void* context);
+void command_task(void* context);
+void print_task(void* context);
+void control_task(void* context);
+void telemetry_task(void* context);
+void stream_task(void* context);
+
+void boot_leds(bool on, void* context);
+void fail_leds(bool on, void* context);
+
+void core0_idle(void* context, uint64_t until_us);
+void core1_idle(void* context, uint64_t until_us);
+void handle_commands(Core1Context* core1);
+void dump_trace();
+
 int64_t alarmHoldRestart_callback(alarm_id_t event, void* USERDATA);
 
 void core1_main(); 
@@ -33,87 +152,68 @@ void core1_main();
 #pragma region Main
 int main()
 {
-    
-    
-    uint64_t workStart_us = 0;
-    float idleFadeCycle = 0;
-    float lowPowerWarnCycle = 0;
-
     //Init the default configurations
     //This turns on UART.
     stdio_init_all();
-    
+
+    //The button belongs to core0, its IRQ runs here
+    mainButton.SetIRQ(GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, &mainButton_callback);
+
+    uint64_t boot_us = time_us_64();
+
     //Launch core1
     multicore_launch_core1(core1_main);
 
-    //Wait for core1 to fully init
-    multicore_fifo_pop_blocking();
-
-    
-
-    while (true) {
-
-        
-        if (mode % 2 == 0) {
-        #pragma region Pause Mode Core 1
-
-            if(workTime < 45) {
-                redLed.SetState(0);
-                greenLed.FadeUp(500, 1, mode);
-                if (mode % 2 != 0) continue;
-                greenLed.FadeDown(500, 1, mode);
-                blueLed.SetState(0);
-            }else if (workTime >= 45 && workTime < 55){
-                redLed.SetState(0);
-                blueLed.FadeUp(500, 1, mode);
-                if (mode % 2 != 0) continue;
-                blueLed.FadeDown(500, 1, mode);
-                greenLed.SetState(0);
-            } else if (workTime >= 55 && workTime < 60) 
-            {
-                workStart_us = time_us_64(); //Start accuminlating workTime after 55 seconds in anymode, so it can restart after 60 (or 5 seconds of red light)
-                if (idleFadeCycle <= .5) {
-                    blueLed.SetDuty(idleFadeCycle * 2);
-                } else if (idleFadeCycle < 1) {
-                    blueLed.SetDuty(1.0f - ( (idleFadeCycle - 0.5f) * 2.0f));
-                } else {
-                    idleFadeCycle = 0;
-                }
-
-                redLed.ToggleEvery(.05);
-                sleep_ms(10);
-                workTime += (float)(time_us_64() - workStart_us) / 1000000.0f;
-                idleFadeCycle += (float)(time_us_64() - workStart_us) / 1000000.0f;
-                lowPowerWarnCycle += (float)(time_us_64() - workStart_us) / 1000000.0f;
-                
-            } else {
-                break;
-            }
-        #pragma endregion
-        } else {
-        #pragma region Work Mode Core 1
-           
-            workStart_us = time_us_64();
-            
-            if (workTime < 45) {
-                greenLed.SetState(1);
-            } else if (workTime >= 45 && workTime < 55) {
-                greenLed.SetState(0);
-                blueLed.SetState(1);
-            } else if (workTime >= 55 && workTime < 60) {
-                greenLed.SetState(0);
-                blueLed.SetState(1);
-                redLed.ToggleEvery(.05);
-            } else {
-                break;
-            }
+    //Core0's share of the self-test, core1 runs its own meanwhile
+    SelfTest::Runner selfTestRunner(selfTest);
+    SelfTest::LevelCheck buttonCheck(PinOf(Role::MainButton), false);
+    SelfTest::PwmCheck ledPwmCheck(Board::Pin<Role::BlueLed>::slice, PWM::LED::frequency, PWM::LED::wrapCounter);
+    selfTestRunner.Add(SelfTest::Check::Button, &SelfTest::LevelCheck::Poll, &buttonCheck, 100000);
+    selfTestRunner.Add(SelfTest::Check::LedPwm, &SelfTest::PwmCheck::Poll, &ledPwmCheck, 100000);
+    selfTestRunner.Run();
+
+    //Core1 has its results in too once it sends its first Telemetry, and is running if they passed
+    while (!telemetry.Receive(latest)) {
+        telemetry.Wait(UINT64_MAX);
+    }
+    uint64_t ready_us = time_us_64() - boot_us;
+    SelfTest::Status status = selfTest;
+#ifndef P2_BINARY_TELEMETRY
+    printf(" Self-test %03x, ready in %lu ms\n", (unsigned)status, (unsigned long)(ready_us / 1000));
+    for (int i = 0; i < (int)SelfTest::Check::Count; i++) {
+        SelfTest::Result result = SelfTest::Decode(status, (SelfTest::Check)i);
+        if (result != SelfTest::Result::Pass) printf(" Self-test %s: %s%s\n", SelfTest::Name((SelfTest::Check)i), SelfTest::Name(result), SelfTest::Advisory((SelfTest::Check)i) ? " (advisory)" : "");
+    }
+#endif
+    if (!SelfTest::Passed(status)) {
+        //A second of the red LED toggling every 200 ms, then try again
+        bootBlink.Start(200, 5, &fail_leds, nullptr);
+        while (bootBlink.Running()) {
             sleep_ms(10);
-            workTime += (float)(time_us_64() - workStart_us) / 1000000.0f;
-            lowPowerWarnCycle += (float)(time_us_64() - workStart_us) / 1000000.0f;
         }
-        #pragma endregion
+        watchdog_reboot(0,0,0);
     }
+    //All the required checks passed, so the blink, toggling every 100 ms for 2 seconds off a timer. The LED tasks leave the LEDs to it until it is done
+    bootBlink.Start(100, 20, &boot_leds, nullptr);
+
+    Tasks::Scheduler scheduler;
+    scheduler.Add("commands", &command_task, nullptr, 10000, 0, 200);
+    scheduler.Add("leds", &led_task, &scheduler, 20000, 1, 1000);
+    scheduler.Add("blink", &blink_task, nullptr, 50000, 2, 500);
+#ifndef P2_BINARY_TELEMETRY
+    scheduler.Add("print", &print_task, nullptr, 100000, 3, 5000);
+#endif
+    scheduler.SetIdle(&core0_idle, nullptr);
+    //Returns once led_task sees the 60 second limit
+    scheduler.Run();
+#ifdef P2_TRACE
+    dump_trace();
+#endif
+#if defined(P2_BATTERY_MODEL) && !defined(P2_BINARY_TELEMETRY)
+    printf(" Energy: %.0f J over %.2f m, %.1f J/m\n", ledger.Joules(), ledger.Meters(), ledger.JoulesPerMeter());
+#endif
 
+    ledFades.Stop();
     watchdog_reboot(0, 0, 100);
 }
 #pragma endregion
@@ -142,70 +242,340 @@ int64_t alarmHoldRestart_callback(alarm_id_t event, void* USERDATA) {
 
 void core1_main() {
 
-    Drivetrain::DualMotor Drive(12, 16, 17, 18, 15, 14, 13);
-    Sensor::Distance DistanceSensor(9, 8);
+#ifdef P2_STATIC_DISPATCH
+    Static::BoardDualMotor Drive;
+#else
+    Drivetrain::DualMotor Drive(PinOf(Role::MotorStandby),
+        PinOf(Role::LeftMotorPWM), PinOf(Role::LeftMotorIn1), PinOf(Role::LeftMotorIn2),
+        PinOf(Role::RightMotorPWM), PinOf(Role::RightMotorIn1), PinOf(Role::RightMotorIn2));
+#endif
+#ifdef P2_ECHO_REARM
+    //Ping again as soon as each echo lands, faster the closer the wall
+    Sensor::Distance DistanceSensor(PinOf(Role::DistanceTrigger), PinOf(Role::DistanceEcho), {Sensor::TriggerMode::Rearm});
+#else
+    Sensor::Distance DistanceSensor(PinOf(Role::DistanceTrigger), PinOf(Role::DistanceEcho));
+#endif
+#ifdef P2_EDGE_VELOCITY
+    //The edge IRQs time every step, so the velocity comes from the edge period at low speed
+    Sensor::MotorEncoder LeftEncoder(PinOf(Role::LeftEncoderA), PinOf(Role::LeftEncoderB), Sensor::EncoderBackend::Interrupt, Sensor::VelocityMethod::Hybrid);
+    Sensor::MotorEncoder RightEncoder(PinOf(Role::RightEncoderA), PinOf(Role::RightEncoderB), Sensor::EncoderBackend::Interrupt, Sensor::VelocityMethod::Hybrid);
+#else
+    Sensor::MotorEncoder LeftEncoder(PinOf(Role::LeftEncoderA), PinOf(Role::LeftEncoderB), Sensor::EncoderBackend::Pio);
+    Sensor::MotorEncoder RightEncoder(PinOf(Role::RightEncoderA), PinOf(Role::RightEncoderB), Sensor::EncoderBackend::Pio);
+#endif
 
-    const float baseSpeed = 0.6;
-    float speed = baseSpeed;
+#ifdef P2_VELOCITY_CONTROL
+    Control::VelocityDrive<BoardDrive> Wheels(Drive, LeftEncoder, RightEncoder);
+#else
+    BoardDrive& Wheels = Drive;
+#endif
+    Control::Bouncer Bouncer(Wheels);
+    Control::Governor Governor(Wheels);
+    Navigation::Odometry Odometry({Sensor::MotorEncoder::metersPerCount});
+    Navigation::WallEstimator Wall({Sensor::MotorEncoder::metersPerCount});
+    //The sweep starts where the robot is, in the right hand corner of the area facing along it
+    Navigation::ZigZagPlanner Planner({});
+    Navigation::ZigZagFollower Coverage(Planner);
 
-    int needsToTurn = 0;
-    mainButton.SetIRQ(GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, &mainButton_callback);
+    //Core1's share of the self-test, core0 checks the button and the LED PWM meanwhile
+    SelfTest::Runner selfTestRunner(selfTest);
+    SelfTest::EchoCheck echoCheck(DistanceSensor);
+    SelfTest::MotorPulse<BoardDrive> motorPulse(Drive, LeftEncoder, RightEncoder);
+    SelfTest::PwmCheck motorPwmCheck(Board::Pin<Role::LeftMotorPWM>::slice, PWM::MOTOR::frequency, PWM::MOTOR::wrapCounter, Board::Pin<Role::RightMotorPWM>::slice);
+    selfTestRunner.Add(SelfTest::Check::Echo, &SelfTest::EchoCheck::Poll, &echoCheck, 300000);
+    selfTestRunner.Add(SelfTest::Check::LeftEncoder, &SelfTest::MotorPulse<BoardDrive>::Left, &motorPulse, 300000);
+    selfTestRunner.Add(SelfTest::Check::RightEncoder, &SelfTest::MotorPulse<BoardDrive>::Right, &motorPulse, 300000);
+    selfTestRunner.Add(SelfTest::Check::MotorPwm, &SelfTest::PwmCheck::Poll, &motorPwmCheck, 100000);
+    selfTestRunner.Run();
+
+    Tasks::Scheduler scheduler;
+    Core1Context context = {Drive, DistanceSensor, LeftEncoder, RightEncoder, Wheels, Odometry, Wall, Bouncer, Governor, Coverage, scheduler, 0, 0, 1, 0};
+    telemetry_task(&context); //Let Core0 know I am done testing
 
-    sleep_ms(500); //Give time for the distance sensor to react
+    //Core0 blinks red and reboots on a failed required check, the motors stay in standby until then
+    if (!selfTestRunner.Passed()) {
+        while (true) {
+            sleep_ms(1000);
+        }
+    }
 
-    if (mainButton.GetState() == 0 && DistanceSensor.GetDistance() > 0 ) {
-        for (int i = 0; i < 200; i++) {
-            redLed.ToggleEvery(.1);
-            blueLed.ToggleEvery(.1);
-            greenLed.ToggleEvery(.1);
+    scheduler.Add("control", &control_task, &context, 10000, 0, 2000);
+    scheduler.Add("telemetry", &telemetry_task, &context, 100000, 2, 500);
+#ifdef P2_BINARY_TELEMETRY
+    scheduler.Add("stream", &stream_task, &context, 20000, 3, 500);
+#endif
+    scheduler.SetIdle(&core1_idle, &context);
+    scheduler.Run();
 
-            sleep_ms(10);
+    Drive.Stop();
+    Drive.SetState(0);
+}
+
+#ifdef P2_TRACE
+/// @brief Core0, at the end of the run. Sends both cores' trace rings out of the UART for p2_trace. With the binary
+/// @brief stream core1 owns the UART, so it is asked to and waited for, otherwise core0 writes the frames itself
+void dump_trace() {
+#ifdef P2_BINARY_TELEMETRY
+    commands.Send({Message::CommandType::DumpTrace, 0});
+    uint64_t giveUp_us = time_us_64() + 5000000;
+    while (!traceDumped && time_us_64() < giveUp_us) {
+        sleep_ms(10);
+    }
+#else
+    static uint16_t sequence = 0;
+    Trace::Freeze();
+    Trace::Dump([](const uint8_t* data, size_t length, void*) {
+        uart_write_blocking(uart0, data, length);
+    }, nullptr, sequence);
+#endif
+}
+#endif
+
+#pragma region Tasks
+/// @brief Core0, 50 Hz. Shows the mode and battery state on the blue and green LED and accumulates workTime, or with
+/// @brief P2_BATTERY_MODEL accounts the LEDs and logic and takes workTime from the energy used
+/// @param context The core0 scheduler, stopped when the 60 seconds are up
+void led_task(void* context) {
+    static int litChannel = -1;
+    static bool pulsing = false;
+    const float period = 0.02f;
+    bool paused = mode % 2 == 0;
+
+    if (workTime >= 60) {
+        ((Tasks::Scheduler*)context)->Stop();
+        return;
+    }
+
+    //GREEN below 45 seconds, BLUE after. Pulsing at 1 Hz in PAUSE mode, constantly on in WORK mode
+    //Not before the boot blink is done with the LEDs
+    int wantedChannel = workTime < 45 ? greenChannel : blueChannel;
+    if (!bootBlink.Running() && (wantedChannel != litChannel || paused != pulsing)) {
+        litChannel = wantedChannel;
+        pulsing = paused;
+        ledFades.Set(litChannel == greenChannel ? blueChannel : greenChannel, 0);
+        if (pulsing) {
+            ledFades.Pulse(litChannel, 1, 1000);
+        } else {
+            ledFades.Set(litChannel, 1);
         }
-        redLed.SetState(0);
-        blueLed.SetState(0);
-        greenLed.SetState(0);
+    }
+
+#ifdef P2_BATTERY_MODEL
+    //The battery clock is the energy used, as seconds of the 60 second run. After 55 seconds it also runs on in
+    //real time, so PAUSE mode still ends the run 5 seconds later like the plain clock
+    ledger.Load(Power::Channel::BlueLed, ledFades.GetBrightness(blueChannel), period);
+    ledger.Load(Power::Channel::GreenLed, ledFades.GetBrightness(greenChannel), period);
+    ledger.Load(Power::Channel::RedLed, redLed.GetState() ? 1.0f : 0.0f, period);
+    ledger.Load(Power::Channel::Logic, 1, period);
+    float used = ledger.UsedTime(60);
+    workTime = workTime >= 55 && workTime + period > used ? workTime + period : used;
+#else
+    //WORK mode time counts towards the battery, and after 55 seconds so does PAUSE mode, so it can restart after 60 (or 5 seconds of red light)
+    //Counted in whole periods, the scheduler keeps them exact
+    if (!paused || workTime >= 55) {
+        workTime += period;
+    }
+#endif
+}
+
+/// @brief Core0, 20 Hz. Toggles the RED LED every run after 55 seconds, a 10 Hz blink
+void blink_task(void* context) {
+    if (bootBlink.Running()) {
+        return;
+    }
+    if (workTime >= 55) {
+        redLed.Toggle();
     } else {
-        for(int i = 0; i < 100; i++) {
-            redLed.ToggleEvery(.2);
-            sleep_ms(10);
-        }
-        watchdog_reboot(0,0,0);
+        redLed.SetState(0);
     }
+}
 
+/// @brief Core0, 100 Hz. Sends core1 the mode and work time whenever they change. A send that finds the
+/// @brief channel full is retried on the next run, since the value is only marked sent once it went out
+void command_task(void* context) {
+    static int sentMode = -1;
+    static float sentWorkTime = -1;
 
-    multicore_fifo_push_blocking(72);//Let Core0 know I am started
+    int currentMode = mode;
+    if (currentMode != sentMode && commands.Send({Message::CommandType::SetMode, (float)currentMode})) {
+        sentMode = currentMode;
+    }
+    if (workTime != sentWorkTime && commands.Send({Message::CommandType::SetWorkTime, workTime})) {
+        sentWorkTime = workTime;
+    }
+}
 
-    while (true) {
-        #pragma region Pause Mode Core 2
-        if (mode % 2 == 0) {
-            Drive.Stop();
-            Drive.SetState(0);
-            printf(" Distance: %.2f \n",DistanceSensor.GetDistance());
-        #pragma endregion
-        } else {
-            #pragma region Work Mode Core 1
-            if (workTime < 45) { speed = baseSpeed;}
-            else { speed = baseSpeed / 2;}
-            float distance = DistanceSensor.GetDistance();
-            Drive.SetState(1);
-
-           if ((distance > 0.55 || distance == -1) && needsToTurn == 0) {
-                Drive.Forward(speed);
-            } else if (needsToTurn <= 60){
-                needsToTurn++;
-                Drive.Backward(speed);
-            } else {
-                needsToTurn++;
-                Drive.SpinLeft(speed);
-                if (needsToTurn >= 100) {
-                    needsToTurn = 0;
-                }
-            }
+/// @brief Core0, 10 Hz. Prints the distance core1 last reported, in PAUSE mode
+void print_task(void* context) {
+    if (mode % 2 == 0) {
+        printf(" Distance: %.2f \n", latest.distance);
+    }
+}
+
+/// @brief Core0, from the boot blink's timer. All three LEDs at once
+void boot_leds(bool on, void* context) {
+    redLed.SetState(on);
+    blueLed.SetState(on);
+    greenLed.SetState(on);
+}
+
+/// @brief Core0, from the failed self-test blink's timer. The red LED only
+void fail_leds(bool on, void* context) {
+    redLed.SetState(on);
+}
+
+/// @brief Core0 idle, sleeps until the next deadline but wakes on core1's doorbell to take its Telemetry
+void core0_idle(void* context, uint64_t until_us) {
+    if (telemetry.Wait(until_us)) {
+        telemetry.Latest(latest);
+    }
+}
+
+/// @brief Core1 idle, sleeps until the next deadline but wakes on core0's doorbell, so a mode change
+/// @brief stops the motors right away instead of on the next control tick
+/// @param context The Core1Context
+void core1_idle(void* context, uint64_t until_us) {
+    if (commands.Wait(until_us)) {
+        handle_commands((Core1Context*)context);
+    }
+}
+
+/// @brief Core1. Applies every waiting Command
+/// @param core1 The Core1Context
+void handle_commands(Core1Context* core1) {
+    Message::Command command;
+    while (commands.Receive(command)) {
+        switch (command.type) {
+            case Message::CommandType::SetMode:
+                core1->mode = (int)command.value;
+                if (core1->mode % 2 == 0) core1->Bouncer.Pause();
+                break;
+            case Message::CommandType::SetWorkTime:
+                core1->workTime = command.value;
+                break;
+            case Message::CommandType::SetSpeedLimit:
+                core1->Bouncer.SetSpeedLimit(command.value);
+                core1->Governor.SetSpeedLimit(command.value);
+                core1->speedLimit = command.value;
+                break;
+            case Message::CommandType::DumpTrace:
+#if defined(P2_TRACE) && defined(P2_BINARY_TELEMETRY)
+                //Blocks core1 for the 2 seconds the UART needs, so the motors stop first
+                core1->Bouncer.Pause();
+                Trace::Freeze();
+                Trace::Dump([](const uint8_t* data, size_t length, void*) {
+                    while (Telemetry::UartStream::capacity - telemetryStream.Pending() < length) telemetryStream.Pump();
+                    telemetryStream.Write(data, length);
+                }, nullptr, streamSequence);
+                while (telemetryStream.Pending() > 0) telemetryStream.Pump();
+                traceDumped = true;
+#endif
+                break;
         }
-        #pragma endregion
-        sleep_ms(10);
     }
-    Drive.Stop();
-    Drive.SetState(0);
 }
+
+/// @brief Core1, 100 Hz. Updates the odometry and the wall estimate, reads the distance and runs the WORK mode logic, the bouncer, with
+/// @brief P2_TTC_GOVERNOR the time to collision governor or with P2_COVERAGE the zig-zag sweep, or holds the
+/// @brief motors in PAUSE mode, then runs the wheel velocity loop
+/// @param context The Core1Context
+void control_task(void* context) {
+    Core1Context* core1 = (Core1Context*)context;
+    handle_commands(core1);
+    //Dead reckon from the counts of the last encoder tick, the pose is published for any core to read
+    Sensor::EncoderState left = core1->LeftEncoder.Snapshot();
+    Sensor::EncoderState right = core1->RightEncoder.Snapshot();
+    uint64_t counted_us = left.timestamp_us > right.timestamp_us ? left.timestamp_us : right.timestamp_us;
+    core1->Odometry.Update(left.counts, right.counts, counted_us);
+#ifdef P2_BATTERY_MODEL
+    //The duties of the last 10 ms against the wheel speeds they gave
+    static int32_t lastLeft = 0, lastRight = 0;
+    ledger.Motor(Power::Channel::LeftMotor, core1->Drive.GetLeftDuty(), left.angularVelocity, 0.01f);
+    ledger.Motor(Power::Channel::RightMotor, core1->Drive.GetRightDuty(), right.angularVelocity, 0.01f);
+    ledger.Travel((left.counts - lastLeft + right.counts - lastRight) / 2.0f * Sensor::MotorEncoder::metersPerCount);
+    lastLeft = left.counts;
+    lastRight = right.counts;
+#endif
+    //The wall estimate moves with every encoder tick and is corrected by each echo
+    Sensor::DistanceReading reading = core1->DistanceSensor.GetReading();
+#ifdef P2_WALL_FUSION
+    float distance = core1->Wall.Update(left.counts, right.counts, counted_us, reading).distance;
+#else
+    core1->Wall.Update(left.counts, right.counts, counted_us, reading);
+    float distance = reading.distance;
+#endif
+    if (core1->mode % 2 == 0) {
+        core1->Bouncer.Pause();
+    } else {
+#ifdef P2_COVERAGE
+        //Halved on a low battery like the bouncer, and no faster than the speed limit allows
+        float scale = core1->workTime < Control::BounceParams().lowBatteryTime ? 1.0f : 0.5f;
+        float limit = core1->speedLimit * Control::VelocityParams().maxWheelSpeed / Navigation::FollowerParams().speed;
+        Navigation::Twist twist = core1->Coverage.Step(core1->Odometry.Snapshot(), distance, scale < limit ? scale : limit);
+        core1->Wheels.SetState(1);
+        core1->Wheels.SetVelocity(twist.linear, twist.angular);
+        if (core1->Coverage.Done()) core1->Wheels.Stop();
+#elif defined(P2_TTC_GOVERNOR)
+        core1->Governor.Step(distance, (left.linearVelocity + right.linearVelocity) / 2, core1->workTime);
+#else
+        core1->Bouncer.Step(distance, core1->workTime);
+#endif
+    }
+#ifdef P2_VELOCITY_CONTROL
+    //Same rate as the encoder timer, so every update sees a fresh velocity
+    core1->Wheels.Update();
+#endif
+}
+
+/// @brief Core1, 10 Hz. Sends core0 what the sensors and motors are doing
+/// @param context The Core1Context
+void telemetry_task(void* context) {
+    Core1Context* core1 = (Core1Context*)context;
+    telemetry.Send({
+        core1->sequence++,
+        time_us_64(),
+        core1->DistanceSensor.Snapshot().distance,
+        core1->LeftEncoder.Snapshot().linearVelocity,
+        core1->RightEncoder.Snapshot().linearVelocity,
+        core1->Drive.GetLeftDuty(),
+        core1->Drive.GetRightDuty(),
+        core1->mode
+    });
+}
+
+#ifdef P2_BINARY_TELEMETRY
+/// @brief Core1, 50 Hz, in both modes. Encodes a State frame, and with P2_RECORD the recorded inputs, into the UART stream, the DMA sends it
+/// @param context The Core1Context
+void stream_task(void* context) {
+    Core1Context* core1 = (Core1Context*)context;
+    Sensor::EncoderState left = core1->LeftEncoder.Snapshot();
+    Sensor::EncoderState right = core1->RightEncoder.Snapshot();
+    const Tasks::TaskStats& control = core1->Scheduler.GetTask(0).stats;
+
+    Telemetry::Record record = {
+        time_us_64(),
+        core1->DistanceSensor.Snapshot().distance,
+        left.counts,
+        right.counts,
+        left.linearVelocity,
+        right.linearVelocity,
+        core1->Drive.GetLeftDuty(),
+        core1->Drive.GetRightDuty(),
+        core1->mode,
+        control.maxRun_us,
+        control.maxLateness_us,
+        control.overruns
+    };
+    uint8_t frame[Telemetry::headerSize + Telemetry::recordSize + Telemetry::crcSize];
+    telemetryStream.Write(frame, Telemetry::EncodeRecord(record, streamSequence++, frame));
+#ifdef P2_RECORD
+    //The raw inputs since the last run, a couple of frames a run at most so the State frames keep their room
+    Replay::recorder.Drain([](const uint8_t* data, size_t length, void*) {
+        telemetryStream.Write(data, length);
+    }, nullptr, streamSequence, 4);
+#endif
+    TRACE_COUNTER(StreamPending, telemetryStream.Pending());
+}
+#endif
+#pragma endregion
 #pragma endregion
\ No newline at end of file